@@ -0,0 +1,96 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "MappedOrganism.h"
+#include "PiafMunch/runPM.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/**
+ * Throughput of the phloem right hand side PhloemFlux::f (evaluations per second) for a wheat plant at several ages.
+ *
+ * The state is the one reached by a first startPM() call of one hour, f is then evaluated repeatedly for about one second.
+ *
+ * usage: benchmark_phloem_rhs [age1 age2 ...] (plant ages in days, default 7 14 21)
+ */
+
+using namespace CPlantBox;
+
+static std::shared_ptr<PhloemFlux> wheat(double age)
+{
+    auto plant = std::make_shared<MappedPlant>(2);
+    plant->readParameters("modelparameter/plant/Triticum_aestivum_adapted_2021.xml", "plant", true);
+    plant->setGeometry(std::make_shared<SDF_PlantBox>(1e100, 1e100, 60));
+    plant->initialize(false);
+    plant->simulate(age, false);
+    plant->setSoilGrid([](double x, double y, double z) { return std::max(int(std::floor(-z)), -1); });
+
+    std::vector<double> sx(60);
+    for (int i = 0; i<60; i++) {
+        sx[i] = -217. + 60.*i/59.;
+    }
+    auto r = std::make_shared<PhloemFlux>(plant, sx[0], 850e-6*0.5);
+    // xylem, at 20°C
+    double mu = std::pow(10, (-0.114 + (10./111.)*1.1))/(24*60*60)/100/1000*1.0197;
+    double kzl = 32*(std::pow(0.0015, 4)*2 + std::pow(0.0005, 4)*2)*M_PI/(mu*8);
+    double kzs = 52*(std::pow(0.0017, 4)*3 + std::pow(0.0008, 4))*M_PI/(mu*8);
+    double kzr0 = std::pow(0.0015, 4)*4*M_PI/(mu*8), kzr1 = (std::pow(0.00041, 4)*4 + std::pow(0.00087, 4))*M_PI/(mu*8);
+    r->setKr({ { 6.5e-5, 8.1e-5, 8.1e-5, 6.5e-5 }, { 0., 0. }, { 3.9e-4 } }, { }, 0.8);
+    r->setKx({ { kzr0, kzr1, kzr1, kzr0 }, { kzs, kzs }, { kzl } }, { });
+    r->psi_air = std::log(0.6)*8.314*998.2/1000*293.15/18.05*10000/0.9806806;
+    // phloem
+    double rsl = 18*std::pow(0.00025, 4), rss = 21*std::pow(0.00019, 4), rr0 = 33*std::pow(0.00039, 4), rr12 = 25*std::pow(0.00035, 4);
+    double kzl_st = 32*rsl*M_PI/8*0.9, kzs_st = 52*rss*M_PI/8*0.9, kzr0_st = rr0*M_PI/8*0.9, kzr12_st = rr12*M_PI/8*0.9;
+    r->setKr_st({ { 5e-2, 5e-2, 5e-2, 5e-2 }, { 0., 0. }, { 0. } }, 0.8);
+    r->setKx_st({ { kzr0_st, kzr12_st, kzr12_st, kzr0_st }, { kzs_st, kzs_st }, { kzl_st } });
+    double Al = 18*32*0.00025*0.00025*M_PI, As = 21*52*0.00019*0.00019*M_PI;
+    double Ar0 = 33*0.00039*0.00039*M_PI, Ar12 = 25*0.00035*0.00035*M_PI;
+    r->setAcross_st({ { Ar0, Ar12, Ar12, Ar0 }, { As, As }, { Al } });
+    r->g0 = 8e-3; r->VcmaxrefChl1 = 1.28; r->VcmaxrefChl2 = 8.33; r->a1 = 0.5; r->a3 = 1.5; r->alpha = 0.4; r->theta = 0.6;
+    r->setKrm2({ { 2e-5 } }); r->setKrm1({ { 10e-2 } }); r->setRhoSucrose({ { 0.51 }, { 0.65 }, { 0.56 } });
+    r->setRmax_st({ { 14.4, 9.0, 6.0, 14.4 }, { 5., 5. }, { 15. } });
+    r->KMfu = 0.1;
+    r->Qlight = 960e-6;
+    r->solve_photosynthesis(age, sx, true, std::vector<double>(), false, 0, 0.6, 20.);
+    r->solver = 10; // SPGMR with the tree preconditioner
+    r->startPM(age, age + 1./24., 1, 293.15, false, "benchmark_phloem_rhs.txt");
+    return r;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<double> ages;
+    for (int i = 1; i<argc; i++) {
+        ages.push_back(std::atof(argv[i]));
+    }
+    if (ages.empty()) {
+        ages = { 7., 14., 21. };
+    }
+    std::vector<double> rates;
+    std::vector<int> sizes;
+    for (double age : ages) {
+        auto r = wheat(age);
+        std::vector<double> y = r->Q_outv;
+        std::vector<double> y_dot(y.size() + 1);
+        double t = age + 1./24.;
+        int n = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        double dt = 0.;
+        while (dt<1.) {
+            for (int k = 0; k<100; k++) {
+                r->f(t, y.data() - 1, y_dot.data()); // 1-based, as called by the solver
+            }
+            n += 100;
+            dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }
+        sizes.push_back(y.size()/9); // Q_ST, Q_Mesophyll, ... per node (see PiafMunchState)
+        rates.push_back(n/dt);
+    }
+    std::cout << "\nage (d)\tnodes\tRHS evaluations / s\n";
+    for (size_t i = 0; i<ages.size(); i++) {
+        std::cout << ages[i] << "\t" << sizes[i] << "\t" << rates[i] << "\n";
+    }
+    return 0;
+}
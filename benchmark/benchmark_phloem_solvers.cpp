@@ -0,0 +1,234 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "MappedOrganism.h"
+#include "PiafMunch/runPM.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Wall time and solver statistics of PhloemFlux::startPM for several plants (sizes) and solver configurations (PhloemFlux::solver).
+ *
+ * Every run starts from the same plant and state, and integrates the same time window. The results are written as JSON,
+ * one record per plant and solver: number of nodes and equations, wall time of startPM, status, and the CVODE counters
+ * of PhloemFlux::solverStats (nst steps, nfe and nfeLS RHS evaluations, nsetups linear solver setups, nje Jacobian
+ * evaluations, npe preconditioner setups, nli linear iterations, netf, ncfn, ncfl failures, flag if CVODE failed).
+ * status is "ok", "failed" (CVODE error), "error" (exception), or "skipped" (dense and band matrices with more
+ * than 5e7 entries).
+ *
+ * usage: benchmark_phloem_solvers [-o file.json] [-w window] [-s 1,10,32 | -s all] [plant:age ...]
+ *
+ * plant is a parameter file of modelparameter/plant/ (organs with carbon limited growth, parameters per organ type are used),
+ * age the plant age (days), window the integration time (days, default 1./24.),
+ * default plants Triticum_aestivum_adapted_2021:7 Triticum_aestivum_adapted_2021:10 smallPlant_mgiraud:14,
+ * default solvers 1,2,5,6,8,9,10,12,23,28,31,32,33 (one configuration per linear solver and preconditioner type, see PhloemFlux::startPM)
+ */
+
+using namespace CPlantBox;
+
+struct Run {
+    std::string plant;
+    double age;
+    int nodes;
+    int solver;
+    double time = 0.;
+    std::string status = "ok";
+    std::string message;
+    SolverStats stats;
+};
+
+static std::shared_ptr<MappedPlant> makePlant(const std::string& name, double age)
+{
+    auto plant = std::make_shared<MappedPlant>(2);
+    plant->readParameters("modelparameter/plant/" + name + ".xml", "plant", true);
+    plant->setGeometry(std::make_shared<SDF_PlantBox>(1e100, 1e100, 60));
+    plant->initialize(false);
+    plant->simulate(age, false);
+    plant->setSoilGrid([](double x, double y, double z) { return std::max(int(std::floor(-z)), -1); });
+    return plant;
+}
+
+/**
+ * Wheat like parameters per organ type (see benchmark_phloem_rhs), photosynthesis at 20°C
+ */
+static std::shared_ptr<PhloemFlux> makePhloem(std::shared_ptr<MappedPlant> plant, double age, int solver)
+{
+    for (int ot = Organism::ot_root; ot<=Organism::ot_leaf; ot++) { // carbon limited growth of a previous run
+        for (auto p : plant->getOrganRandomParameter(ot)) {
+            if (p && p->f_gf) {
+                p->f_gf->CW_Gr.clear();
+            }
+        }
+    }
+    std::vector<double> sx(60);
+    for (int i = 0; i<60; i++) {
+        sx[i] = -217. + 60.*i/59.;
+    }
+    auto r = std::make_shared<PhloemFlux>(plant, sx[0], 850e-6*0.5);
+    // xylem
+    double mu = std::pow(10, (-0.114 + (10./111.)*1.1))/(24*60*60)/100/1000*1.0197;
+    double kzl = 32*(std::pow(0.0015, 4)*2 + std::pow(0.0005, 4)*2)*M_PI/(mu*8);
+    double kzs = 52*(std::pow(0.0017, 4)*3 + std::pow(0.0008, 4))*M_PI/(mu*8);
+    double kzr = std::pow(0.0015, 4)*4*M_PI/(mu*8);
+    r->setKr(std::vector<std::vector<double>>{ { 6.5e-5 }, { 0. }, { 3.9e-4 } }, std::vector<std::vector<double>>{ }, 0.8);
+    r->setKx(std::vector<std::vector<double>>{ { kzr }, { kzs }, { kzl } }, std::vector<std::vector<double>>{ });
+    r->psi_air = std::log(0.6)*8.314*998.2/1000*293.15/18.05*10000/0.9806806;
+    // phloem
+    double rsl = 18*std::pow(0.00025, 4), rss = 21*std::pow(0.00019, 4), rr0 = 33*std::pow(0.00039, 4);
+    r->setKr_st({ { 5e-2 }, { 0. }, { 0. } }, 0.8);
+    r->setKx_st({ { rr0*M_PI/8*0.9 }, { 52*rss*M_PI/8*0.9 }, { 32*rsl*M_PI/8*0.9 } });
+    r->setAcross_st({ { 33*0.00039*0.00039*M_PI }, { 21*52*0.00019*0.00019*M_PI }, { 18*32*0.00025*0.00025*M_PI } });
+    r->g0 = 8e-3; r->VcmaxrefChl1 = 1.28; r->VcmaxrefChl2 = 8.33; r->a1 = 0.5; r->a3 = 1.5; r->alpha = 0.4; r->theta = 0.6;
+    r->setKrm2({ { 2e-5 } }); r->setKrm1({ { 10e-2 } }); r->setRhoSucrose({ { 0.51 }, { 0.65 }, { 0.56 } });
+    r->setRmax_st({ { 14.4 }, { 5. }, { 15. } });
+    r->KMfu = 0.1;
+    r->Qlight = 960e-6;
+    r->solve_photosynthesis(age, sx, true, std::vector<double>(), false, 0, 0.6, 20.);
+    r->solver = solver;
+    return r;
+}
+
+/**
+ * Number of matrix entries of the dense and band solvers for neq equations (0 for the others, see PhloemFlux::startPM)
+ */
+static double matrixSize(int solver, double neq)
+{
+    switch (solver) {
+    case 31: return neq*neq;
+    case 7: return neq*(3*std::floor(neq/30) + 1);
+    case 28: return neq*(3*std::floor(neq/100) + 1);
+    case 29: return neq*(3*std::floor(neq/10) + 1);
+    case 30: return neq*(3*std::floor(neq/3) + 1);
+    case 34: return neq*(3*std::floor(neq/300) + 1);
+    default: return 0.;
+    }
+}
+
+static std::string escape(const std::string& s)
+{
+    std::string r;
+    for (char c : s) {
+        if (c=='"' || c=='\\') {
+            r += '\\';
+        }
+        r += (c=='\n') ? ' ' : c;
+    }
+    return r;
+}
+
+static void writeJson(std::ostream& out, double window, const std::vector<Run>& runs)
+{
+    out << "{\n  \"benchmark\": \"phloem_solvers\",\n  \"window\": " << window << ",\n  \"runs\": [";
+    for (size_t i = 0; i<runs.size(); i++) {
+        const Run& r = runs[i];
+        out << (i>0 ? "," : "") << "\n    {\"plant\": \"" << escape(r.plant) << "\", \"age\": " << r.age << ", \"nodes\": " << r.nodes
+            << ", \"equations\": " << 9*r.nodes << ", \"solver\": " << r.solver << ", \"time\": " << r.time
+            << ", \"status\": \"" << r.status << "\"";
+        if (!r.message.empty()) {
+            out << ", \"message\": \"" << escape(r.message) << "\"";
+        }
+        out << ", \"stats\": {";
+        bool first = true;
+        for (const auto& s : r.stats) {
+            out << (first ? "" : ", ") << "\"" << s.first << "\": " << s.second;
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string filename = "benchmark_phloem_solvers.json";
+    double window = 1./24.;
+    std::vector<int> solvers = { 1, 2, 5, 6, 8, 9, 10, 12, 23, 28, 31, 32, 33 };
+    std::vector<std::pair<std::string, double>> plants;
+    for (int i = 1; i<argc; i++) {
+        std::string a = argv[i];
+        if ((a=="-o" || a=="-w" || a=="-s") && i+1<argc) {
+            std::string v = argv[++i];
+            if (a=="-o") {
+                filename = v;
+            } else if (a=="-w") {
+                window = std::atof(v.c_str());
+            } else if (v=="all") {
+                solvers.clear();
+                for (int s = 1; s<=35; s++) {
+                    solvers.push_back(s);
+                }
+            } else {
+                solvers.clear();
+                std::stringstream ss(v);
+                std::string s;
+                while (std::getline(ss, s, ',')) {
+                    solvers.push_back(std::atoi(s.c_str()));
+                }
+            }
+        } else if (a.find(':')!=std::string::npos) {
+            plants.push_back({ a.substr(0, a.find(':')), std::atof(a.substr(a.find(':') + 1).c_str()) });
+        } else {
+            std::cout << "usage: benchmark_phloem_solvers [-o file.json] [-w window] [-s 1,10,32 | -s all] [plant:age ...]\n";
+            return 1;
+        }
+    }
+    if (plants.empty()) {
+        plants = { { "Triticum_aestivum_adapted_2021", 7. }, { "Triticum_aestivum_adapted_2021", 10. }, { "smallPlant_mgiraud", 14. } };
+    }
+
+    std::vector<Run> runs;
+    for (const auto& p : plants) {
+        auto plant = makePlant(p.first, p.second);
+        int nodes = plant->nodes.size();
+        for (int solver : solvers) {
+            Run run;
+            run.plant = p.first;
+            run.age = p.second;
+            run.nodes = nodes;
+            run.solver = solver;
+            if (solver<1 || solver>35) {
+                run.status = "error";
+                run.message = "solver # must be within the range [1, 35]";
+            } else if (matrixSize(solver, 9.*nodes)>5e7) {
+                run.status = "skipped";
+            } else {
+                std::shared_ptr<PhloemFlux> r;
+                auto t0 = std::chrono::steady_clock::now();
+                try {
+                    r = makePhloem(plant, p.second, solver);
+                    t0 = std::chrono::steady_clock::now();
+                    r->startPM(p.second, p.second + window, 1, 293.15, false, "benchmark_phloem_solvers.txt");
+                    if (r->solverStats.count("flag")) {
+                        run.status = "failed";
+                    }
+                } catch (const std::exception& e) {
+                    run.status = "error";
+                    run.message = e.what();
+                }
+                run.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                if (r) {
+                    run.stats = r->solverStats;
+                }
+            }
+            runs.push_back(run);
+            std::cout << "\n" << run.plant << "\t" << run.age << "\t" << run.nodes << "\t" << run.solver << "\t" << run.status
+                << "\t" << run.time << " s" << std::flush;
+        }
+    }
+
+    auto stat = [](const Run& r, const std::string& name) { return r.stats.count(name) ? r.stats.at(name) : 0; };
+    std::cout << "\n\nplant\tage (d)\tnodes\tsolver\tstatus\ttime (s)\tsteps\tRHS evaluations\tsetups\n";
+    for (const auto& r : runs) {
+        std::cout << r.plant << "\t" << r.age << "\t" << r.nodes << "\t" << r.solver << "\t" << r.status << "\t" << r.time << "\t"
+            << stat(r, "nst") << "\t" << stat(r, "nfe") + stat(r, "nfeLS") << "\t" << stat(r, "nsetups") << "\n";
+    }
+    std::ofstream out(filename);
+    writeJson(out, window, runs);
+    std::cout << "\nresults written to " << filename << "\n";
+    return 0;
+}
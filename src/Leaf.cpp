@@ -135,9 +135,7 @@ void Leaf::simulate(double dt, bool verbose)
 		if (age>0) { // unborn leafs have no children
 
 			// children first (lateral leafs grow even if base leaf is inactive)
-			for (auto l:children) {
-				l->simulate(dt,verbose);
-			}
+			plant.lock()->simulateOrgans(children, dt, verbose);
 
 			if (active) {
 
@@ -771,6 +769,7 @@ void Leaf::rel2abs()
 		nodes[i] = nodes[i-1].plus(newdx);
 		
 	}
+	findMovedNodes();
 	if(this->ageDependentTropism && tropismChange){
 		this->ageDependentTropism = false; //switch done
 	}
@@ -789,6 +788,7 @@ void Leaf::rel2abs()
  */
 void Leaf::abs2rel()
 {
+	saveNodes();
 	for (int j = nodes.size(); j>1; j--) {
 		nodes[j-1] = nodes.at(j-1).minus(nodes.at(j-2));
 		}
@@ -2,13 +2,20 @@
 #include "MappedOrganism.h"
 
 #include "SegmentAnalyser.h"
+#include "ThreadPool.h"
 #include "growth.h"
 #include <algorithm>
 #include <functional>
 #include <cmath>
+#include <limits>
+#include <array>
+#include <typeinfo>
+#include <utility>
 
 namespace CPlantBox {
 
+constexpr int MappedSegments::unmapped;
+
 /**
  * A static plant, as needed for flux computations, represented as
  *
@@ -110,8 +117,7 @@ void MappedSegments::setSoilGrid(const std::function<int(double,double,double)>&
  */
 void MappedSegments::setSoilGrid(const std::function<int(double,double,double)>& s) {
 	soil_index = s;
-	seg2cell.clear(); // re-map all segments
-	cell2seg.clear();
+	clearMappers(); // re-map all segments
 	mapSegments(segments);
 }
 
@@ -135,126 +141,332 @@ void MappedSegments::setRectangularGrid(Vector3d min, Vector3d max, Vector3d res
 	}
 	// std::cout << "setRectangularGrid: sort \n" << std::flush;
 	sort(); // todo should not be necessary, or only in case of cutting?
-	seg2cell.clear(); // re-map all segments
-	cell2seg.clear();
+	clearMappers(); // re-map all segments
 	// std::cout << "setRectangularGrid: map \n" << std::flush;
 	mapSegments(segments);
 }
 
 
 /**
- * Update the mappers root2cell, which maps root segment index to soil cell index, and
- * cell2seg which maps soil cell index to multiple root segments.
+ * Update the mapper seg2cell, which maps root segment index to soil cell index.
+ * The mapper from soil cell index to multiple root segments is rebuilt when it is used next (@see getCell2SegOffsets).
  *
  * @param segs      the (new) segments that need to be mapped
  */
 void MappedSegments::mapSegments(const std::vector<Vector2i>& segs) {
-	for (auto& ns : segs) {
-		Vector3d mid = (nodes[ns.x].plus(nodes[ns.y])).times(0.5);
-		int cellIdx = soil_index(mid.x,mid.y,mid.z);
-		int segIdx = ns.y-1; // this is unique in a tree like structured
-		seg2cell[segIdx] = cellIdx;
-		if (cell2seg.count(cellIdx)>0) {
-			cell2seg[cellIdx].push_back(segIdx);
-		} else {
-			cell2seg[cellIdx] = std::vector<int>({segIdx});
+	std::vector<Vector3d> mids(segs.size());
+	for (int i = 0; i<segs.size(); i++) {
+		mids[i] = (nodes[segs[i].x].plus(nodes[segs[i].y])).times(0.5);
+	}
+	auto cells = soilIndices(mids);
+	for (int i = 0; i<segs.size(); i++) {
+		int segIdx = segs[i].y-1; // this is unique in a tree like structured
+		if (segIdx>=seg2cell.size()) {
+			seg2cell.resize(std::max(segIdx+1, int(segments.size())), unmapped);
+		}
+		seg2cell[segIdx] = cells[i];
+	}
+	cell2segValid = false;
+}
+
+/**
+ * Maps the segments ending in the moved nodes @param nodeIndices again, if their mid point left the soil cell
+ * (or if their end point left the cell in case of cutting, @see setRectangularGrid)
+ */
+void MappedSegments::remapSegments(const std::vector<int>& nodeIndices) {
+	std::vector<Vector3d> points;
+	points.reserve((cutAtGrid ? 2 : 1)*nodeIndices.size());
+	for (int i : nodeIndices) {
+		auto s = segments.at(i-1);
+		points.push_back((nodes[s.x].plus(nodes[s.y])).times(0.5));
+		if (cutAtGrid) {
+			points.push_back(nodes[s.y]);
+		}
+	}
+	auto cells = soilIndices(points);
+	std::vector<Vector2i> rSegs;
+	int c = 0;
+	for (int i : nodeIndices) {
+		int segIdx = i -1;
+		int cellIdx = getCellIndex(segIdx);
+		// 1. check if mid is still in same cell (otherwise, remove, and add again)
+		// 2. if cut is on, check if end point is in same cell than mid point (otherwise remove and add again)
+		bool remove = (cells[c++]!=cellIdx);
+		if (cutAtGrid) {
+			remove = remove || (cells[c++]!=cellIdx);
+		}
+		if (remove) {
+			rSegs.push_back(segments[segIdx]);
+		}
+	}
+	unmapSegments(rSegs);
+	mapSegments(rSegs);
+}
+
+/**
+ * Removes all segments from the mappers
+ */
+void MappedSegments::clearMappers() {
+	seg2cell.clear();
+	cell2segValid = false;
+}
+
+/**
+ * Rebuilds the soil cell to segment mapper (compressed row storage) from seg2cell, if seg2cell has changed.
+ * Segments are sorted by cell index, and by segment index within a cell. Segments outside the soil domain are not included.
+ */
+void MappedSegments::updateCell2Seg() const {
+	if (cell2segValid) {
+		return;
+	}
+	int nc = 0; // number of cells
+	for (int c : seg2cell) {
+		nc = std::max(nc, c+1);
+	}
+	cell2segOffsets.assign(nc+1, 0);
+	for (int c : seg2cell) {
+		if (c>=0) {
+			cell2segOffsets[c+1]++;
 		}
 	}
+	for (int c = 0; c<nc; c++) {
+		cell2segOffsets[c+1] += cell2segOffsets[c];
+	}
+	cell2segIndices.resize(cell2segOffsets[nc]);
+	std::vector<int> next(cell2segOffsets.begin(), cell2segOffsets.end()-1);
+	for (int si = 0; si<seg2cell.size(); si++) {
+		int c = seg2cell[si];
+		if (c>=0) {
+			cell2segIndices[next[c]++] = si;
+		}
+	}
+	cell2segValid = true;
+}
+
+/**
+ * @return CSR offsets of the soil cell to segment mapper, the segments of cell c are
+ * getCell2SegIndices()[offsets[c]] ... getCell2SegIndices()[offsets[c+1]-1] (invalid after the segments are mapped again)
+ */
+const std::vector<int>& MappedSegments::getCell2SegOffsets() const {
+	updateCell2Seg();
+	return cell2segOffsets;
 }
 
 /**
- * Cuts segments @param segs at a rectangular grid (@see MappedSegments::setSoilGrid)
+ * @return segment indices of the soil cell to segment mapper, sorted by cell index (@see getCell2SegOffsets)
+ */
+const std::vector<int>& MappedSegments::getCell2SegIndices() const {
+	updateCell2Seg();
+	return cell2segIndices;
+}
+
+/**
+ * @return the segment to soil cell mapper as map (segment index -> cell index), containing all mapped segments
+ */
+std::map<int, int> MappedSegments::getSeg2CellMap() const {
+	std::map<int, int> map;
+	for (int si = 0; si<seg2cell.size(); si++) {
+		if (seg2cell[si]!=unmapped) {
+			map.emplace_hint(map.end(), si, seg2cell[si]);
+		}
+	}
+	return map;
+}
+
+/**
+ * Sets the segment to soil cell mapper from a map (segment index -> cell index), segments that are not contained are unmapped
+ */
+void MappedSegments::setSeg2CellMap(const std::map<int, int>& map) {
+	int n = map.empty() ? 0 : map.rbegin()->first+1;
+	seg2cell.assign(std::max(n, int(segments.size())), unmapped);
+	for (const auto& sc : map) {
+		seg2cell.at(sc.first) = sc.second;
+	}
+	cell2segValid = false;
+}
+
+/**
+ * @return the soil cell to segment mapper as map (cell index -> segment indices), segments outside the soil domain are listed under cell -1
+ */
+std::map<int, std::vector<int>> MappedSegments::getCell2SegMap() const {
+	std::map<int, std::vector<int>> map;
+	for (int si = 0; si<seg2cell.size(); si++) {
+		if (seg2cell[si]==-1) {
+			map[-1].push_back(si);
+		}
+	}
+	const auto& offsets = getCell2SegOffsets();
+	for (int c = 0; c<int(offsets.size())-1; c++) {
+		if (offsets[c+1]>offsets[c]) {
+			map.emplace_hint(map.end(), c, std::vector<int>(cell2segIndices.begin()+offsets[c], cell2segIndices.begin()+offsets[c+1]));
+		}
+	}
+	return map;
+}
+
+/**
+ * Cuts all segments at the faces of the rectangular grid (@see MappedSegments::setRectangularGrid).
+ *
+ * The cut positions of each segment are found by a 3D-DDA voxel traversal (Amanatides and Woo, 1987, @see segmentCuts),
+ * in parallel if cutThreads > 0. Segments are only cut between different cells of soil_index (or soil_indices), a custom
+ * mapper is called serially. The new nodes get linearly interpolated creation times.
+ * The last piece of a cut segment stays at the segment index, the other pieces are appended.
  */
 void MappedSegments::cutSegments() {
 	assert(segments.size()==radii.size() && "MappedSegments::addSegments: number of segments and radii disagree!");
 	assert(segments.size()==subTypes.size() && "MappedSegments::addSegments: number of segments and subTypes disagree!");
 	assert(segments.size()==organTypes.size() && "MappedSegments::addSegments: number of segments and organTypes disagree!");
-	int n = segments.size(); // segs.size() will change within the loop (recursive implementation)
-	for (int i=0; i<n; i++ ) {
-		addSegment(segments[i], radii[i], subTypes[i], organTypes[i], i);
+	int n = segments.size();
+	std::vector<std::vector<double>> cuts(n); // cut positions per segment, 0 < t < 1
+	auto cutRange = [this, &cuts](int i0, int i1) {
+		for (int i = i0; i<i1; i++) {
+			cuts[i] = segmentCuts(segments[i]);
+		}
+	};
+	if (cutThreads>0) {
+		ThreadPool pool(cutThreads-1);
+		ThreadPool::TaskGroup group;
+		int chunk = std::max(1024, n/(8*cutThreads)+1);
+		for (int i0 = 0; i0<n; i0 += chunk) {
+			pool.run(group, [cutRange, i0, n, chunk] { cutRange(i0, std::min(i0+chunk, n)); });
+		}
+		pool.wait(group);
+	} else {
+		cutRange(0, n);
+	}
+	if (soil_indices || !hasDefaultSoilIndex()) { // custom mapper: one call for the pieces of all segments
+		std::vector<Vector3d> mids;
+		for (int i = 0; i<n; i++) {
+			if (!cuts[i].empty()) {
+				auto m = pieceMids(segments[i], cuts[i]);
+				mids.insert(mids.end(), m.begin(), m.end());
+			}
+		}
+		auto cells = soilIndices(mids);
+		int c = 0;
+		for (int i = 0; i<n; i++) {
+			if (!cuts[i].empty()) {
+				int np = cuts[i].size()+1;
+				keepCellCuts(cuts[i], cells.data() + c);
+				c += np;
+			}
+		}
+	}
+	for (int i = 0; i<n; i++) { // add nodes and segments sequentially, deterministic for any number of threads
+		if (cuts[i].empty()) {
+			continue;
+		}
+		Vector2i s = segments[i];
+		Vector3d n1 = nodes[s.x];
+		Vector3d v = nodes[s.y].minus(n1);
+		double ct1 = nodeCTs[s.x];
+		double dct = nodeCTs[s.y]-ct1;
+		int last = s.x;
+		for (double t : cuts[i]) {
+			nodes.push_back(n1.plus(v.times(t)));
+			nodeCTs.push_back(ct1 + t*dct);
+			int ni = nodes.size()-1;
+			add(Vector2i(last, ni), radii[i], subTypes[i], organTypes[i], -1);
+			last = ni;
+		}
+		add(Vector2i(last, s.y), radii[i], subTypes[i], organTypes[i], i);
 	}
 }
 
 /**
- * Adds and cuts a single segment at index @param ii. If the segment is cut, appends the remaining segments.
- * Used by cutSegments
- * This approach may run into problems if a segment is located exactly along a face.
+ * Cut positions of the segment @param s at the faces of the rectangular grid, by a 3D-DDA voxel traversal.
+ * Faces are only cut if the cells of the default mapper on both sides differ, i.e. faces outside of the domain are ignored.
+ * For a custom mapper (soil_index or soil_indices) all faces are returned, cutSegments removes the cuts within a cell.
+ * Pieces shorter than eps are not created (the segment is not cut there).
  *
- * @param ns 		the segment to add and cut
- * @param r 		segment radius [cm]
- * @param st 		segment sub type
- * @param ot 		segment organ type
- * @param ii		index to insert the segment, -1 to append the segment
- */
-void MappedSegments::addSegment(Vector2i ns, double r,  int st, int ot, int ii) {
-	Vector3d n1 = nodes[ns.x];
-	Vector3d n2 = nodes[ns.y];
-	Vector3d mid = (n1.plus(n2)).times(0.5);
-	int im = soil_index(mid.x,mid.y,mid.z); // cell indices
-	int in1 = soil_index(n1.x,n1.y,n1.z);
-	int in2 = soil_index(n2.x,n2.y,n2.z);
-	if ((im!=in1) or (im!=in2)) { // cut
-		// build SDF
-		auto width = maxBound.minus(minBound); // construct sdf
-		Vector3d dx(width.x/resolution.x, width.y/resolution.y, width.z/resolution.z);
-		auto mid0 = mid.minus(minBound);
-		int x = std::floor(mid0.x/dx.x);
-		int y = std::floor(mid0.y/dx.y);
-		int z = std::floor(mid0.z/dx.z);
-		SDF_Cuboid sdf; // create a signed distance function for cutting
-		Vector3d minB(x*dx.x, y*dx.y, z*dx.z);
-		minB = minB.plus(minBound);
-		Vector3d maxB((x+1)*dx.x, (y+1)*dx.y, (z+1)*dx.z);
-		maxB = maxB.plus(minBound);
-		sdf.min = minB;
-		sdf.max = maxB;
-		// std::cout << minB.toString() << ", " << maxB.toString() << ", width " << width.toString() << ", " << sdf.min.toString() << ", " << sdf.max.toString() << "\n";
-
-		im = sdf.getDist(mid)>0; // redo indices, since accuracy of pickking may differ
-		in1 = sdf.getDist(n1)>0;
-		in2 = sdf.getDist(n2)>0;
-		if ((im!=in1) or (im!=in2)) {
-			Vector3d cPoint;
-			if (im==in1) { // is one node at mid (sort accordingly)
-				// std::cout << "n1 " << sdf.getDist(n1) << " mid " << sdf.getDist(mid) << " n2 " << sdf.getDist(n2) << ",indices "<< in1 << ", " << im << ", " << in2 << "\n";
-				if (sdf.getDist(n2)<0) {
-					cPoint = SegmentAnalyser::cut(n2, mid, std::make_shared<SDF_Cuboid>(sdf), eps);
-				} else {
-					cPoint = SegmentAnalyser::cut(mid, n2, std::make_shared<SDF_Cuboid>(sdf), eps);
-				}
-				nodeCTs.push_back(nodeCTs[ns.y]); // todo: we might linearly interpolate
-			} else if (im==in2) {
-				// std::cout << "n2 " << sdf.getDist(n2) << " mid " << sdf.getDist(mid) << " n1 " << sdf.getDist(n1) << ", " << in2 << ", " << im << ", " << in1 << "\n";
-				if (sdf.getDist(n1)<0) {
-					cPoint = SegmentAnalyser::cut(n1, mid, std::make_shared<SDF_Cuboid>(sdf), eps);
-				} else {
-					cPoint = SegmentAnalyser::cut(mid, n1, std::make_shared<SDF_Cuboid>(sdf), eps);
-				}
-				nodeCTs.push_back(nodeCTs[ns.x]); // todo: we might linearly interpolate
-			} else { // otherwise split in mid, use cutSegments on those
-				cPoint = mid;
-				nodeCTs.push_back(0.5*(nodeCTs[ns.x]+nodeCTs[ns.y]));
-			}
-			// std::cout << "[" << n1.toString() << n2.toString() << "] -> [" << nodes[ns.x].toString() << ", " << nodes.back().toString() << "], ["<< nodes.back().toString() << ", " << n2.toString() << "], " << "\n";
-			nodes.push_back(cPoint);
-			Vector2i s1(ns.x, nodes.size()-1);
-			Vector2i s2(nodes.size()-1, ns.y);
-			if ((length(s1)<eps) ||  (length(s2)<eps)) { // if the cut segments are too small, just give up
-				add(ns, r, st, ot, ii);
-				nodes.pop_back(); // remove cPoint
-				nodeCTs.pop_back();
-			} else {
-				addSegment(s1, r, st , ot, ii); // first segment replaces at index ii
-				addSegment(s2, r, st , ot, -1); // append second segment
-			}
-		} else { // im==in1==in2, dont't cut
-			// std::cout << "ok " << ii <<": (" << ns.x <<", " << ns.y << ") [" << n1.toString() <<", "<< n2.toString() <<"\n";
-			add(ns, r, st, ot, ii);
+ * @return cut positions 0 < t < 1 along the segment (ascending), the cut points are nodes[s.x] + t*(nodes[s.y]-nodes[s.x])
+ */
+std::vector<double> MappedSegments::segmentCuts(const Vector2i& s) const {
+	const Vector3d n1 = nodes.at(s.x);
+	const Vector3d v = nodes.at(s.y).minus(n1);
+	const double l = v.length();
+	std::vector<double> cuts;
+	if (l<2*eps) {
+		return cuts;
+	}
+	const auto w = maxBound.minus(minBound);
+	const std::array<double,3> a = { n1.x, n1.y, n1.z }, d = { v.x, v.y, v.z };
+	const std::array<double,3> m = { minBound.x, minBound.y, minBound.z };
+	const std::array<double,3> h = { w.x/resolution.x, w.y/resolution.y, w.z/resolution.z }; // cell widths
+	std::array<double,3> tMax; // position of the next face in each direction
+	std::array<int,3> k; // index of the next face in each direction
+	std::array<int,3> step;
+	for (int i = 0; i<3; i++) {
+		double k0 = (a[i]-m[i])/h[i];
+		if (d[i]>0) {
+			step[i] = 1;
+			k[i] = std::floor(k0)+1;
+		} else if (d[i]<0) {
+			step[i] = -1;
+			k[i] = std::ceil(k0)-1;
+		} else {
+			step[i] = 0;
+			tMax[i] = std::numeric_limits<double>::infinity();
+			continue;
+		}
+		tMax[i] = (m[i]+k[i]*h[i]-a[i])/d[i];
+	}
+	double last = 0.; // last cut
+	while (true) {
+		int i = (tMax[0]<tMax[1]) ? ((tMax[0]<tMax[2]) ? 0 : 2) : ((tMax[1]<tMax[2]) ? 1 : 2);
+		double t = tMax[i];
+		if ((1.-t)*l<eps) {
+			break;
+		}
+		if ((t-last)*l>=eps) {
+			cuts.push_back(t);
+			last = t;
 		}
-	} else { // im==in1==in2, dont't cut
-		// std::cout << "ok " << ii <<": (" << ns.x <<", " << ns.y << ") [" << n1.toString() <<", "<< n2.toString() <<"\n";
-		add(ns, r, st, ot, ii);
+		k[i] += step[i];
+		tMax[i] = (m[i]+k[i]*h[i]-a[i])/d[i];
+	}
+	if (cuts.empty() || soil_indices || !hasDefaultSoilIndex()) {
+		return cuts; // a custom mapper is evaluated by cutSegments (serially, it may be a Python callback)
 	}
+	auto mids = pieceMids(s, cuts);
+	std::vector<int> cells(mids.size());
+	for (int j = 0; j<mids.size(); j++) {
+		cells[j] = soil_index_(mids[j].x, mids[j].y, mids[j].z);
+	}
+	keepCellCuts(cuts, cells.data());
+	return cuts;
+}
+
+/**
+ * Mid points of the pieces of the segment @param s cut at the positions @param cuts (@see segmentCuts)
+ */
+std::vector<Vector3d> MappedSegments::pieceMids(const Vector2i& s, const std::vector<double>& cuts) const {
+	const Vector3d n1 = nodes.at(s.x);
+	const Vector3d v = nodes.at(s.y).minus(n1);
+	std::vector<Vector3d> mids(cuts.size()+1);
+	double t0 = 0.;
+	for (int j = 0; j<=cuts.size(); j++) {
+		double t1 = (j<cuts.size()) ? cuts[j] : 1.;
+		mids[j] = n1.plus(v.times(0.5*(t0+t1)));
+		t0 = t1;
+	}
+	return mids;
+}
+
+/**
+ * Keeps only the cuts between pieces in different cells
+ *
+ * @param cuts 		cut positions of a segment (@see segmentCuts)
+ * @param cells 	cell index per piece, cuts.size()+1 entries
+ */
+void MappedSegments::keepCellCuts(std::vector<double>& cuts, const int* cells) {
+	int c = 0;
+	for (int j = 0; j<cuts.size(); j++) {
+		if (cells[j]!=cells[j+1]) {
+			cuts[c++] = cuts[j];
+		}
+	}
+	cuts.resize(c);
 }
 
 /**
@@ -280,6 +492,57 @@ void MappedSegments::add(Vector2i s, double r,  int st, int ot,  int i) {
 	}
 }
 
+/**
+ * Copies the changes of the last time step from the segment store @param s of an organism (@see Organism::getSegmentStore)
+ * in one pass: moves the nodes that were moved, appends the new nodes, and adds the new segments.
+ * Radii, sub types, and organ types of the new segments are copied from the store.
+ *
+ * @param s 				segment store of the organism, after its time step
+ * @param oldNumberOfNodes 	number of nodes before the time step
+ * @param verbose 			turns console output on or off
+ * @return indices of the new segments
+ */
+std::vector<int> MappedSegments::addStep(const SegmentStore& s, int oldNumberOfNodes, bool verbose) {
+	for (int i : s.updatedNodeIndices) { // move nodes
+		nodes.at(i) = Vector3d(s.nodes[3*i], s.nodes[3*i+1], s.nodes[3*i+2]);
+		nodeCTs.at(i) = s.nodeCTs[i];
+	}
+	if (verbose) {
+		std::cout << "nodes moved "<< s.updatedNodeIndices.size() << "\n" << std::flush;
+	}
+	int n = s.nodeCTs.size();
+	nodes.reserve(n);
+	nodeCTs.reserve(n);
+	for (int i = oldNumberOfNodes; i<n; i++) { // add nodes
+		nodes.push_back(Vector3d(s.nodes[3*i], s.nodes[3*i+1], s.nodes[3*i+2]));
+		nodeCTs.push_back(s.nodeCTs[i]);
+	}
+	if (verbose) {
+		std::cout << "new nodes added " << std::max(n-oldNumberOfNodes, 0) << "\n" << std::flush;
+	}
+	std::vector<int> newSegs;
+	for (int k = std::max(oldNumberOfNodes-1, 0); k<s.organIds.size(); k++) { // add segments (TODO cutting)
+		if (s.organIds[k]>=0) {
+			newSegs.push_back(k);
+		}
+	}
+	int ns = segments.size()+newSegs.size();
+	segments.resize(ns);
+	radii.resize(ns);
+	subTypes.resize(ns);
+	organTypes.resize(ns);
+	for (int k : newSegs) {
+		segments.at(k) = Vector2i(s.segments[2*k], s.segments[2*k+1]);
+		radii[k] = s.radii[k];
+		subTypes[k] = s.subTypes[k];
+		organTypes[k] = s.organTypes[k];
+	}
+	if (verbose) {
+		std::cout << "Number of segments " << ns << ", including " << newSegs.size() << " new \n"<< std::flush;
+	}
+	return newSegs;
+}
+
 /**
  * Length of the segment @param s
  */
@@ -292,35 +555,19 @@ double MappedSegments::length(const Vector2i& s) const {
  */
 void MappedSegments::unmapSegments(const std::vector<Vector2i>& segs) {
 	for (auto& ns : segs) {
-		int cellIdx = -1;
 		int segIdx = ns.y-1;
-		if (seg2cell.count(segIdx)>0) { // remove from seg2cell
-			cellIdx = seg2cell[segIdx];
-			auto it = seg2cell.find(segIdx);
-			seg2cell.erase(it);
-		} else {
+		if ((segIdx<0) || (segIdx>=seg2cell.size()) || (seg2cell[segIdx]==unmapped)) {
 			throw std::invalid_argument("MappedSegments::removeSegments: warning segment index "+ std::to_string(segIdx)+ " was not found in the seg2cell mapper");
 		}
-		if (cell2seg.count(cellIdx)>0) {
-			auto& csegs= cell2seg[cellIdx];
-			int c = 0;
-			for (int i=0; i<csegs.size(); i++) {
-				if (csegs[i] == segIdx) {
-					csegs.erase(csegs.begin() + c, csegs.begin() + c);
-					break; // inner for
-				}
-				c++;
-			}
-		} else {
-			throw std::invalid_argument("MappedSegments::removeSegments: warning cell index "+ std::to_string(cellIdx)+ " was not found in the cell2seg mapper");
-		}
+		seg2cell[segIdx] = unmapped;
 	}
+	cell2segValid = false;
 }
 
 /**
  * Maps a point into a cell and return the cells linear index (for a equidistant rectangular domain)
  */
-int MappedSegments::soil_index_(double x, double y, double z) {
+int MappedSegments::soil_index_(double x, double y, double z) const {
 	Vector3d p(x,y,z);
 	std::array<double,3>  r = { resolution.x, resolution.y, resolution.z};
 	auto w = maxBound.minus(minBound);
@@ -334,6 +581,77 @@ int MappedSegments::soil_index_(double x, double y, double z) {
 	return std::floor(i[2]) * r[0] * r[1] + std::floor(i[1]) * r[0] + std::floor(i[0]); // a linear index not periodic
 }
 
+/**
+ * Maps the @param points into the cells of an equidistant rectangular domain (@see soil_index_),
+ * branch free, so that the compiler can vectorize the loop
+ *
+ * @param cells 	linear cell indices, -1 for points out of the domain (output)
+ */
+void MappedSegments::soil_indices_(const std::vector<Vector3d>& points, std::vector<int>& cells) const {
+	const double rx = resolution.x, ry = resolution.y, rz = resolution.z;
+	const int nx = int(rx), ny = int(ry);
+	const auto w = maxBound.minus(minBound);
+	const double mx = minBound.x, my = minBound.y, mz = minBound.z;
+	const int n = points.size();
+	cells.resize(n);
+	std::vector<double> px(n), py(n), pz(n); // contiguous coordinates, so that the loop below vectorizes
+	for (int k = 0; k<n; k++) {
+		px[k] = points[k].x;
+		py[k] = points[k].y;
+		pz[k] = points[k].z;
+	}
+	int* c = cells.data();
+	for (int k = 0; k<n; k++) {
+		double ix = (px[k]-mx)/w.x*rx; // same operations as soil_index_
+		double iy = (py[k]-my)/w.y*ry;
+		double iz = (pz[k]-mz)/w.z*rz;
+		bool in = (ix>=0) & (ix<rx) & (iy>=0) & (iy<ry) & (iz>=0) & (iz<rz);
+		int i = int(in ? ix : 0.), j = int(in ? iy : 0.), l = int(in ? iz : 0.); // == floor within the domain (std::floor does not vectorize)
+		c[k] = in ? (l*ny + j)*nx + i : -1;
+	}
+}
+
+/**
+ * @return true, if soil_index is the default mapper MappedSegments::soil_index_
+ */
+bool MappedSegments::hasDefaultSoilIndex() const {
+	typedef decltype(std::bind(&MappedSegments::soil_index_, std::declval<MappedSegments*>(),
+		std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)) DefaultSoilIndex;
+	return soil_index && (soil_index.target_type()==typeid(DefaultSoilIndex));
+}
+
+/**
+ * Soil cell indices of many points in one call: uses the batch callback soil_indices if it is set,
+ * a vectorized version of the default mapper, or calls soil_index per point otherwise
+ *
+ * @param points 	spatial coordinates [cm]
+ * @return cell index per point [1]
+ */
+std::vector<int> MappedSegments::soilIndices(const std::vector<Vector3d>& points) {
+	std::vector<int> cells;
+	if (soil_indices) {
+		std::vector<double> x(points.size()), y(points.size()), z(points.size());
+		for (int k = 0; k<points.size(); k++) {
+			x[k] = points[k].x;
+			y[k] = points[k].y;
+			z[k] = points[k].z;
+		}
+		cells = soil_indices(x, y, z);
+		if (cells.size()!=points.size()) {
+			throw std::runtime_error("MappedSegments::soilIndices: soil_indices returned "+ std::to_string(cells.size())+ " cell indices for "
+				+ std::to_string(points.size())+ " points");
+		}
+	} else if (hasDefaultSoilIndex()) {
+		soil_indices_(points, cells);
+	} else {
+		cells.resize(points.size());
+		for (int k = 0; k<points.size(); k++) {
+			cells[k] = soil_index(points[k].x, points[k].y, points[k].z);
+		}
+	}
+	return cells;
+}
+
 /**
  * Sorts the segments, so that the segment index == second node index -1 (unique mapping in a tree)
  */
@@ -366,14 +684,27 @@ std::vector<double> MappedSegments::segOuterRadii(int type, const std::vector<do
 	auto width = maxBound.minus(minBound);
 	std::vector<double> outer_radii = std::vector<double>(segments.size());
 	std::fill(outer_radii.begin(), outer_radii.end(), 0.);
-	for(auto iter = cell2seg.begin(); iter != cell2seg.end(); ++iter) {
-		int cellId =  iter->first;
+	const auto& offsets = getCell2SegOffsets();
+	std::vector<int> segs;
+	for (int cellId = -1; cellId<int(offsets.size())-1; cellId++) {
+		if (cellId<0) { // segments outside of the soil domain
+			segs.clear();
+			for (int si = 0; si<seg2cell.size(); si++) {
+				if (seg2cell[si]==-1) {
+					segs.push_back(si);
+				}
+			}
+		} else {
+			segs.assign(cell2segIndices.begin()+offsets[cellId], cell2segIndices.begin()+offsets[cellId+1]);
+		}
+		if (segs.empty()) {
+			continue;
+		}
 		if (vols.size()==0) {
 			cellVolume = width.x*width.y*width.z/resolution.x/resolution.y/resolution.z;
 		} else {
 			cellVolume = vols.at(cellId);
 		}
-		auto segs = cell2seg.at(cellId);
 		double v = 0.;  // calculate sum of root volumes or surfaces over cell
 		for (int i : segs) {
 			if (type==0) { // volume
@@ -481,82 +812,18 @@ void MappedRootSystem::simulate(double dt, bool verbose)
 
 	RootSystem::simulate(dt,verbose);
 
-	auto uni = this->getUpdatedNodeIndices(); // move nodes
-	auto unodes = this->getUpdatedNodes();
-	assert(uni.size()==unodes.size() && "updated node indices and number of nodes must be equal");
-	int c = 0;
-	for (int i : uni) {
-		nodes.at(i) = unodes[c];
-		c++;
-	}
-	if (verbose) {
-		std::cout << "nodes moved "<< uni.size() << "\n" << std::flush;
-	}
-	auto newnodes = this->getNewNodes(); // add nodes
-	nodes.reserve(nodes.size()+newnodes.size());
-	for (auto& nn : newnodes) {
-		nodes.push_back(nn);
-	}
-	auto newnode_cts = this->getNewNodeCTs(); // add node cts
-	nodeCTs.reserve(nodeCTs.size()+newnode_cts.size());
-	for (auto& nct : newnode_cts) {
-		nodeCTs.push_back(nct);
-	}
-	if (verbose) {
-		std::cout << "new nodes added " << newnodes.size() << "\n" << std::flush;
-	}
-	auto newsegs = this->getNewSegments(); // add segments (TODO cutting)
-	segments.resize(segments.size()+newsegs.size());
-	for (auto& ns : newsegs) {
-		segments[ns.y-1] = ns;
-	}
-	if (verbose) {
-		std::cout << "segments added "<< newsegs.size() << "\n" << std::flush;
-	}
-	auto newsegO = this->getNewSegmentOrigins(); // to add radius and type (TODO cutting)
-	radii.resize(radii.size()+newsegO.size());
-	subTypes.resize(subTypes.size()+newsegO.size());
-	organTypes.resize(organTypes.size()+newsegO.size());
-	c = 0;
-	if (verbose) {
-		std::cout << "Number of segments " << radii.size() << ", including " << newsegO.size() << " new \n"<< std::flush;
-	}
-	for (auto& so : newsegO) {
-		int segIdx = newsegs[c].y-1;
-		c++;
-		radii[segIdx] = so->getParam()->a;
-		subTypes[segIdx] = so->getParam()->subType;
-		organTypes[segIdx] = so->organType();
-	}
+	const auto& store = getSegmentStore(); // changes of the time step
+	auto newSegs = addStep(store, oldNumberOfNodes, verbose);
+
 	// map new segments
-	this->mapSegments(newsegs);
+	std::vector<Vector2i> segs(newSegs.size());
+	for (int i = 0; i<newSegs.size(); i++) {
+		segs[i] = segments[newSegs[i]];
+	}
+	this->mapSegments(segs);
 
 	// update segments of moved nodes
-	std::vector<Vector2i> rSegs;
-	for (int i : uni) {
-		int segIdx = i -1;
-		int cellIdx = seg2cell[segIdx];
-		auto s = segments[segIdx];
-		Vector3d mid = (nodes[s.x].plus(nodes[s.y])).times(0.5);
-		int newCellIdx = soil_index(mid.x,mid.y,mid.z);
-		// 1. check if mid is still in same cell (otherwise, remove, and add again)
-		// 2. if cut is on, check if end point is in same cell than mid point (otherwise remove and add again)
-		bool remove = false;
-		if (cellIdx==newCellIdx) {
-			if (cutAtGrid) {
-				auto endPoint = nodes[s.y];
-				newCellIdx = soil_index(endPoint.x,endPoint.y,endPoint.z);
-				remove = (newCellIdx!=cellIdx);
-			}
-		} else {
-			remove = true;
-		}
-		if (remove) {
-			rSegs.push_back(s);
-		}
-	}
-	MappedSegments::unmapSegments(rSegs);
-	MappedSegments::mapSegments(rSegs);
+	MappedSegments::remapSegments(store.updatedNodeIndices);
 }
 
 
@@ -613,65 +880,22 @@ void MappedPlant::simulate(double dt, bool verbose)
 		throw std::invalid_argument("MappedPlant::simulate():soil was not set, use MappedPlant::simulate::setSoilGrid" );
 	}
 	Plant::simulate( dt,  verbose);
-	auto uni = this->getUpdatedNodeIndices(); // move nodes
-	auto unodes = this->getUpdatedNodes();
-	auto uncts = this->getUpdatedNodeCTs();
-	assert(uni.size()==unodes.size() && "updated node indices and number of nodes must be equal");
-	int c = 0;
-	for (int i : uni) {
-		nodes.at(i) = unodes[c];
-		nodeCTs.at(i) = uncts[c];
-		c++;
-	}
 
-	if (verbose) {
-		std::cout << "nodes moved "<< uni.size() << "\n" << std::flush;
-	}
-	auto newnodes = this->getNewNodes(); // add nodes
-	nodes.reserve(nodes.size()+newnodes.size());
-	for (auto& nn : newnodes) {
-		nodes.push_back(nn);
-	}
-	auto newnode_cts = this->getNewNodeCTs(); // add node cts
-	nodeCTs.reserve(nodeCTs.size()+newnode_cts.size());
-	for (auto& nct : newnode_cts) {
-		nodeCTs.push_back(nct);
-	}
-	if (verbose) {
-		std::cout << "new nodes added " << newnodes.size() << "\n" << std::flush;
-	}
-	auto newsegs = this->getNewSegments(); // add segments (TODO cutting)
-	segments.resize(segments.size()+newsegs.size());
-	for (auto& ns : newsegs) {
-		segments[ns.y-1] = ns;
-	}
-	if (verbose) {
-		std::cout << "segments added "<< newsegs.size() << "\n" << std::flush;
-	}
-	auto newsegO = this->getNewSegmentOrigins(); // to add radius and type (TODO cutting)
-	radii.resize(radii.size()+newsegO.size());
-	subTypes.resize(subTypes.size()+newsegO.size());
-	organTypes.resize(organTypes.size()+newsegO.size());
-	segVol.resize(segVol.size()+newsegO.size());
-	bladeLength.resize(bladeLength.size()+newsegO.size());
-	leafBladeSurface.resize(leafBladeSurface.size()+newsegO.size()); 
-	c = 0;
-	if (verbose) {
-		std::cout << "Number of segments " << radii.size() << ", including " << newsegO.size() << " new \n"<< std::flush;
-	}
-	std::vector<int> vsegIdx;
-	for (auto& so : newsegO) {
-		int segIdx = newsegs[c].y-1;
-		vsegIdx.push_back(segIdx);
-		radii[segIdx] = so->getParam()->a;
-		organTypes.at(segIdx) = so->organType();
-		subTypes.at(segIdx) = st2newst[std::make_tuple(organTypes[segIdx],so->getParam()->subType)];//new st 
-		
+	const auto& store = getSegmentStore(); // changes of the time step
+	auto newSegs = addStep(store, oldNumberOfNodes, verbose);
+	int ns = segments.size();
+	segVol.resize(ns);
+	bladeLength.resize(ns);
+	leafBladeSurface.resize(ns);
+	for (int segIdx : newSegs) {
+		auto so = store.organs.at(store.organIds[segIdx]);
+		subTypes.at(segIdx) = st2newst[std::make_tuple(organTypes[segIdx],subTypes[segIdx])];//new st
+
 		if(organTypes[segIdx] == Organism::ot_leaf) //leaves can be cylinder, cuboid or characterized by user-defined 2D shape
 		{
 			int index;
 			auto nodeIds = so->getNodeIds();
-			auto it = find(nodeIds.begin(), nodeIds.end(), newsegs[c].y);
+			auto it = find(nodeIds.begin(), nodeIds.end(), segments[segIdx].y);
 			if (it != nodeIds.end()){ index = it - nodeIds.begin() -1;
 			}else { 
 				throw std::runtime_error("MappedPlant::simulate: global segment index not found in organ");
@@ -692,38 +916,17 @@ void MappedPlant::simulate(double dt, bool verbose)
 			bladeLength.at(segIdx) = 0;
 			leafBladeSurface.at(segIdx) = 0;
 		}
-		c++;
 	}
 
 	// map new segments
-	this->mapSegments(newsegs);
+	std::vector<Vector2i> segs(newSegs.size());
+	for (int i = 0; i<newSegs.size(); i++) {
+		segs[i] = segments[newSegs[i]];
+	}
+	this->mapSegments(segs);
 
 	// update segments of moved nodes
-	std::vector<Vector2i> rSegs;
-	for (int i : uni) {
-		int segIdx = i -1;
-		int cellIdx = seg2cell[segIdx];
-		auto s = segments[segIdx];
-		Vector3d mid = (nodes[s.x].plus(nodes[s.y])).times(0.5);
-		int newCellIdx = soil_index(mid.x,mid.y,mid.z);
-		// 1. check if mid is still in same cell (otherwise, remove, and add again)
-		// 2. if cut is on, check if end point is in same cell than mid point (otherwise remove and add again)
-		bool remove = false;
-		if (cellIdx==newCellIdx) {
-			if (cutAtGrid) {
-				auto endPoint = nodes[s.y];
-				newCellIdx = soil_index(endPoint.x,endPoint.y,endPoint.z);
-				remove = (newCellIdx!=cellIdx);
-			}
-		} else {
-			remove = true;
-		}
-		if (remove) {
-			rSegs.push_back(s);
-		}
-	}
-	MappedSegments::unmapSegments(rSegs);
-	MappedSegments::mapSegments(rSegs);
+	MappedSegments::remapSegments(store.updatedNodeIndices);
 	if(kr_length > 0.){calcExchangeZoneCoefs();}
 
 }
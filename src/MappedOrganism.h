@@ -46,11 +46,19 @@ public:
     std::vector<double> segOuterRadii(int type = 0, const std::vector<double>& vols = std::vector<double>(0)) const; ///< outer cylinder radii to match cell volume
     std::vector<double> segLength() const; ///< calculates segment lengths [cm]
 
-    std::map<int, int> seg2cell; // root segment to soil cell mapper
-    std::map<int, std::vector<int>> cell2seg; // soil cell to root segment mapper
+    static constexpr int unmapped = -2; ///< seg2cell entry of a segment that is not mapped (e.g. removed by unmapSegments)
+    std::vector<int> seg2cell; ///< soil cell index per segment, -1 if the segment is not within the soil domain, unmapped if it is not mapped
+    int getCellIndex(int segIdx) const { return ((segIdx>=0) && (segIdx<seg2cell.size()) && (seg2cell[segIdx]>=0)) ? seg2cell[segIdx] : -1; } ///< soil cell index of a segment, -1 if outside or not mapped
+    const std::vector<int>& getCell2SegOffsets() const; ///< soil cell to segment mapper (CSR), the segments of cell c are at [offsets[c], offsets[c+1])
+    const std::vector<int>& getCell2SegIndices() const; ///< segment indices sorted by soil cell (CSR, @see getCell2SegOffsets)
+    std::map<int, int> getSeg2CellMap() const; ///< segment to soil cell map of all mapped segments (copy)
+    void setSeg2CellMap(const std::map<int, int>& map); ///< sets the segment to soil cell mapper from a map
+    std::map<int, std::vector<int>> getCell2SegMap() const; ///< soil cell to segments map, including cell -1 (copy)
 
     std::function<int(double,double,double)> soil_index =
         std::bind(&MappedSegments::soil_index_, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3); ///< soil cell index call back function, (care need all MPI ranks in case of dumux)
+    std::function<std::vector<int>(const std::vector<double>&, const std::vector<double>&, const std::vector<double>&)> soil_indices = nullptr; ///< optional batch version of soil_index, cell indices of points given by coordinate vectors x, y, z
+    std::vector<int> soilIndices(const std::vector<Vector3d>& points); ///< soil cell indices of the points (one call of soil_indices, or the built-in mapper)
 
     std::vector<Vector3d> nodes; ///< nodes [cm]
     std::vector<double> nodeCTs; ///< creation times [days]
@@ -63,6 +71,7 @@ public:
     Vector3d maxBound;
     Vector3d resolution; // cells
     bool cutAtGrid = false;
+    int cutThreads = 0; ///< number of threads used by cutSegments (0 = serial)
 
     const double eps = 1.e-5;
     std::array<std::map<int, std::shared_ptr<OrganRandomParameter>>, 5> plantParam;
@@ -79,12 +88,24 @@ public:
 
 protected:
 
-    void addSegment(Vector2i ns, double radius,  int st,int ot, int i); // adds a single segment at index i, appends the rest if cutted
+    std::vector<double> segmentCuts(const Vector2i& s) const; // positions where the segment crosses the faces of the rectangular grid
+    std::vector<Vector3d> pieceMids(const Vector2i& s, const std::vector<double>& cuts) const; // mid points of the pieces of a cut segment
+    static void keepCellCuts(std::vector<double>& cuts, const int* cells); // removes the cuts within a cell
     void add(Vector2i ns, double radius,  int st, int ot, int i); // adds without cutting, at index i, or appends if i = -1
+    std::vector<int> addStep(const SegmentStore& s, int oldNumberOfNodes, bool verbose); // copies moved nodes, new nodes and new segments of a time step
     double length(const Vector2i& s) const;
 
-    int soil_index_(double x, double y, double z); // default mapper to a equidistant rectangular grid
+    int soil_index_(double x, double y, double z) const; // default mapper to a equidistant rectangular grid
+    void soil_indices_(const std::vector<Vector3d>& points, std::vector<int>& cells) const; // default mapper for many points
+    bool hasDefaultSoilIndex() const; // true, if soil_index is the default mapper soil_index_
+    void remapSegments(const std::vector<int>& nodeIndices); ///< maps the segments ending in moved nodes again, if they left their cell
     void unmapSegments(const std::vector<Vector2i>& segs); ///< remove segments from the mappers
+    void clearMappers(); ///< removes all segments from the mappers
+    void updateCell2Seg() const; ///< rebuilds the CSR soil cell to segment mapper from seg2cell, if it is outdated
+
+    mutable std::vector<int> cell2segOffsets; ///< CSR offsets, per soil cell (number of cells + 1)
+    mutable std::vector<int> cell2segIndices; ///< CSR segment indices
+    mutable bool cell2segValid = false; ///< false, if seg2cell changed since the last update
 
 };
 
@@ -139,8 +160,8 @@ public:
 
 	std::map<std::tuple<int, int>, int > st2newst; // replace subtypes with other int nummer, so that the N subtypes of one organ type go from 0 to N-1
 
-    virtual double rand() override {if(stochastic){return UD(gen);} else {return 0.5; } }  ///< uniformly distributed random number (0,1)
-	virtual double randn() override {if(stochastic){return std::min(std::max(ND(gen),-1.),1.);} else {return 0.5; } }  ///< normally distributed random number (0,1)
+    virtual double rand() override {if(stochastic){return Organism::rand();} else {return 0.5; } }  ///< uniformly distributed random number (0,1)
+	virtual double randn() override {if(stochastic){return std::min(std::max(Organism::randn(),-1.),1.);} else {return 0.5; } }  ///< normally distributed random number (0,1)
 	bool stochastic = true;//< whether or not to implement stochasticity, usefull for test files @see test_relative_coordinates.py
 	//for photosynthesis and phloem module:	   
 	void calcExchangeZoneCoefs() override;					 
@@ -49,7 +49,7 @@ Organ::Organ(std::shared_ptr<Organism> plant, std::shared_ptr<Organ> parent, int
 		Matrix3d iHeading, int pni)
 :iHeading(iHeading), parentNI(pni), plant(plant), parent(parent), id(plant->getOrganIndex()),
   param_(plant->getOrganRandomParameter(ot, st)->realize()), /* root parameters are diced in the getOrganRandomParameter class */
-  age(-delay)
+  randomStream(plant->createRandomStream(id)), age(-delay)
 { }
 
 /*
@@ -135,10 +135,40 @@ void Organ::simulate(double dt, bool verbose)
 	// if the organ is alive, manage children
 	if (alive) {
 		age += dt;
-		for (auto& c : children)  {
-			c->simulate(dt, verbose);
+		plant.lock()->simulateOrgans(children, dt, verbose);
+	}
+}
+
+/**
+ * Replaces the provisional organ and node indices, that were created during a parallel simulation step
+ * (@see Organism::setThreads), by the next unique indices of the organism. Is called for the whole organ tree, depth first,
+ * which makes the numbering independent of the order in which the organs were simulated.
+ * Organs with a new id get a new random number stream keyed by that id.
+ *
+ * @param nodeIndices   maps provisional node indices to final ones (shared nodes, e.g. the first node of a lateral)
+ */
+void Organ::finalizeIndices(std::unordered_map<int,int>& nodeIndices)
+{
+	auto p = plant.lock();
+	if (id<-1) {
+		id = p->getOrganIndex();
+		randomStream = p->createRandomStream(id);
+	}
+	for (auto& ni : nodeIds) {
+		if (ni<-1) {
+			auto it = nodeIndices.find(ni);
+			if (it==nodeIndices.end()) {
+				int fi = p->getNodeIndex();
+				nodeIndices[ni] = fi;
+				ni = fi;
+			} else {
+				ni = it->second;
+			}
 		}
 	}
+	for (auto& c : children) {
+		c->finalizeIndices(nodeIndices);
+	}
 }
 
 /**
@@ -206,6 +236,37 @@ void Organ::moveOrigin(int idx)
 	
 }
 
+/**
+ * Keeps the absolute node coordinates and creation times before the nodes become relative (@see Plant::abs2rel),
+ * so that Organ::findMovedNodes can report the nodes that actually moved during the time step
+ */
+void Organ::saveNodes()
+{
+	oldNodes = nodes;
+	oldNodeCTs = nodeCTs;
+	movedNodes.clear();
+}
+
+/**
+ * Compares the absolute node coordinates and creation times after the time step (@see Plant::rel2abs)
+ * with the ones kept by Organ::saveNodes, and stores the local indices of the old nodes that changed in movedNodes
+ * (e.g. by tropism or internodal growth)
+ */
+void Organ::findMovedNodes()
+{
+	movedNodes.clear();
+	size_t n = std::min(std::min(oldNodes.size(), nodes.size()), std::min(oldNodeCTs.size(), nodeCTs.size()));
+	for (size_t i = 1; i<n; i++) { // the first node belongs to the parent
+		const Vector3d& a = oldNodes[i];
+		const Vector3d& b = nodes[i];
+		if ((a.x!=b.x) || (a.y!=b.y) || (a.z!=b.z) || (oldNodeCTs[i]!=nodeCTs[i])) {
+			movedNodes.push_back(i);
+		}
+	}
+	oldNodes.clear();
+	oldNodeCTs.clear();
+}
+
 /**
  * Adds the node with the next global index to the root
  *
@@ -10,6 +10,7 @@
 #include <memory>
 #include <functional>
 #include <map>
+#include <unordered_map>
 #include <limits>
 
 namespace CPlantBox {
@@ -48,6 +49,8 @@ public:
 
     /* development */
     virtual void simulate(double dt, bool verbose = false); ///< grow for a time span of @param dt
+    RandomStream& getRandomStream() { return randomStream; } ///< random numbers of this organ, used for parallel simulation (@see Organism::setThreads)
+    void finalizeIndices(std::unordered_map<int,int>& nodeIndices); ///< replaces provisional node and organ indices after a parallel step
 
     /* tree */
     void setOrganism(std::shared_ptr<Organism> p) { plant = p; } ///< sets the organism of which the organ is part of
@@ -58,6 +61,7 @@ public:
     void addChild(std::shared_ptr<Organ> c); ///< adds an subsequent organ
     int getNumberOfChildren() { return children.size(); } ///< number of children
     std::shared_ptr<Organ> getChild(int i) { return children.at(i); } /// child with index @param i
+    const std::vector<std::shared_ptr<Organ>>& getChildren() const { return children; } ///< the successive organs
 
     /* parameters */
     int getId() const { return id; } ///< unique organ id
@@ -94,6 +98,7 @@ public:
     /* last time step */
     virtual bool hasMoved() const { return moved; }; ///< have any nodes moved during the last simulate call
     int getOldNumberOfNodes() const { return oldNumberOfNodes; } ///< the number of nodes before the last simulate call
+    const std::vector<int>& getMovedNodes() const { return movedNodes; } ///< local indices of old nodes that moved (or got a new creation time) in the last time step (@see Plant::simulate)
 
     /* for post processing */
     std::vector<std::shared_ptr<Organ>> getOrgans(int ot=-1, bool all = false); ///< the organ including children in a sequential vector
@@ -124,8 +129,9 @@ protected:
     std::vector<std::shared_ptr<Organ>> children; ///< the successive organs
 
     /* Parameters that are constant over the organ life time */
-    const int id; ///< unique organ id
+    int id; ///< unique organ id (only changed by Organ::finalizeIndices)
     std::shared_ptr<const OrganSpecificParameter> param_; ///< the parameter set of this organ (@see getParam())
+    RandomStream randomStream; ///< the organ's random number stream (only used for parallel simulation)
 
     /* Parameters are changing over time */
     bool alive = true; ///< true: alive, false: dead
@@ -142,6 +148,11 @@ protected:
     /* last time step */
     bool moved = false; ///< nodes moved during last time step
     int oldNumberOfNodes = 0; ///< number of nodes at the end of previous time step
+    std::vector<int> movedNodes; ///< local indices of old nodes that moved during the last time step (@see getMovedNodes)
+    std::vector<Vector3d> oldNodes; ///< absolute coordinates at the end of the previous time step, only during Plant::simulate
+    std::vector<double> oldNodeCTs; ///< creation times at the end of the previous time step, only during Plant::simulate
+    void saveNodes(); ///< keeps the absolute coordinates, called by abs2rel
+    void findMovedNodes(); ///< compares the new absolute coordinates with the kept ones, called by rel2abs
 };
 
 } // namespace CPlantBox
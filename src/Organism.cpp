@@ -3,17 +3,30 @@
 
 #include "Organ.h"
 #include "organparameter.h"
+#include "ThreadPool.h"
 
 #include <stdexcept>
 #include <iostream>
 #include <ctime>
 #include <numeric>
+#include <atomic>
+#include <unordered_map>
 
 namespace CPlantBox {
 
 std::vector<std::string> Organism::organTypeNames = { "organ", "seed", "root", "stem", "leaf" };
 int Organism::instances = 0; // number of instances
 
+/**
+ * Organ simulated by the calling thread during a parallel step (@see Organism::simulateOrgans),
+ * its random stream is only used by the organism that runs the step
+ */
+struct StepContext {
+    const Organism* organism = nullptr;
+    RandomStream* stream = nullptr;
+};
+static thread_local StepContext currentStep;
+
 /**
  * Constructs organism, initializes random number generator
  * @param seednum    option to set seed (for creation of random number) default = 0.
@@ -25,6 +38,7 @@ Organism::Organism(double seednum)
 		seed_val = seednum;
 	}else{ seed_val = std::chrono::system_clock::now().time_since_epoch().count()+instances;}
     gen = std::mt19937(seed_val);
+    streamSeed = seed_val;
 };
 
 
@@ -161,10 +175,118 @@ void Organism::simulate(double dt, bool verbose)
 	this->dt = dt;
     oldNumberOfNodes = getNumberOfNodes();
     oldNumberOfOrgans = getNumberOfOrgans();
-    for (const auto& r : baseOrgans) {
-        r->simulate(dt, verbose);
+    if (threads>0) {
+        parallelStep = true;
+        provisionalIndex.value = -1;
+        std::exception_ptr error;
+        try {
+            simulateOrgans(baseOrgans, dt, verbose);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        parallelStep = false;
+        std::unordered_map<int,int> nodeIndices; // provisional to final node indices
+        for (const auto& r : baseOrgans) {
+            r->finalizeIndices(nodeIndices);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    } else {
+        for (const auto& r : baseOrgans) {
+            r->simulate(dt, verbose);
+        }
     }
     simtime+=dt;
+    if (!hasRelCoord()) { // otherwise the store is updated by Plant::simulate (after Plant::rel2abs)
+        updateSegmentStore(true);
+    }
+}
+
+/**
+ * Simulates the organs @param organs in a time span of @param dt days, is called for the base organs,
+ * and by the organs for their children.
+ *
+ * In serial mode the organs are simulated one after another. During a parallel step, each root with laterals
+ * (i.e. its sub tree) becomes a task of the thread pool. Other organs are simulated by the calling thread, stems and leaves
+ * because they share the plant wide phytomer counters, and roots without laterals because they are cheap.
+ * Each organ draws its random numbers from its own stream, so the results do not depend on the number of threads.
+ *
+ * @param organs    the organs to simulate
+ * @param dt        time step [day]
+ * @param verbose   turns console output on or off
+ */
+void Organism::simulateOrgans(const std::vector<std::shared_ptr<Organ>>& organs, double dt, bool verbose)
+{
+    if (!parallelStep) {
+        for (const auto& o : organs) {
+            o->simulate(dt, verbose);
+        }
+        return;
+    }
+    auto simulateOrgan = [this, dt, verbose](const std::shared_ptr<Organ>& o) {
+        RandomStream& stream = o->getRandomStream();
+        if ((stream.key==0) && (stream.counter==0)) { // not yet keyed
+            stream = createRandomStream(o->getId());
+        }
+        StepContext previous = currentStep;
+        currentStep.organism = this;
+        currentStep.stream = &stream;
+        try {
+            o->simulate(dt, verbose);
+        } catch (...) {
+            currentStep = previous;
+            throw;
+        }
+        currentStep = previous;
+    };
+    auto isTask = [](const std::shared_ptr<Organ>& o) { // roots with laterals, the others are too small to pay off
+        return (o->organType()==Organism::ot_root) && (o->getNumberOfChildren()>0);
+    };
+    ThreadPool::TaskGroup group;
+    for (const auto& o : organs) {
+        if (isTask(o)) {
+            threadPool->run(group, [simulateOrgan, o] { simulateOrgan(o); });
+        }
+    }
+    std::exception_ptr error;
+    try {
+        for (const auto& o : organs) {
+            if (!isTask(o)) {
+                simulateOrgan(o);
+            }
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    threadPool->wait(group); // tasks must finish before rethrowing
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * Sets the number of threads used by Organism::simulate.
+ *
+ * For n = 0 (default) organs are simulated serially, and all random numbers are drawn from the organism's generator.
+ * For n > 0 organs draw from their own counter based random number streams (@see RandomStream), keyed by the organ id,
+ * and root sub trees are simulated in parallel. Results are identical for any n > 0, but differ from the serial mode.
+ * Node and organ indices created in a parallel step are provisional, and are renumbered deterministically
+ * (depth first in organ order) at the end of the step (@see Organ::finalizeIndices).
+ *
+ * @param n         number of threads (including the calling thread)
+ */
+void Organism::setThreads(int n)
+{
+    if (n<0) {
+        throw std::invalid_argument("Organism::setThreads: number of threads must be >= 0");
+    }
+    threads = n;
+    if (n>0) {
+        threadPool = std::make_shared<ThreadPool>(n-1);
+    } else {
+        threadPool = nullptr;
+    }
 }
 
 /**
@@ -229,12 +351,7 @@ double Organism::getSummed(std::string name, int ot) const
  */
 int Organism::getNumberOfSegments(int ot) const
 {
-    int s=0;
-    auto organs = getOrgans(ot);
-    for (const auto& o : organs) {
-        s += o->getNumberOfSegments();
-    }
-    return s;
+    return getSegmentStore().getNumberOfSegments(ot);
 }
 
 /**
@@ -285,15 +402,10 @@ std::vector<std::vector<double>> Organism::getPolylineCTs(int ot) const
  */
 std::vector<Vector3d> Organism::getNodes() const
 {
-    auto organs = getOrgans();
-	std::vector<Vector3d> nv = std::vector<Vector3d>(getNumberOfNodes()); // reserve big enough vector
-	for (const auto& o : baseOrgans) { // copy initial nodes (even if organs have not developed)
-		nv.at(o->getNodeId(0)) = o->getNode(0);
-    }
-	for (const auto& o : organs) { // copy all organ nodes
-		for (size_t i = 1; i<o->getNumberOfNodes(); i++) { // since all base nodes are stored twice as base and along root
-			nv.at(o->getNodeId(i)) = o->getNode(i);
-        }
+    const auto& s = getSegmentStore();
+    std::vector<Vector3d> nv = std::vector<Vector3d>(s.nodeCTs.size());
+    for (size_t i = 0; i<nv.size(); i++) {
+        nv[i] = Vector3d(s.nodes[3*i], s.nodes[3*i+1], s.nodes[3*i+2]);
     }
     return nv;
 }
@@ -309,36 +421,26 @@ std::vector<Vector3d> Organism::getNodes() const
  */
 std::vector<double> Organism::getNodeCTs() const
 {
-    auto organs = getOrgans();
-    std::vector<double> cts = std::vector<double>(getNumberOfNodes()); // reserve big enough vector
-    for (const auto& o : baseOrgans) { // copy initial nodes (even if organs have not developed)
-        cts.at(o->getNodeId(0)) = o->getNodeCT(0);
-    }
-    for (const auto& o : organs) { // copy all organ creation times
-        for (size_t i=1; i<o->getNumberOfNodes(); i++) {
-            // we start at 1 because we don't copy the emergence time of the lateral root
-            cts.at(o->getNodeId(i)) = o->getNodeCT(i);
-        }
-    }
-    return cts;
+    return getSegmentStore().nodeCTs;
 }
 
 /**
  * The line segments of the organism, each segment consisting of two node indices,
  * corresponding to the node list Organism::getNode(-1),
  * or the node indices from Organism::getNodeId(ot).
+ * Segments are ordered like the organs (@see Organism::getOrgans), and along each organ.
  *
  * @param ot        the expected organ type, where -1 denotes all organ types (default)
  * @return          line segments
  */
 std::vector<Vector2i> Organism::getSegments(int ot) const
 {
-    auto organs = getOrgans(ot);
-    std::vector<Vector2i> segs = std::vector<Vector2i>(0);
-    segs.reserve(this->getNumberOfSegments(ot)); // for speed up
-    for (const auto& o : organs) {
-        auto s = o->getSegments();
-        segs.insert(segs.end(), s.begin(), s.end()); // append s; todo check if it works..
+    const auto& s = getSegmentStore();
+    auto segIds = getSegmentIds(ot);
+    std::vector<Vector2i> segs = std::vector<Vector2i>(segIds.size());
+    for (size_t i = 0; i<segs.size(); i++) {
+        int k = segIds[i];
+        segs[i] = Vector2i(s.segments[2*k], s.segments[2*k+1]);
     }
     return segs;
 }
@@ -352,26 +454,33 @@ std::vector<Vector2i> Organism::getSegments(int ot) const
  */
 std::vector<double> Organism::getSegmentCTs(int ot) const
 {
-    auto nodeCT = getNodeCTs(); // of all nodes (otherwise indices are tricky)
-    auto segs = getSegments(ot);
-    std::vector<double> cts = std::vector<double>(segs.size());
-    for (int i=0; i<cts.size(); i++) {
-        cts[i] = nodeCT[segs[i].y]; // segment creation time is the node creation time of the second node
+    const auto& s = getSegmentStore();
+    auto segIds = getSegmentIds(ot);
+    std::vector<double> cts = std::vector<double>(segIds.size());
+    for (size_t i = 0; i<cts.size(); i++) {
+        cts[i] = s.nodeCTs[segIds[i]+1]; // segment creation time is the node creation time of the second node
     }
     return cts;
 }
 /**
  * The segment indexes, corresponding to Organism::getSegments(ot).
+ * The segment index is the node index of the second node - 1, and indexes the arrays of the segment store.
  *
  * @param ot        the expected organ type, where -1 denotes all organ types (default)
  * @return          Id of each segment
  */
 std::vector<int> Organism::getSegmentIds(int ot) const
 {
-    auto segments = getSegments(ot); // of all nodes (otherwise indices are tricky)
-    std::vector<int> segId = std::vector<int>(segments.size());
-    for (int i=0; i<segments.size(); i++) {
-        segId[i] = segments[i].y-1;
+    const auto& s = getSegmentStore();
+    if (ot<0) {
+        return s.orderedSegments;
+    }
+    std::vector<int> segId = std::vector<int>(0);
+    segId.reserve(s.getNumberOfSegments(ot)); // for speed up
+    for (size_t i = 0; i<s.orderedSegments.size(); i++) {
+        if (s.orderedOrganTypes[i]==ot) {
+            segId.push_back(s.orderedSegments[i]);
+        }
     }
     return segId;
 }
@@ -385,59 +494,38 @@ std::vector<int> Organism::getSegmentIds(int ot) const
  */
 std::vector<std::shared_ptr<Organ>> Organism::getSegmentOrigins(int ot) const
 {
-    auto organs = getOrgans(ot);
+    const auto& s = getSegmentStore();
     auto segs = std::vector<std::shared_ptr<Organ>>(0);
-    segs.reserve(this->getNumberOfSegments(ot)); // for speed up
-    for (const auto& o : organs) {
-        auto s = o->getSegments();
-        for (int i=0; i<s.size(); i++) {
-            segs.push_back(o);
+    segs.reserve(s.getNumberOfSegments(ot)); // for speed up
+    for (size_t i = 0; i<s.orderedSegments.size(); i++) {
+        if ((ot<0) || (s.orderedOrganTypes[i]==ot)) {
+            segs.push_back(s.organs[s.orderedOrganIds[i]]);
         }
     }
     return segs;
 }
 
 /**
- * @return the indices of the nodes that were moved during the last time step,
+ * @return the indices of the nodes that were moved (or got a new creation time) during the last time step,
  * update the node coordinates using Organism::getUpdatedNodes(),
  * and creation times using Organism::getUpdatedNodeCTs()
- * for stem and leaves, assume that all the old nodes need to be updated
  */
 std::vector<int> Organism::getUpdatedNodeIndices() const
 {
-    auto organs = this->getOrgans();
-    std::vector<int> ni = std::vector<int>(0);
-    for (const auto& o : organs) {
-        if (o->hasMoved()&&(o->getOldNumberOfNodes()>1)) {
-			if((o->organType() >2)){//is stem or leaf
-				int onon =  o->getOldNumberOfNodes();//because of tropism and internodal growth, all nodes can move
-				for(int i = 1; i < onon; i++){
-					ni.push_back(o->getNodeId(i));
-				}
-			}else{ni.push_back(o->getNodeId(o->getOldNumberOfNodes()-1));}
-        }
-    }
-    return ni;
+    return getSegmentStore().updatedNodeIndices;
 }
 
 /**
  * @return the new coordinates of nodes that were updated during the last time step,
  * corresponding to Organism::getUpdatedNodeIndices
- * for stem and leaves, assume that all the old nodes need to be updated
  */
 std::vector<Vector3d> Organism::getUpdatedNodes() const
 {
-    auto organs = this->getOrgans();
+    const auto& s = getSegmentStore();
     std::vector<Vector3d> nv = std::vector<Vector3d>(0);
-    for (const auto& o : organs) {
-        if (o->hasMoved()&&(o->getOldNumberOfNodes()>1)) {
-			if((o->organType() > 2)){
-				int onon =  o->getOldNumberOfNodes();//in case of internodal growth, not just last node needs to be updated
-				for(int i = 1; i < onon; i++){
-					nv.push_back(o->getNode(i));
-				}
-			}else{nv.push_back(o->getNode(o->getOldNumberOfNodes()-1));}
-        }
+    nv.reserve(s.updatedNodeIndices.size());
+    for (int i : s.updatedNodeIndices) {
+        nv.push_back(Vector3d(s.nodes[3*i], s.nodes[3*i+1], s.nodes[3*i+2]));
     }
     return nv;
 }
@@ -448,17 +536,11 @@ std::vector<Vector3d> Organism::getUpdatedNodes() const
  */
 std::vector<double> Organism::getUpdatedNodeCTs() const
 {
-    auto organs = this->getOrgans();
+    const auto& s = getSegmentStore();
     std::vector<double> nv = std::vector<double>(0);
-    for (const auto& o : organs) {
-        if (o->hasMoved()&&(o->getOldNumberOfNodes()>1)) {
-			if((o->organType() > 2)){
-				int onon =  o->getOldNumberOfNodes();//in case of internodal growth, not just last node needs to be updated
-				for(int i = 1; i < onon; i++){
-					nv.push_back(o->getNodeCT(i));
-				}
-			}else{nv.push_back(o->getNodeCT(o->getOldNumberOfNodes()-1));}
-        }
+    nv.reserve(s.updatedNodeIndices.size());
+    for (int i : s.updatedNodeIndices) {
+        nv.push_back(s.nodeCTs[i]);
     }
     return nv;
 }
@@ -469,13 +551,11 @@ std::vector<double> Organism::getUpdatedNodeCTs() const
  */
 std::vector<Vector3d> Organism::getNewNodes() const
 {
-    auto organs = this->getOrgans();
+    const auto& s = getSegmentStore();
     std::vector<Vector3d> nv(this->getNumberOfNewNodes());
-    for (const auto& o : organs) {
-        int onon = o->getOldNumberOfNodes();
-        for (size_t i=onon; i<o->getNumberOfNodes(); i++) { // loop over all new nodes
-            nv.at(o->getNodeId(i)-this->oldNumberOfNodes) = o->getNode(i);
-        }
+    for (size_t i = 0; i<nv.size(); i++) {
+        int j = this->oldNumberOfNodes + i;
+        nv[i] = Vector3d(s.nodes[3*j], s.nodes[3*j+1], s.nodes[3*j+2]);
     }
     return nv;
 }
@@ -488,36 +568,25 @@ std::vector<Vector3d> Organism::getNewNodes() const
  */
 std::vector<double> Organism::getNewNodeCTs() const
 {
-    auto organs = this->getOrgans();
-    std::vector<double> nv(this->getNumberOfNewNodes());
-    for (const auto& o : organs) {
-        int onon = o->getOldNumberOfNodes();
-        if (onon==0) { // make sure to never copy the root emergence time
-            onon = 1;
-        }
-        for (size_t i=onon; i<o->getNumberOfNodes(); i++) { // loop over all new nodes
-            nv.at(o->getNodeId(i)-this->oldNumberOfNodes) = o->getNodeCT(i);
-        }
-    }
-    return nv;
+    const auto& s = getSegmentStore();
+    return std::vector<double>(s.nodeCTs.begin() + this->oldNumberOfNodes, s.nodeCTs.end());
 }
 
 /**
- * Creates a vector of new created segments that were created during the last time step
+ * Creates a vector of new created segments that were created during the last time step,
+ * i.e. segments, whose second node is new, ordered by their segment index
  *
  * @param ot        the expected organ type, where -1 denotes all organ types (default)
  * @return          a vector of newly created segments
  */
 std::vector<Vector2i> Organism::getNewSegments(int ot) const
 {
-    auto organs = this->getOrgans(ot);
+    const auto& s = getSegmentStore();
     std::vector<Vector2i> si = std::vector<Vector2i>(0);
     si.reserve(this->getNumberOfNewNodes());
-    for (const auto& o :organs) {
-        int onon = o->getOldNumberOfNodes();
-        for (size_t i=onon-1; i<o->getNumberOfNodes()-1; i++) { // loop over new segments
-            Vector2i v(o->getNodeId(i),o->getNodeId(i+1));
-            si.push_back(v);
+    for (size_t i = std::max(this->oldNumberOfNodes-1, 0); i<s.organIds.size(); i++) { // loop over new segments
+        if ((s.organIds[i]>=0) && ((ot<0) || (s.organTypes[i]==ot))) {
+            si.push_back(Vector2i(s.segments[2*i], s.segments[2*i+1]));
         }
     }
     return si;
@@ -533,17 +602,217 @@ std::vector<Vector2i> Organism::getNewSegments(int ot) const
  */
 std::vector<std::shared_ptr<Organ>> Organism::getNewSegmentOrigins(int ot) const
 {
-    auto organs = this->getOrgans(ot);
+    const auto& s = getSegmentStore();
     std::vector<std::shared_ptr<Organ>> so;
-    for (auto& o :organs) {
-        int onon = o->getOldNumberOfNodes();
-        for (size_t i=onon-1; i<o->getNumberOfNodes()-1; i++) { // loop over new segments
-            so.push_back(o);
+    so.reserve(this->getNumberOfNewNodes());
+    for (size_t i = std::max(this->oldNumberOfNodes-1, 0); i<s.organIds.size(); i++) { // loop over new segments
+        if ((s.organIds[i]>=0) && ((ot<0) || (s.organTypes[i]==ot))) {
+            so.push_back(s.organs[s.organIds[i]]);
         }
     }
     return so;
 }
 
+/**
+ * Returns the flat geometry of the organism. The store is updated at the end of each time step,
+ * other changes of the organ tree (e.g. adding organs or nodes by hand) increase the version of the organism,
+ * and are copied on access. Concurrent readers are safe, the update is guarded by the store's mutex.
+ *
+ * The reference stays valid, but its content changes with the next time step.
+ *
+ * @return          the segment store
+ */
+const SegmentStore& Organism::getSegmentStore() const
+{
+    if (store.version!=version) {
+        std::lock_guard<std::mutex> lock(store.mutex);
+        if (store.version!=version) { // not updated by another reader meanwhile
+            updateSegmentStore();
+        }
+    }
+    return store;
+}
+
+/**
+ * Copies nodes and segments from the organ tree into the store. Only new nodes are copied,
+ * and nodes that have moved during the last time step. If the organism became smaller (e.g. after a reset),
+ * or the store is invalid, it is rebuilt.
+ *
+ * @param step      called after a time step, updates the list of moved nodes (@see Organism::getUpdatedNodeIndices)
+ * @param allNodes  copies all nodes, e.g. if the coordinates were changed outside of a time step
+ */
+void Organism::updateSegmentStore(bool step, bool allNodes) const
+{
+    int n = getNumberOfNodes();
+    int m = getNumberOfOrgans();
+    if ((store.version<0) || (n<store.nodeCTs.size()) || (m<store.organs.size())) { // rebuild
+        store.clear();
+    }
+    int ns = std::max(n-1, 0);
+    store.nodes.resize(3*n, 0.);
+    store.nodeCTs.resize(n, 0.);
+    store.segments.resize(2*ns, -1);
+    store.organIds.resize(ns, -1);
+    store.organTypes.resize(ns, -1);
+    store.subTypes.resize(ns, -1);
+    store.radii.resize(ns, 0.);
+    store.organs.resize(m);
+    store.syncedNodes.resize(m, 0);
+    store.organOrder.clear();
+    if (step) {
+        store.updatedNodeIndices.clear();
+    }
+    for (const auto& o : baseOrgans) {
+        if (o->getNumberOfNodes()>0) { // copy initial nodes (even if organs have not developed)
+            int j = o->getNodeId(0);
+            Vector3d n0 = o->getNode(0);
+            store.nodes[3*j] = n0.x;
+            store.nodes[3*j+1] = n0.y;
+            store.nodes[3*j+2] = n0.z;
+            store.nodeCTs[j] = o->getNodeCT(0);
+        }
+        storeOrgan(o, step, allNodes);
+    }
+    if (store.orderChanged) { // segments in organ order, for the segment getters (@see Organism::getSegments)
+        int nos = store.getNumberOfSegments();
+        store.orderedSegments.resize(nos);
+        store.orderedOrganTypes.resize(nos);
+        store.orderedOrganIds.resize(nos);
+        int c = 0;
+        for (int id : store.organOrder) {
+            const auto& o = store.organs[id];
+            for (int i = 1; i<store.syncedNodes[id]; i++) {
+                int k = o->getNodeId(i)-1;
+                store.orderedSegments[c] = k;
+                store.orderedOrganTypes[c] = store.organTypes[k];
+                store.orderedOrganIds[c] = id;
+                c++;
+            }
+        }
+        store.orderChanged = false;
+    }
+    store.version = version;
+}
+
+/**
+ * Copies the nodes and segments of organ @param o and its children into the store (@see Organism::updateSegmentStore).
+ * Like Organism::getOrgans, it considers only organs with more than one node, and skips seeds and leaf bulbs.
+ * The first node of an organ is not copied, since it belongs to the parent organ.
+ */
+void Organism::storeOrgan(const std::shared_ptr<Organ>& o, bool step, bool allNodes) const
+{
+    int nn = o->getNumberOfNodes();
+    int ot = o->organType();
+    int st = o->getParam()->subType;
+    bool notBulb = !((ot==ot_stem) && (st==2));
+    if ((nn>1) && notBulb && (ot!=ot_seed)) {
+        int id = o->getId();
+        int synced = store.syncedNodes.at(id); // nodes already in the store, moves of roots are detected by comparison
+        int first = synced;
+        if (synced==0) {
+            store.organs.at(id) = o;
+        }
+        store.organOrder.push_back(id);
+        if (synced!=nn) {
+            store.orderChanged = true;
+        }
+        if (step && !allNodes && (ot>ot_root) && (synced>0)) { // stems and leaves report the nodes that moved (@see Organ::getMovedNodes)
+            for (int i : o->getMovedNodes()) {
+                if (i<synced) {
+                    int j = o->getNodeId(i);
+                    Vector3d ni = o->getNode(i);
+                    store.nodes[3*j] = ni.x;
+                    store.nodes[3*j+1] = ni.y;
+                    store.nodes[3*j+2] = ni.z;
+                    store.nodeCTs[j] = o->getNodeCT(i);
+                    store.updatedNodeIndices.push_back(j);
+                }
+            }
+        } else if (allNodes || (ot>ot_root)) { // because of tropism and internodal growth, all nodes of stems and leaves can move
+            first = 1;
+        }
+        int onon = o->getOldNumberOfNodes();
+        if (o->hasMoved() && (onon>1)) {
+            if ((synced==0) && step) { // old nodes are unknown (e.g. the store was rebuilt), report all that might have moved
+                for (int i = (ot>ot_root) ? 1 : onon-1; i<onon; i++) {
+                    store.updatedNodeIndices.push_back(o->getNodeId(i));
+                }
+            }
+            if (ot==ot_root) {
+                first = std::min(first, onon-1);
+            }
+        }
+        first = std::max(first, 1);
+        double a = o->getParam()->a;
+        for (int i = first; i<nn; i++) {
+            int j = o->getNodeId(i);
+            Vector3d ni = o->getNode(i);
+            double ct = o->getNodeCT(i);
+            if (step && (i<synced) && ((store.nodes[3*j]!=ni.x) || (store.nodes[3*j+1]!=ni.y) || (store.nodes[3*j+2]!=ni.z) || (store.nodeCTs[j]!=ct))) {
+                store.updatedNodeIndices.push_back(j); // only nodes that actually moved
+            }
+            store.nodes[3*j] = ni.x;
+            store.nodes[3*j+1] = ni.y;
+            store.nodes[3*j+2] = ni.z;
+            store.nodeCTs[j] = ct;
+            int k = j-1; // segment index
+            if (store.organIds[k]<0) {
+                if (ot>=store.segmentCounts.size()) {
+                    store.segmentCounts.resize(ot+1, 0);
+                }
+                store.segmentCounts[ot]++;
+            }
+            store.segments[2*k] = o->getNodeId(i-1);
+            store.segments[2*k+1] = j;
+            store.organIds[k] = id;
+            store.organTypes[k] = ot;
+            store.subTypes[k] = st;
+            store.radii[k] = a;
+        }
+        store.syncedNodes[id] = nn;
+    }
+    for (const auto& c : o->getChildren()) {
+        storeOrgan(c, step, allNodes);
+    }
+}
+
+/**
+ * Empties the store, Organism::getSegmentStore rebuilds it on the next access
+ */
+void SegmentStore::clear()
+{
+    version = -1;
+    nodes.clear();
+    nodeCTs.clear();
+    segments.clear();
+    organIds.clear();
+    organTypes.clear();
+    subTypes.clear();
+    radii.clear();
+    orderedSegments.clear();
+    orderedOrganTypes.clear();
+    orderedOrganIds.clear();
+    organs.clear();
+    syncedNodes.clear();
+    segmentCounts.clear();
+    organOrder.clear();
+    orderChanged = false;
+    updatedNodeIndices.clear();
+}
+
+/**
+ * @param ot        the expected organ type, where -1 denotes all organ types (default)
+ * @return          number of segments of organ type @param ot
+ */
+int SegmentStore::getNumberOfSegments(int ot) const
+{
+    if (ot<0) {
+        return std::accumulate(segmentCounts.begin(), segmentCounts.end(), 0);
+    } else {
+        return (ot<segmentCounts.size()) ? segmentCounts[ot] : 0;
+    }
+}
+
 /**
  * @return Quick info about the object for debugging
  */
@@ -731,6 +1000,77 @@ tinyxml2:: XMLElement* Organism::getRSMLScene(tinyxml2::XMLDocument& xmlDoc) con
 void Organism::setSeed(unsigned int seed)
 {
     this->gen = std::mt19937(seed);
+    streamSeed = seed;
+}
+
+/**
+ * @return next unique organ id, during a parallel step a provisional id (@see Organism::setThreads)
+ */
+int Organism::getOrganIndex()
+{
+    if (parallelStep) {
+        return --provisionalIndex.value;
+    }
+    version++;
+    organId++;
+    return organId;
+}
+
+/**
+ * @return next unique node id, during a parallel step a provisional id (@see Organism::setThreads)
+ */
+int Organism::getNodeIndex()
+{
+    if (parallelStep) {
+        return --provisionalIndex.value;
+    }
+    version++;
+    nodeId++;
+    return nodeId;
+}
+
+/**
+ * @return uniformly distributed random number [0, 1[, drawn from the stream of the currently simulated organ during parallel steps
+ */
+double Organism::rand()
+{
+    if (stochastic) {
+        if ((currentStep.organism==this) && (currentStep.stream!=nullptr)) {
+            return currentStep.stream->rand();
+        }
+        return UD(gen);
+    } else {
+        return 0.5;
+    }
+}
+
+/**
+ * @return normally distributed random number, drawn from the stream of the currently simulated organ during parallel steps
+ */
+double Organism::randn()
+{
+    if (stochastic) {
+        if ((currentStep.organism==this) && (currentStep.stream!=nullptr)) {
+            return currentStep.stream->randn();
+        }
+        return ND(gen);
+    } else {
+        return 0.0;
+    }
+}
+
+/**
+ * Random number stream for a new organ. During a parallel step the stream is split from the stream of the organ
+ * currently simulated by the calling thread (the organ id is only provisional), otherwise it is keyed by the organ id.
+ *
+ * @param organId   the organ id
+ */
+RandomStream Organism::createRandomStream(int organId) const
+{
+    if ((currentStep.organism==this) && (currentStep.stream!=nullptr)) {
+        return currentStep.stream->split();
+    }
+    return RandomStream(streamSeed, organId);
 }
 
 
@@ -11,12 +11,63 @@
 #include <map>
 #include <array>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <iostream>
 
 namespace CPlantBox {
 
 class Organ;
 class OrganRandomParameter;
+class ThreadPool;
+
+/**
+ * SegmentStore
+ *
+ * Flat geometry of an organism as structure of arrays, maintained by the Organism (@see Organism::getSegmentStore).
+ * Nodes are indexed by their global node index, segments by the global node index of their second node minus one.
+ * Indices without segment (e.g. base nodes of the organism) have organ id -1.
+ */
+class SegmentStore {
+public:
+
+    SegmentStore() { }
+    SegmentStore(const SegmentStore&) { } ///< copies are empty (the organs belong to the original), and are rebuilt on first access
+    SegmentStore& operator=(const SegmentStore&) { clear(); return *this; }
+
+    void clear(); ///< empties the store, it is rebuilt on the next access
+    int getNumberOfSegments(int ot = -1) const; ///< number of segments of organ type ot (-1 for all types)
+
+    std::atomic<int> version{-1}; ///< version of the organ tree copied into the store, -1 if the store must be rebuilt
+    std::mutex mutex; ///< guards updates on access (@see Organism::getSegmentStore)
+
+    /* per node (index = global node index) */
+    std::vector<double> nodes; ///< node coordinates [cm], (x, y, z) per node
+    std::vector<double> nodeCTs; ///< node creation times [day]
+
+    /* per segment (index = global node index of the second node - 1) */
+    std::vector<int> segments; ///< global node indices, (first, second) per segment
+    std::vector<int> organIds; ///< id of the organ containing the segment, -1 if there is no segment
+    std::vector<int> organTypes; ///< organ type of the segment
+    std::vector<int> subTypes; ///< sub type of the segment
+    std::vector<double> radii; ///< segment radius [cm]
+
+    /* per segment in organ order (index = position in Organism::getSegments) */
+    std::vector<int> orderedSegments; ///< segment index
+    std::vector<int> orderedOrganTypes; ///< organ type of the segment
+    std::vector<int> orderedOrganIds; ///< id of the organ containing the segment
+
+    /* per organ (index = organ id) */
+    std::vector<std::shared_ptr<Organ>> organs; ///< organs containing segments, nullptr otherwise
+    std::vector<int> syncedNodes; ///< number of nodes of the organ copied into the store
+    std::vector<int> segmentCounts; ///< number of segments per organ type
+    std::vector<int> organOrder; ///< ids of the organs containing segments, in organ order (@see Organism::getOrgans)
+    bool orderChanged = false; ///< organs got new segments, the ordered segment arrays are rebuilt
+
+    /* last time step */
+    std::vector<int> updatedNodeIndices; ///< nodes that were moved in the last time step
+
+};
 
 /**
  * Organism
@@ -25,12 +76,13 @@ class OrganRandomParameter;
  *
  * Manages the OrganRandomParameters
  * Offers an interface for the simulation loop (initialize, simulate, ...)
- * Collects node and line segment geometry from the organ tree
+ * Collects node and line segment geometry from the organ tree into a flat store (@see SegmentStore)
  * Collect parameters from the organs
  * Can collect information about the last time step
  * Supports RSML
  * Holds global node index and organ index counter
  * Holds random numbers generator for the organ classes
+ * Optionally simulates independent organ sub trees in parallel (@see Organism::setThreads)
  */
 class Organism : public std::enable_shared_from_this<Organism> {
 public:
@@ -54,11 +106,16 @@ public:
     int getParameterSubType(int organtype, std::string str) const; ///< returns the parameter sub type index of name @param str
 
     /* initialization and simulation */
-    void addOrgan(std::shared_ptr<Organ> o) { baseOrgans.push_back(o); } ///< adds an organ, takes ownership
+    void addOrgan(std::shared_ptr<Organ> o) { baseOrgans.push_back(o); version++; } ///< adds an organ, takes ownership
     virtual void initialize(bool verbose = true); ///< overwrite for initialization jobs
     virtual void simulate(double dt, bool verbose = false); ///< calls the base organs simulate methods
     double getSimTime() const { return simtime; } ///< returns the current simulation time
     double getDt() const { return dt; } ///< returns the current simulation duration/time step
+    void simulateOrgans(const std::vector<std::shared_ptr<Organ>>& organs, double dt, bool verbose = false); ///< simulates a list of organs (e.g. the children of an organ)
+
+    /* parallel simulation */
+    void setThreads(int n); ///< number of threads used by simulate (0 = serial, default)
+    int getThreads() const { return threads; } ///< number of threads used by simulate (0 = serial)
 
     /* as sequential list */
     std::vector<std::shared_ptr<Organ>> getOrgans(int ot=-1, bool all = false) const; ///< sequential list of organs
@@ -90,6 +147,8 @@ public:
     std::vector<Vector2i> getNewSegments(int ot=-1) const; ///< Segments created in the previous time step
     std::vector<std::shared_ptr<Organ>> getNewSegmentOrigins(int ot=-1) const; ///< Copies a pointer to the root containing the new segments
 
+    const SegmentStore& getSegmentStore() const; ///< flat geometry of the organism, updated if necessary
+
     /* io */
     virtual std::string toString() const; ///< quick info for debugging
     virtual void initializeReader() { } ///< initializes parameter reader
@@ -101,8 +160,8 @@ public:
     std::vector<std::string>& getRSMLProperties() { return rsmlProperties; } ///< reference to the vector<string> of RSML property names, default is { "organType", "subType","length", "age"  }
 
     /* id management */
-    int getOrganIndex() { organId++; return organId; } ///< returns next unique organ id, only organ constructors should call this
-    int getNodeIndex() { nodeId++; return nodeId; } ///< returns next unique node id, only organ constructors should call this
+    int getOrganIndex(); ///< returns next unique organ id, only organ constructors should call this
+    int getNodeIndex(); ///< returns next unique node id, only organ constructors should call this
 
     /* discretisation*/
     void setMinDx(double dx) { minDx = dx; } ///< Minimum segment size, smaller segments will be skipped
@@ -111,8 +170,9 @@ public:
     /* random number generator */
     virtual void setSeed(unsigned int seed); ///< sets the seed of the organisms random number generator
 
-    virtual double rand() {if(stochastic){return UD(gen); } else {return 0.5; } }  ///< uniformly distributed random number [0, 1[
-    virtual double randn() {if(stochastic){return ND(gen); } else {return 0.0; } }  ///< normally distributed random number [-3, 3] in 99.73% of cases
+    virtual double rand(); ///< uniformly distributed random number [0, 1[
+    virtual double randn(); ///< normally distributed random number [-3, 3] in 99.73% of cases
+    RandomStream createRandomStream(int organId) const; ///< random number stream of an organ (@see Organism::setThreads)
 	double getSeedVal(){return seed_val;}
 	void setStochastic(bool stochastic_){stochastic = stochastic_;}
 	bool getStochastic(){return stochastic;}
@@ -125,6 +185,9 @@ protected:
     virtual tinyxml2:: XMLElement* getRSMLMetadata(tinyxml2::XMLDocument& doc) const;
     virtual tinyxml2:: XMLElement* getRSMLScene(tinyxml2::XMLDocument& doc) const;
 
+    void updateSegmentStore(bool step = false, bool allNodes = false) const; ///< copies new (and moved) nodes and segments into the store
+    void storeOrgan(const std::shared_ptr<Organ>& o, bool step, bool allNodes) const; ///< copies an organ and its children into the store
+
     
     static const int numberOfOrganTypes = 5;
     std::array<std::map<int, std::shared_ptr<OrganRandomParameter>>, numberOfOrganTypes> organParam;
@@ -133,14 +196,29 @@ protected:
 	double dt = 0;
     int organId = -1;
     int nodeId = -1;
+    int version = 0; ///< counts new organs and nodes (outside of parallel steps), the store is updated on access if it is behind
     int oldNumberOfNodes = 0;
     int oldNumberOfOrgans = 0;
 
+    int threads = 0; ///< number of threads (0 = serial)
+    std::shared_ptr<ThreadPool> threadPool; ///< simulates organ sub trees, if threads > 0
+    bool parallelStep = false; ///< true during a parallel simulation step, ids are provisional
+    struct ProvisionalIndex { ///< atomic counter, copies start at -1
+        std::atomic<int> value;
+        ProvisionalIndex(): value(-1) { }
+        ProvisionalIndex(const ProvisionalIndex&): value(-1) { }
+        ProvisionalIndex& operator=(const ProvisionalIndex&) { value = -1; return *this; }
+    };
+    ProvisionalIndex provisionalIndex; ///< provisional node and organ indices during parallel steps are < -1
+
+    mutable SegmentStore store; ///< flat geometry, updated after each time step, or lazily by the getters
+
     std::vector<std::string> rsmlProperties = { "organType", "subType", "length", "age", "parent-node", "diameter" };
     int rsmlSkip = 0; // skips points
     double minDx = 1.e-6; ///< threshold value, smaller segments will be skipped, otherwise root tip direction can become NaN
 
 	double seed_val;///<value to use as seed, keep in memory to send to tropism			 
+    uint64_t streamSeed; ///< seed of the organ random number streams
     std::mt19937 gen;
     std::uniform_real_distribution<double> UD;
     std::normal_distribution<double> ND;
@@ -2,12 +2,14 @@
 
 #include "Photosynthesis.h"
 //#include <armadillo>
-//#include <algorithm>
+#include <algorithm>
 #include <set>
+#include <chrono>
 #include <external/Eigen/Dense>
 #include <external/Eigen/Sparse> 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 																							
 																		
 
@@ -55,6 +57,9 @@ void Photosynthesis::solve_photosynthesis(double sim_time_,std::vector<double> s
 {
 	//		save Environmental and other input variables
 	doLog = doLog_; verbose_photosynthesis = verbose_;	
+	auto start = std::chrono::steady_clock::now();
+	andersonX.clear(); andersonG.clear();
+	trace.clear();
 					   
 	loop = 0;        
 	this->stop = false;
@@ -78,9 +83,10 @@ void Photosynthesis::solve_photosynthesis(double sim_time_,std::vector<double> s
 	orgsVec = plant->getOrgans(-1);
  
 	An_old = An; gco2_old = gco2; ci_old = ci;
-	outputFlux_old.resize(psiXyl.size(), 0.);
+	outputFlux_old.resize(plant->segments.size(), 0.);
 	outputFlux.resize(plant->segments.size(), 0.);
 	psiXyl_old = psiXyl; pg_old = pg; k_stomatas_old = k_stomatas;
+	fluxCurrent = false;
 	
 	k_stomatas.clear();//to not take k_stomatas into account in @Photosynthesis::initCalcs
 	assert(k_stomatas.empty() &&"Photosynthesis::initStruct: k_stomatas not empty");
@@ -88,25 +94,25 @@ void Photosynthesis::solve_photosynthesis(double sim_time_,std::vector<double> s
 	//		compute parameters which do not change between the loops
 	initCalcs(sim_time_);
 	k_stomatas = k_stomatas_old ;											
+	loopPool.reset();
+	if(loopThreads > 0){loopPool = std::make_shared<ThreadPool>(loopThreads - 1);}
 	while(!this->stop){  
 		std::fill(maxErr.begin(), maxErr.end(), 0.);//re-initialize error vector
+		//the current values become the "old" ones (double buffers, the new values overwrite the older ones)
+		std::swap(An, An_old); std::swap(gco2, gco2_old); std::swap(ci, ci_old); 
+		std::swap(pg, pg_old); std::swap(k_stomatas, k_stomatas_old);
 		loopCalcs(sim_time_) ;//compute photosynthesis outputs
 		if((verbose_photosynthesis > 1)){std::cout<<"to linearSystem"<<std::endl;}
+		std::swap(psiXyl, psiXyl_old); std::swap(outputFlux, outputFlux_old);
+		fluxOldCurrent = fluxCurrent; fluxCurrent = false;
 		linearSystemSolve(sim_time_, sxx_, cells_, soil_k_); //compute psiXyl
-		if((verbose_photosynthesis > 1)){std::cout<<"to outputFlux"<<std::endl;}
-		//usefull only to know whether we reached convergence
-		outputFlux = segFluxes(sim_time_, this->psiXyl, sxx_, false, cells_, std::vector<double>());//approx = false
 		if((verbose_photosynthesis > 1)){std::cout<<"to getError"<<std::endl;}
-		getError(sim_time_);
+		getError(sim_time_, sxx_, cells_);
 		
 		loop++ ;
 		this->stop = ((loop > maxLoop) || ((maxMaxErr < limMaxErr)&&(loop>minLoop)));//reached convergence or max limit of loops?
 		
-		if(!this->stop){
-			outputFlux_old = outputFlux;
-			k_stomatas_old = k_stomatas; ci_old = this->ci; pg_old = this->pg;
-			psiXyl_old = this->psiXyl; An_old = this->An; gco2_old = this->gco2;
-		}
+		if((!this->stop)&&(andersonDepth > 0)){andersonUpdate();}
 		
 		if((verbose_photosynthesis > 0)){
 			std::cout<<"leuning computation module at "<<(loop-1)<<" trials. "
@@ -119,17 +125,24 @@ void Photosynthesis::solve_photosynthesis(double sim_time_,std::vector<double> s
 	}
 	
 		
-	outputFlux = segFluxes(sim_time_, this->psiXyl, sxx_, false, cells_, std::vector<double>());//approx = false
+	loopPool.reset();
+	if(!fluxCurrent){
+		outputFlux = segFluxes(sim_time_, this->psiXyl, sxx_, false, cells_, std::vector<double>());//approx = false
+	}
 	loop++ ;
+	for(const auto& f : trace){
+		std::ofstream out(f.first);
+		out << f.second;
+	}
 	
 	// for phloem flow
 	getAg4Phloem();
 	doAddGravity(); 
-	
+	solveTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	
 	if((verbose_photosynthesis  > 0))
 	{
-		std::cout<<"leuning computation module stopped after "<<(loop-1)<<" trials. "
+		std::cout<<"leuning computation module stopped after "<<(loop-1)<<" trials ("<<solveTime<<" s). "
 		"Sum of max relative error calculated at the "
 		"last two trials: "<<maxMaxErr<<std::endl;
 		std::cout<<"each val "<<maxErr[0]<<" "<<maxErr[1]<<" "<<maxErr[2]<<" "<<maxErr[3]<<" "<<maxErr[4];
@@ -139,7 +152,9 @@ void Photosynthesis::solve_photosynthesis(double sim_time_,std::vector<double> s
 
 
 /**
- * Solves the linear system filled by @see XylemFlux::linearSystem
+ * Solves the linear system filled by @see XylemFlux::linearSystem, with @see XylemFlux::solveLinearSystem (without boundary conditions).
+ * The elimination order (tree) or the sparsity pattern (sparse LU) is analysed once per plant topology, 
+ * between the loops only the numerical factorization is repeated (the stomatal conductances change the leaf entries)
  *
  * @param simTime[day]  	current simulation time, needed for age dependent conductivities,
  *                  		to calculate the age from the creation times (age = sim_time - segment creation time).
@@ -150,87 +165,105 @@ void Photosynthesis::solve_photosynthesis(double sim_time_,std::vector<double> s
  */
 void Photosynthesis::linearSystemSolve(double simTime_, const std::vector<double>& sxx_, bool cells_, const std::vector<double> soil_k_)
 {
-	//get "tripletList" and "b"
-	bool withEigen_ = true;
-	linearSystem(simTime_, sxx_, cells_, soil_k_, withEigen_); //see XylemFlux::linearSystem
-    int N = rs->nodes.size(); // number of nodes
-	Eigen::SparseMatrix<double> mat(N,N);
-	mat.reserve(Eigen::VectorXi::Constant(N,2));
-	mat.setFromTriplets(tripletList.begin(), tripletList.end());
-	mat.makeCompressed();
-	Eigen::SparseLU<Eigen::SparseMatrix<double>> lu;
-	lu.compute(mat);
-	
-	if(lu.info() != Eigen::Success){
-		std::cout << "XylemFlux::linearSystem  matrix Compute with Eigen failed: " << lu.info() << std::endl;
-		assert(false);
+	linearSystem(simTime_, sxx_, cells_, soil_k_); //see XylemFlux::linearSystem
+	psiXyl = solveLinearSystem(std::vector<int>(), std::vector<double>(), false);
+}
+
+/* 
+		Anderson acceleration of the fixed point iteration over the coupled state (psiXyl, ci, pg, k_stomatas).
+		The input of the last loop is given by the "old" values, its output by the current ones. 
+		The next input combines the outputs of the last andersonDepth + 1 loops, 
+		minimizing the residual (output - input, relative to the first output) in the least squares sense. 
+		Falls back to the Picard step (and restarts) when a value is not finite or changes sign.
+*/
+void Photosynthesis::andersonUpdate()
+{
+	int nx = psiXyl.size();
+	int nl = ci.size();
+	Eigen::VectorXd x(nx + 3*nl), g(nx + 3*nl);
+	for(int i = 0; i < nx; i++){x(i) = psiXyl_old.at(i); g(i) = psiXyl.at(i);}
+	for(int i = 0; i < nl; i++){
+		x(nx + i) = ci_old.at(i); g(nx + i) = ci.at(i);
+		x(nx + nl + i) = pg_old.at(i); g(nx + nl + i) = pg.at(i);
+		x(nx + 2*nl + i) = k_stomatas_old.at(i); g(nx + 2*nl + i) = k_stomatas.at(i);
 	}
-	
-	Eigen::VectorXd v2;
-	try{ 
-		v2= lu.solve(b);
-	}catch(...){
-		assert(false&&"XylemFlux::linearSystem error when solving wat. pot. xylem with Eigen ");
+	if(andersonX.empty()){
+		andersonScale = g.cwiseAbs();
+		for(int i = 0; i < g.size(); i++){if(andersonScale(i) == 0){andersonScale(i) = 1.;}}
+	}
+	andersonX.push_back(x); andersonG.push_back(g);
+	if(andersonX.size() > andersonDepth + 1){
+		andersonX.erase(andersonX.begin()); andersonG.erase(andersonG.begin());
+	}
+	int m = andersonX.size() - 1;
+	if(m == 0){return;}//Picard step
+	Eigen::MatrixXd dF(g.size(), m), dG(g.size(), m);
+	for(int j = 0; j < m; j++){
+		dF.col(j) = ((andersonG[j+1] - andersonX[j+1]) - (andersonG[j] - andersonX[j])).cwiseQuotient(andersonScale);
+		dG.col(j) = andersonG[j+1] - andersonG[j];
+	}
+	Eigen::VectorXd gamma = dF.colPivHouseholderQr().solve((g - x).cwiseQuotient(andersonScale));
+	Eigen::VectorXd xnew = g - dG*gamma;
+	bool accept = true;
+	for(int i = 0; i < g.size(); i++){
+		if(g(i) == 0){xnew(i) = 0.;}//e.g. psiXyl of new nodes, @see Photosynthesis::loopCalcs
+		accept = accept && std::isfinite(xnew(i)) && (xnew(i)*g(i) >= 0);
+	}
+	if(!accept){
+		if(verbose_photosynthesis > 1){std::cout<<"Photosynthesis::andersonUpdate: restart at loop "<<loop<<std::endl;}
+		andersonX.erase(andersonX.begin(), andersonX.end() - 1);
+		andersonG.erase(andersonG.begin(), andersonG.end() - 1);
+		return;
+	}
+	for(int i = 0; i < nx; i++){psiXyl.at(i) = xnew(i);}
+	for(int i = 0; i < nl; i++){
+		ci.at(i) = xnew(nx + i);
+		pg.at(i) = xnew(nx + nl + i);
+		k_stomatas.at(i) = xnew(nx + 2*nl + i);
 	}
-	std::vector<double> v3(&v2[0], v2.data()+v2.cols()*v2.rows());
-	psiXyl = v3;
 }
 
 /* 
-		Computes error % for each segment for each of the variables of interestes.
-		@param sim_time_ [day]           simulation time, needed when doLog = true
+		Computes the relative change between the last two loops (maxErr) for each of the variables of interest, and its maximum (maxMaxErr): 
+		one pass over the nodes (xylem wat. pot., also checks the values), one over the leaf segments (An, gco2, ci, pg, k_stomatas),
+		and one over the segments (water fluxes, @see XylemFlux::segFluxes, computed here as they are only needed to evaluate convergence).
+		Without log and verbose output, the remaining passes are skipped as soon as the loop cannot stop 
+		(maxMaxErr >= limMaxErr or loop + 1 <= minLoop, but not in the last loop allowed by maxLoop, @see Photosynthesis::solve_photosynthesis), 
+		the fluxes of the last loop are then computed from psiXyl_old when needed. 
+		With Anderson acceleration nothing is skipped: the fluxes are compared to those of the last loop output (not of psiXyl_old).
+		@param sim_time_ [day]           simulation time, needed for the fluxes
+		@param sxx_ [cm]                 soil matric potentials given per segment or per soil cell
+		@param cells_                    indicates if the matric potentials are given per cell (True) or by segments (False)
 */
-
-void Photosynthesis::getError(double simTime)
+void Photosynthesis::getError(double simTime, const std::vector<double>& sxx_, bool cells_)
 {
-	std::ofstream myfile1;
-	if(doLog){
-		std::string name1 = "errphoto";
-		std::string name2 = ".txt";
-		std::string namefile = name1 +"_"+ std::to_string(simTime)+ "_"+std::to_string(loop) + name2;
-		myfile1.open (namefile);
-		myfile1 <<"psi err "<<std::endl;
-		myfile1 <<std::endl;}
+	bool lastLoop = (loop + 1 > maxLoop); // stops in any case, all errors are computed
+	bool skip = (!doLog)&&(verbose_photosynthesis == 0)&&(andersonDepth == 0)&&(!lastLoop);
+	bool canStop = (loop + 1 > minLoop);
+	std::ostringstream myfile1;
+	if(doLog){myfile1 <<"psi err "<<std::endl<<std::endl;}
 	
 	for (int i = 0; i < this->psiXyl.size(); i++) 
 	{ 
-		// maxErr[0] =std::max(std::abs((this->psiXyl[i]-psiXyl_old[i])/this->psiXyl[i]),maxErr[0]);
-		// if(doLog){
-			// myfile1 << "maxErr[1] "<<i <<", "<<plant->organTypes[i]<<", "<<plant->subTypes[i]<<", "<<this->psiXyl[i]<<" "<<psiXyl_old[i];
-		// }
-		assert(this->psiXyl[i]==this->psiXyl[i] && "Photosynthesis xylnew is nan");
 		assert(!std::isnan(this->psiXyl[i]) && "Photosynthesis xylcurrent is nan" );
 		assert(!std::isnan(psiXyl_old[i]) && "Photosynthesis xylold is nan" );
-		//std::cout<<this->psiXylnew[i]<<" "<<(this->psiXylnew[i]<=0)<<" "<<std::flush;
 		if(this->psiXyl[i]>0){
 			std::cout<< "Photosynthesis xyl >0, "<<i<<" "<<this->psiXyl[i]<<std::endl;
 			assert(false);}
 			
 		double tempVal = 1;
-		
-		if(this->psiXyl[i] !=0){tempVal= std::min(std::abs(this->psiXyl[i]), std::abs(this->psiXyl_old[i]));}else{tempVal=1.;}
+		if(this->psiXyl[i] !=0){tempVal= std::min(std::abs(this->psiXyl[i]), std::abs(this->psiXyl_old[i]));}
 		maxErr[0] =std::max(std::abs((this->psiXyl[i]-psiXyl_old[i])/tempVal),maxErr[0]);
-		if( i < (this->psiXyl.size() - 1)){
-			if(this->outputFlux[i] !=0){tempVal=  std::min(std::abs(this->outputFlux[i]), std::abs(this->outputFlux_old[i]));
-				}else{tempVal=1.;}
-			maxErr[5] =std::max(std::abs((this->outputFlux[i]-outputFlux_old[i])/tempVal),maxErr[5]);
-			maxErr[7] += std::abs((this->outputFlux[i]-outputFlux_old[i])/tempVal);//becasue sum of fluxes important 
-		}
-		
-		if(doLog){
-			myfile1 <<i<<" "<<", maxErr[5] "<<plant->organTypes[std::max(i-1,0)]<<" "<<maxErr[0];
-			myfile1<<" "<<psiXyl[i]<<" "<<psiXyl_old[i]<<" "<<i<<" "<< (this->psiXyl.size() - 1) ;
-			if( i < (this->psiXyl.size() - 1)){
-				myfile1<<" "<<std::abs((this->outputFlux[i]-outputFlux_old[i])/this->outputFlux[i]);
-				myfile1 <<" "<<outputFlux[i] <<" "<<outputFlux_old[i]<<" "<<maxErr[5];
-			}
-			myfile1 <<std::endl;
-		}
+		if(doLog){myfile1 <<i<<" "<<maxErr[0]<<" "<<psiXyl[i]<<" "<<psiXyl_old[i]<<std::endl;}
 	}
-	myfile1 <<std::endl<<std::endl<<std::endl;
+	
+	if(skip && !(canStop && (maxErr[0] < limMaxErr))){
+		maxMaxErr = maxErr[0];
+		return;
+	}
+	if(doLog){myfile1 <<std::endl<<std::endl<<std::endl;}
 	for (int i = 0; i < this->An.size(); i++) 
-	{ //f = f < 0 ? -f : f;
-		
+	{
 		double tempVal = 1;
 		if(this->An[i] !=0){tempVal= std::min(std::abs(this->An[i]), std::abs(An_old[i]));}else{tempVal=1.;}
 		maxErr[1] =std::max(std::abs((this->An[i]-An_old[i])/tempVal),maxErr[1]);
@@ -242,15 +275,13 @@ void Photosynthesis::getError(double simTime)
 		if(this->ci[i] !=0){tempVal=std::min(std::abs(this->ci[i]), std::abs(ci_old[i]));}else{tempVal=1.;}
 		maxErr[3] =std::max(std::abs((this->ci[i]-ci_old[i])/tempVal),maxErr[3]);
 		
-		if(this->pg[i] !=0){tempVal=std::min(std::abs(this->pg[i]), std::abs(this->pg[i]));}else{tempVal=1.;}
+		if(this->pg[i] !=0){tempVal=std::abs(this->pg[i]);}else{tempVal=1.;}
 		maxErr[4] =std::max(std::abs((this->pg[i]-pg_old[i])/tempVal),maxErr[4]);
 		
-		//	if(doLog){myfile1 <<"in if(plant->organTypes[i] == 4){"<<std::endl;} }
-		
 		if(this->k_stomatas[i] !=0){tempVal=std::min(std::abs(this->k_stomatas[i]),std::abs(this->k_stomatas_old[i])) ;}else{tempVal=1.;}
 		maxErr[6] =std::max(std::abs((this->k_stomatas[i]-k_stomatas_old[i])/tempVal),maxErr[6]);
 		if(doLog){
-			myfile1 <<i<<" "<<maxErr[1] <<" "<<maxErr[2]<<" "<<maxErr[3]<<" "<<maxErr[4] <<" "<<maxErr[5] <<" "<<maxErr[6]<<" an: ";
+			myfile1 <<i<<" "<<maxErr[1] <<" "<<maxErr[2]<<" "<<maxErr[3]<<" "<<maxErr[4] <<" "<<maxErr[6]<<" an: ";
 			myfile1  <<this->An[i]<<" an_old: "<<An_old[i]<<" gco2: "<<this->gco2[i]<<" gco2_old> "<<gco2_old[i];
 			myfile1 <<" ci: "<<this->ci[i]<<" ci_old:"<<ci_old[i]<<" "<<pg[i]<<" "<<pg_old[i]<<" ks: ";
 			myfile1 << k_stomatas[i]<<" ksold: "<< k_stomatas_old[i] <<std::endl;
@@ -259,6 +290,30 @@ void Photosynthesis::getError(double simTime)
 		assert(!std::isnan(pg_old[i]) && "Photosynthesis psi old guard cell is nan");
 	}
 	maxMaxErr = *std::max_element(maxErr.begin(), maxErr.end());
+	
+	if(!skip || (canStop && (maxMaxErr < limMaxErr))){
+		if(!fluxOldCurrent){//with the stomatal conductances of the last loop
+			std::swap(k_stomatas, k_stomatas_old);
+			outputFlux_old = segFluxes(simTime, this->psiXyl_old, sxx_, false, cells_, std::vector<double>());//approx = false
+			std::swap(k_stomatas, k_stomatas_old);
+			fluxOldCurrent = true;
+		}
+		outputFlux = segFluxes(simTime, this->psiXyl, sxx_, false, cells_, std::vector<double>());//approx = false
+		fluxCurrent = true;
+		if(doLog){myfile1 <<std::endl<<"flux err "<<std::endl<<std::endl;}
+		for (int i = 0; i < this->outputFlux.size(); i++) 
+		{
+			double tempVal = 1;
+			if(this->outputFlux[i] !=0){tempVal=  std::min(std::abs(this->outputFlux[i]), std::abs(this->outputFlux_old[i]));}
+			maxErr[5] =std::max(std::abs((this->outputFlux[i]-outputFlux_old[i])/tempVal),maxErr[5]);
+			maxErr[7] += std::abs((this->outputFlux[i]-outputFlux_old[i])/tempVal);//becasue sum of fluxes important 
+			if(doLog){myfile1 <<i<<" "<<plant->organTypes[i]<<" "<<maxErr[5]<<" "<<outputFlux[i] <<" "<<outputFlux_old[i]<<std::endl;}
+		}
+		maxMaxErr = *std::max_element(maxErr.begin(), maxErr.end());
+	}
+	if(doLog){
+		trace.push_back({"errphoto_"+ std::to_string(simTime)+ "_"+std::to_string(loop) + ".txt", myfile1.str()});
+	}
 }	
 
 
@@ -306,6 +361,28 @@ void Photosynthesis::initStruct(double sim_time_){
 		dv.resize(seg_leaves_idx.size(), 0.);
 		//sideSurface.resize(seg_leaves_idx.size(), 0.);
 	}
+	int nl = seg_leaves_idx.size();
+	leafX.resize(nl); leafY.resize(nl); leafPrevX.resize(nl);
+	leafVz.resize(nl); leafSideArea.resize(nl); leafEvCoef.resize(nl);
+	leafRx.resize(nl); leafEa.resize(nl);
+	for(int li_ = 0; li_ < nl; li_++){
+		int li = seg_leaves_idx.at(li_);
+		leafX.at(li_) = plant->segments.at(li).x;
+		leafY.at(li_) = plant->segments.at(li).y;
+		if(li_ > 0){
+			leafPrevX.at(li_) = plant->segments.at(seg_leaves_idx.at(li_-1)).x;
+		}else{ // first leaf segment: the parent node, i.e. the start of the segment ending at node x (the seed node is never new)
+			int x = leafX.at(li_);
+			auto parent = std::find_if(plant->segments.begin(), plant->segments.end(), [x](const Vector2i& s) { return s.y == x; });
+			if((parent == plant->segments.end())&&(x != 0)){
+				throw std::runtime_error("Photosynthesis::initStruct: no parent node for the first leaf segment");
+			}
+			leafPrevX.at(li_) = (parent == plant->segments.end()) ? x : parent->x;
+		}
+		auto v = plant->nodes.at(leafY.at(li_)).minus(plant->nodes.at(leafX.at(li_)));
+		leafVz.at(li_) = v.z / lengths.at(li);
+		leafSideArea.at(li_) = plant->leafBladeSurface.at(li)*2;//transpiration on both sides
+	}
 	for(int li_ = 0; li_ < this->seg_leaves_idx.size(); li_++){
 		int li = this->seg_leaves_idx.at(li_);
 		l = lengths.at(li);		//a = plant->radii[li]; xylem data. issue: need other radius
@@ -323,6 +400,7 @@ void Photosynthesis::initStruct(double sim_time_){
 		fv.at(li_) = -perimeter*kr;
 		tauv.at(li_) = std::sqrt(perimeter*kr/kx);
 		dv.at(li_) = std::exp(-tauv.at(li_)*l)-std::exp(tauv.at(li_)*l);
+		leafEvCoef.at(li_) = -fv.at(li_)*(1./(tauv.at(li_)*dv.at(li_)))*(2.-std::exp(-tauv.at(li_)*l)-std::exp(tauv.at(li_)*l));
 		if((kr<0)||(kx<=0))
 		{
 			std::cout<<"pt, st "<<ot<<" "<<st<<" "<<li<<" "<<li_<<std::endl;
@@ -411,112 +489,113 @@ void Photosynthesis::doAddGravity()
 
 
 	/*
-		Computes the output variables => ci, go2, An, Ev
+		Computes the output variables => ci, go2, An, Ev, pg, k_stomatas
+		from psiXyl and the previous values (ci_old, pg_old, ...), 
+		for all leaf segments (in parallel if loopThreads > 0), 
+		checks the results and adds them to the trace afterwards (if doLog)
 		@param simtime		
 	*/
 void Photosynthesis::loopCalcs(double simTime){
-	std::ofstream myfile4;
+	int n = seg_leaves_idx.size();
+	if((verbose_photosynthesis ==2)){std::cout<<"in loopcalcs "<<n<<" leaf segments"<<std::endl;}
+	if(loopPool){
+		ThreadPool::TaskGroup group;
+		int chunk = std::max(256, n/(8*loopThreads)+1);
+		for(int i0 = 0; i0 < n; i0 += chunk){
+			int i1 = std::min(i0+chunk, n);
+			loopPool->run(group, [this, i0, i1] { leafGasExchange(i0, i1); });
+		}
+		loopPool->wait(group);
+	}else{
+		leafGasExchange(0, n);
+	}
+	for(int i = 0; i<n;i++)
+	{
+		if((std::abs(fv[i]) > 1e-16)&&((!std::isfinite(this->pg[i]))||(!std::isfinite(k_stomatas[i])))) {
+			writeLeafLog(std::cout, i);
+			throw std::runtime_error("Phtotosynthesis: nan or Inf k_stomatas.at(i) of pg.at(i)");
+		}
+	}
 	if(doLog)
 	{
-		std::string name1 = "loopphoto";
-		std::string name2 = ".txt";
-		std::string namefile = name1 +"_"+std::to_string(simTime)+"_"+std::to_string(loop) + name2;
-		myfile4.open (namefile);
+		std::ostringstream myfile4;
+		for(int i = 0; i<n;i++){writeLeafLog(myfile4, i);}
+		trace.push_back({"loopphoto_"+std::to_string(simTime)+"_"+std::to_string(loop) + ".txt", myfile4.str()});
 	}
-	for(int i = 0; i<seg_leaves_idx.size();i++)
+}
+
+	/*
+		Photosynthesis and stomatal opening of the leaf segments [i0, i1), see loopCalcs
+		(geometry precomputed by initStruct, no output), writes all entries of An, gco2, ci, pg and k_stomatas
+	*/
+void Photosynthesis::leafGasExchange(int i0, int i1){
+	const double* psi = psiXyl.data();
+	for(int i = i0; i<i1;i++)
 	{
-		int idl= seg_leaves_idx.at(i);
-		if((verbose_photosynthesis ==2)){std::cout<<"in loopcalcs "<<i<<" "<<idl<<std::endl;}
-		double l = lengths.at(idl);
-		//double a = plant->radii[idl];
-		double sideArea = plant->leafBladeSurface.at(idl)*2;//
-		//double perimeter = sideArea/l*2;
-		if((verbose_photosynthesis ==2)){std::cout<<"geom "<<l<<" "<<sideArea<<std::endl;}
-		double eps = 0.;
-		double rxi = this->psiXyl.at(plant->segments.at(idl).x);
+		double rxi = psi[leafX[i]];
 		if(rxi == 0) //node just got created
 		{
-			int newxid = plant->segments.at(seg_leaves_idx.at(i-1)).x;
-			rxi = this->psiXyl.at(newxid);
-			if(doLog ){myfile4<<"new rxi "<<plant->segments.at(idl).x<<" "<< newxid <<" "<<rxi<<std::endl;}
+			rxi = psi[leafPrevX[i]];
 		}
-		double rxj = this->psiXyl[plant->segments.at(idl).y];
+		double rxj = psi[leafY[i]];
 		if(rxj == 0)//node just got created
 		{
-			auto n1 = plant->nodes[plant->segments.at(idl).x];
-			auto n2 = plant->nodes[plant->segments.at(idl).y];
-			auto v = n2.minus(n1);
-			double vz = v.z / l; // normed direction
-			rxj = this->psiXyl.at(plant->segments.at(idl).x)-vz;
-					
-			if(doLog ){myfile4<<"new rxj "<<plant->segments.at(idl).y<<" "<< vz <<" "<<rxj<<std::endl;}
+			rxj = psi[leafX[i]]-leafVz[i];
 		}
+		leafRx[i] = rxi + rxj;
 		double p_lhPa =(rxi + rxj)*0.5*0.9806806;// cm => hPa
 		//(mg mmol-1)* hPa /((hPa cm3K−1mmol−1) mg cm-3 K) =(-)
-		double HRleaf = std::exp(Mh2o*this->pg.at(i)*0.9806806 /(rho_h2o*R_ph*TleafK)) ;//fractional relative humidity in the intercellular spaces
-		//double ea = es - VPD;
+		double HRleaf = std::exp(Mh2o*pg_old[i]*0.9806806 /(rho_h2o*R_ph*TleafK)) ;//fractional relative humidity in the intercellular spaces
 		double ea_leaf = es * HRleaf;//hPa
-		if((verbose_photosynthesis ==2)){std::cout<<"git to leaf "<<ea_leaf<<" "<<HRleaf<<std::endl;}
-		if(std::abs(fv.at(i)) > 1e-16)//i.e., perimeter * kr > 1e-16 like for @see Xylem::solveLinear
+		leafEa[i] = ea_leaf;
+		if(std::abs(fv[i]) > 1e-16)//i.e., perimeter * kr > 1e-16 like for @see Xylem::solveLinear
 		{
-			if((verbose_photosynthesis ==2)){std::cout<<"in compute gco2 "<<sideArea<<" "<<(sideArea > 1e-16)<<std::endl;}
-			//sideArea = 2. * M_PI * a ;//
 			//carboxylation and electron transport  rate
-			Vc.at(i) = std::min(std::max(Vcmax.at(i) * (ci.at(i) - delta) / (ci.at(i) + Kc*(1. + oi/Ko)),0.),Vcmax.at(i)); //Eq 8
-			
-			if(ci.at(i) == 2. * delta){eps = 0.001*delta ;}
-			Vj.at(i) = std::max(J/4. * (ci.at(i) - delta)/ (ci.at(i) - 2. * delta+eps), 0.) ;//Eq 22
-			
+			double ci_ = ci_old[i];
+			Vc[i] = std::min(std::max(Vcmax[i] * (ci_ - delta) / (ci_ + Kc*(1. + oi/Ko)),0.),Vcmax[i]); //Eq 8
+			double eps = (ci_ == 2. * delta) ? 0.001*delta : 0.;
+			Vj[i] = std::max(J/4. * (ci_ - delta)/ (ci_ - 2. * delta+eps), 0.) ;//Eq 22
 			//An mol m-2 s-1
-			An.at(i) = std::min(Vc.at(i), Vj.at(i)) - Rd;//Eq 6
+			An[i] = std::min(Vc[i], Vj[i]) - Rd;//Eq 6
 			//fw (-)
-			fw.at(i) = fwr + (1.- fwr)*std::exp(-std::exp(-sh*(p_lhPa*0.0001 - p_lcrit)*10228.)) ;//Eq 5
+			fw[i] = fwr + (1.- fwr)*std::exp(-std::exp(-sh*(p_lhPa*0.0001 - p_lcrit)*10228.)) ;//Eq 5
 			// mol CO2 m-2 s-1
-			gco2.at(i) = g0 + fw.at(i) * a1 *( An.at(i) + Rd)/(ci.at(i) - deltagco2.at(i));//tuzet2003
-			// mol H2O m-2 s-1 MPa-1
-			//double k_stomate_1 = (gco2.at(i) * a2) / Patm;
+			gco2[i] = g0 + fw[i] * a1 *( An[i] + Rd)/(ci_ - deltagco2[i]);//tuzet2003
 			//(mol m-2 s-1)*(mmol/mol)*(hPa/hPa) * (mg mmol-1) /(mg cm-3) *(h/d)*(s/h)*(m2 m-2) =  ( cm3)/d*(cm-2)
-			Jw.at(i) = (gco2.at(i) * a2) *1000* (ea_leaf - ea)/Patm * Mh2o/rho_h2o * 24.*3600*1e-4 ;//in cm3 cm-2 d-1
-			Ev.at(i) = Jw.at(i)* sideArea; //in cm3 d-1
-            //double f = -2*a*M_PI*kr; // flux is proportional to f // *rho*g
-			
+			Jw[i] = (gco2[i] * a2) *1000* (ea_leaf - ea)/Patm * Mh2o/rho_h2o * 24.*3600*1e-4 ;//in cm3 cm-2 d-1
+			Ev[i] = Jw[i]* leafSideArea[i]; //in cm3 d-1
 			//ci and pg
 			//gruard cell wat. pot. to havee water flux from xylem to gard cell. kr = permeability of xylem membrane only.
-			this->pg.at(i) = (-1/2.)*((Ev.at(i))/(-fv.at(i)*(1./(tauv.at(i)*dv.at(i)))
-				*(2.-std::exp(-tauv.at(i)*l)-std::exp(tauv.at(i)*l))) - (rxi + rxj)) ;//cm
-				
-			k_stomatas.at(i) = Jw.at(i)/(this->pg.at(i) - psi_air);
-			if((verbose_photosynthesis ==2)){
-																				
-				std::cout<<"sizes "<<An.size()<<" "<< gco2.size()<<" "<<ci.size()<<" "<<ci_old.size() <<std::endl;
-
-			}
-			ci.at(i) = (cs*a1*fw.at(i) +deltagco2.at(i))/(1+a1* fw.at(i)) ;//Eq 26	
-			if((!std::isfinite(this->pg.at(i)))||(!std::isfinite(k_stomatas.at(i)))) {
-			std::cout<<"shape leaf "<<idl<<" "<<sideArea<<" "<<ci_old.at(i)<<" "<<ci.at(i)<<std::endl;
-			std::cout<<"an calc "<<An.at(i)<<" "<<Vc.at(i)<<" "<< Vj.at(i)<<" "<<J<<" "<<Vcmax.at(i)<<" "<<Kc<<" "<<Ko<<" ";
-			std::cout<<" "<<delta<<" "<<oi<<" "<<eps<<std::endl;
-			std::cout<<"forgco2 "<<gco2.at(i) <<" "<< g0<<" "<<  fw.at(i) <<" "<<  a1 <<" "<< An.at(i)<<" "<< Rd<<" "<< deltagco2.at(i)<<std::endl;
-			std::cout<<"forJW, Jw "<<Jw.at(i)<<" drout_in "<<(this->pg.at(i) - (rxi + rxj)/2)<<" "<<ea_leaf <<" "<< ea<<" "<<Patm<<" "<<Mh2o<<" "<<rho_h2o <<std::endl;
-			std::cout<<"forpg "<<sideArea <<" "<< Jw.at(i)<<" "<<fv.at(i)<<" "<<tauv.at(i)<<" "<<dv.at(i)<<" "<<l<<" "<<rxi <<" "<< rxj<<" "<<this->pg.at(i)<<" numleaf: "<<i <<std::endl;
-			std::cout<<"diff Ev and lat fluw: "<<Ev.at(i)<<std::endl;//<<" "<<outputFluxL.at(i)
-				throw std::runtime_error("Phtotosynthesis: nan or Inf k_stomatas.at(i) of pg.at(i)");
-			}
-			
-		}else{ci.at(i) = 0.0;}
-		if(doLog ){
-			if((verbose_photosynthesis ==2)){std::cout<<"dolog loop calcs "<<std::endl;}
-			myfile4<<"shape leaf "<<idl<<" "<<sideArea<<" "<<ci_old.at(i)<<" "<<ci.at(i)<<std::endl;
-			myfile4<<"an calc "<<An.at(i)<<" "<<Vc.at(i)<<" "<< Vj.at(i)<<" "<<J<<" "<<Vcmax.at(i)<<" "<<Kc<<" "<<Ko<<" ";
-			myfile4<<" "<<delta<<" "<<oi<<" "<<eps<<std::endl;
-			myfile4<<"forgco2 "<<gco2.at(i) <<" "<< g0<<" "<<  fw.at(i) <<" "<<  a1 <<" "<< An.at(i)<<" "<< Rd<<" "<< deltagco2.at(i)<<std::endl;
-			myfile4<<"forJW, Jw "<<Jw.at(i)<<" drout_in "<<(this->pg.at(i) - (rxi + rxj)/2)<<" "<<ea_leaf <<" "<< ea<<" "<<Patm<<" "<<Mh2o<<" "<<rho_h2o <<std::endl;
-			myfile4<<"forpg "<<sideArea <<" "<< Jw.at(i)<<" "<<fv.at(i)<<" "<<tauv.at(i)<<" "<<dv.at(i)<<" "<<l<<" "<<rxi <<" "<< rxj<<" "<<this->pg.at(i)<<" numleaf: "<<i <<std::endl;
-			myfile4<<"diff Ev and lat fluw: "<<Ev.at(i)<<std::endl;//<<" "<<outputFluxL.at(i)
+			pg[i] = (-1/2.)*((Ev[i])/leafEvCoef[i] - (rxi + rxj)) ;//cm
+			k_stomatas[i] = Jw[i]/(pg[i] - psi_air);
+			ci[i] = (cs*a1*fw[i] +deltagco2[i])/(1+a1* fw[i]) ;//Eq 26	
+		}else{
+			ci[i] = 0.0;
+			An[i] = An_old[i]; gco2[i] = gco2_old[i]; pg[i] = pg_old[i]; k_stomatas[i] = k_stomatas_old[i];
 		}
 	}
-	if(doLog){myfile4.close();}
+}
 
+	/*
+		Writes the intermediary results of loopCalcs for leaf segment i
+	*/
+void Photosynthesis::writeLeafLog(std::ostream& out, int i) const {
+	int idl = seg_leaves_idx.at(i);
+	double rx = leafRx.at(i);
+	double eps = (ci_old.at(i) == 2. * delta) ? 0.001*delta : 0.; // see leafGasExchange
+	if(psiXyl.at(leafX.at(i)) == 0){ //node just got created
+		out<<"new rxi "<<leafX.at(i)<<" "<< leafPrevX.at(i) <<" "<<psiXyl.at(leafPrevX.at(i))<<std::endl;
+	}
+	if(psiXyl.at(leafY.at(i)) == 0){ //node just got created
+		out<<"new rxj "<<leafY.at(i)<<" "<< leafVz.at(i) <<" "<<(psiXyl.at(leafX.at(i)) - leafVz.at(i))<<std::endl;
+	}
+	out<<"shape leaf "<<idl<<" "<<leafSideArea.at(i)<<" "<<ci_old.at(i)<<" "<<ci.at(i)<<std::endl;
+	out<<"an calc "<<An.at(i)<<" "<<Vc.at(i)<<" "<< Vj.at(i)<<" "<<J<<" "<<Vcmax.at(i)<<" "<<Kc<<" "<<Ko<<" ";
+	out<<" "<<delta<<" "<<oi<<" "<<eps<<std::endl;
+	out<<"forgco2 "<<gco2.at(i) <<" "<< g0<<" "<<  fw.at(i) <<" "<<  a1 <<" "<< An.at(i)<<" "<< Rd<<" "<< deltagco2.at(i)<<std::endl;
+	out<<"forJW, Jw "<<Jw.at(i)<<" drout_in "<<(this->pg.at(i) - rx/2)<<" "<<leafEa.at(i) <<" "<< ea<<" "<<Patm<<" "<<Mh2o<<" "<<rho_h2o <<std::endl;
+	out<<"forpg "<<leafSideArea.at(i) <<" "<< Jw.at(i)<<" "<<fv.at(i)<<" "<<tauv.at(i)<<" "<<dv.at(i)<<" "<<lengths.at(idl)<<" "<<rx<<" "<<this->pg.at(i)<<" numleaf: "<<i <<std::endl;
+	out<<"diff Ev and lat fluw: "<<Ev.at(i)<<std::endl;
 }
 			   
 
@@ -4,6 +4,7 @@
 
 #include "MappedOrganism.h"
 #include "XylemFlux.h"
+#include "ThreadPool.h"
 #include <map>
 #include <iostream>
 #include <fstream>
@@ -33,9 +34,9 @@ public:
 	void linearSystemSolve(double simTime_, const std::vector<double>& sxx_, bool cells_, 
 				const std::vector<double> soil_k_);///< main function, solves the flux equations
 	
-	void loopCalcs(double simTime); ///<solves photosynthesis/stomatal opening equations 
+	void loopCalcs(double simTime); ///<solves photosynthesis/stomatal opening equations (from psiXyl, ci_old and pg_old)
 	void getAg4Phloem(); ///< Converts An [mol CO2 m-2 s-1] to Ag4Phloem [mmol Suc d-1]
-	void getError(double simTime);///< Computes error % for each segment for each of the variables of interestes.
+	void getError(double simTime, const std::vector<double>& sxx_, bool cells_);///< Computes error % for each segment for each of the variables of interestes.
 	
 	void doAddGravity(); ///< add gravitational wat. pot to total wat. pot. (used in phloem module)
 	//void r_forPhloem(double lightTimeRatio, int ot);
@@ -59,6 +60,7 @@ public:
 	std::vector<double> psiXyl4Phloem; //sum of psiXyl + gravitational wat. pot.
 	std::vector<double> gco2;
 	bool doLog = false; int verbose_photosynthesis = 0;
+	int loopThreads = 0; // number of threads used by loopCalcs (0 = serial)
 	
 	//		to evaluate convergence, @see Photosynthesis::getError
 	int maxLoop = 1000; int minLoop = 1;
@@ -72,6 +74,11 @@ public:
 	std::vector<double> ci_old ;
 	std::vector<double> pg_old ;
 	std::vector<double> k_stomatas_old ;
+	std::vector<std::pair<std::string, std::string>> trace; // if doLog: name and content of the log files of each loop, written at the end of solve_photosynthesis
+	
+	//		acceleration of the fixed point iteration, @see Photosynthesis::andersonUpdate
+	int andersonDepth = 0; // 0: Picard iteration, m > 0: Anderson acceleration using the last m iterates
+	double solveTime = 0.; // wall time of the last solve_photosynthesis call [s]
 	
 	
 	//			initial guesses
@@ -108,6 +115,9 @@ protected:
 	void initCalcs(double sim_time_);
 	void initStruct(double sim_time_);
 	void initVcVjRd();
+	void leafGasExchange(int i0, int i1); ///< loopCalcs for the leaf segments [i0, i1)
+	void writeLeafLog(std::ostream& out, int i) const; ///< intermediary results of loopCalcs for leaf segment i
+	void andersonUpdate(); ///< replaces psiXyl, ci, pg and k_stomatas by the Anderson accelerated iterate
 	
 	//			physicall constant (no need to parametrise)
 	double a2 = 1.6; //gco2[i] * a2 = gh2o
@@ -127,7 +137,16 @@ protected:
 	//			other parameters and runtime variables
 	std::vector<std::shared_ptr<Organ>> orgsVec;
 	std::vector<int> seg_leaves_idx;
+	//			per leaf segment, @see Photosynthesis::initStruct
+	std::vector<int> leafX, leafY, leafPrevX; // xylem nodes of the segment, first node of the previous leaf segment
+	std::vector<double> leafVz, leafSideArea; // normed z direction, leaf blade surface (both sides) [cm2]
+	std::vector<double> leafEvCoef; // Ev / (rxi + rxj - 2 pg), transpiration per guard cell wat. pot. difference [cm2 d-1]
+	std::vector<double> leafRx, leafEa; // xylem wat. pot. at both nodes (sum) [cm], leaf vapour pressure [hPa] of the last loop
+	std::shared_ptr<ThreadPool> loopPool; // used by loopCalcs during solve_photosynthesis, if loopThreads > 0
     bool stop = false;
+	bool fluxCurrent = false, fluxOldCurrent = false; // outputFlux (outputFlux_old) were computed in this (the last) loop, @see Photosynthesis::getError
+	std::vector<Eigen::VectorXd> andersonX, andersonG; // last iterates (input and output of one loop)
+	Eigen::VectorXd andersonScale; // scaling of the fixed point residual
 
 };
 
@@ -37,7 +37,6 @@ using namespace std;
 #include <sstream>
 #include <vector>
 
-extern char message[], name_[] ;
 void _LogMessage(const char* message)  ;
 void Update_Output(bool unconditional = false) ;
 int MsgBox(const char* message, const char* titre = "Message", int button0 = 1024, int button1 = 0, int button2 = 0) ;
@@ -149,6 +148,7 @@ class Fortran_vector
 	void set(const double &a);								// affecte la valeur indique  tous les lments
 	void set(const Fortran_vector &v);						// vecteur argument = v, qui doit tre de mme taille
 	void append(const Fortran_vector & v) ;					// fusion avec v en queue, eq.   X = bind(X, v)
+	void resize(int size, const double &a = 0.) ;			// garde v[1..min(n, size)], les nouveaux lments valent a ; pas de rallocation si la taille ne change pas
 	void sequentialFill(std::vector<double> vecd, int smallVal, int bigVal);
 	void zero(const Fortran_vector &z) ; // annule toute composante [i] infrieure en val.abs.  z[i]
 
@@ -31,8 +31,6 @@
 #include <PiafMunch/PM_arrays.h>
 
 
-char message[10000], name_[300] ;
-
 void Update_Output(bool unconditional) {}
 
 void _LogMessage(const char* message) {
@@ -146,6 +144,7 @@ void Fortran_matrix::display(int i1, int i2, int j1, int j2) {
 	if ((i1 < 1) || (i2 > m_) || (j1 < 1) || (j2 > n_)) {
 		assert(false) ;
 	}
+	char message[10000] ; // local buffer, displays may run concurrently
 	int i, j, l = sprintf( message, "   "), ll = 2 ;
 	for (j=j1 ; j <= j2 ; j++) {
 		l = sprintf( message + ll, "             ") ; ll = 14 * (j-j1+1) - 1 ;
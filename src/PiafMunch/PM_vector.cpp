@@ -183,6 +183,18 @@ void Fortran_vector::append(const Fortran_vector & v) {
 
 
 
+void Fortran_vector::resize(int size, const double &a) {
+	if (size < 0)	assert(false);
+	int n = (int)v_[0] ;
+	if (size == n) return ;
+	double * temp = new double [1 + size];
+	temp[0] = size ;
+	for (int i = 1 ; i <= size ; i++)
+		temp[i] = (i <= n) ? v_[i] : a ;
+	delete [] v_ ;
+	v_ = temp ;
+}
+
 void Fortran_vector::sequentialFill(std::vector<double> vecd, int smallVal, int bigVal) {
 	int n1 = (int)v_[0] ; int n2 = (int)vecd.size();
 	assert((smallVal <= bigVal)&&"Fortran_vector::sequentiallFill: smallVal > bigVal");
@@ -209,6 +221,7 @@ void Fortran_vector::zero(const Fortran_vector& z) {
 }
 //display(int i1 = 1, int i2 = size(), int n_per_line = 4)
 void Fortran_vector::display(int i1, int i2, int n_per_line) {
+	char message[10000] ; // local buffer, displays may run concurrently
 	int n = size() ;
 	if (i2 == 0)  i2 = n ;
 	if ((i1 < 1) || (i2 > n)) {
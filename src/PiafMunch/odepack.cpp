@@ -25,6 +25,7 @@
 
 #include <PiafMunch/odepack.h>
 #include <time.h>
+#include <algorithm>
 
 // La fonction suivante "habille" un Fortran_vector en N_Vector, i.e. "cre" un N_Vector
 // qui PARTAGE LES MEMES DONNEES (atributs v_ et NV_DATA_S, resp.)  que le Fortran_vector d'origine.
@@ -37,28 +38,46 @@ N_Vector InPlace_NVector(Fortran_vector &v) {
 
 int check_flag(void *flagvalue, string funcname_, int opt);   // utilis en 'verbose' dans cvode
 const time_t current = time(NULL) ;
-Fortran_vector y ;
-void* cvode_mem ;        // espace de travail du solveur; ventuellement utilis par la fonction aux()
-void* arkode_mem;        // espace de travail du solveur; ventuellement utilis par la fonction aux()
 
-void (*ff)(double t ,double* y, double* ydot) ;
+// Donnes passes aux fonctions de rappel de cvode / arkode (user_data), au lieu de variables globales :
+// plusieurs solveurs peuvent ainsi tourner simultanment (threads)
+struct SolverData {
+	void (*f)(double t, double* y, double* ydot, void* user_data) ; // le systme  rsoudre
+	void (*rootfind)(double t, double* y, double* g, void* user_data) ; // (optionnel) dfinit d'ventuelles quations g(t,y)=0  rsoudre
+	void* user_data ; // transmis  f et rootfind (e.g. l'objet PhloemFlux)
+	void* cvode_mem ; // espace de travail du solveur (utilis par Jac_)
+	SUNLinearSolver LS ; // solveur linaire (rinit. par Jac_)
+	SparseJacobian* jac ; // (optionnel) jacobien analytique pour KLU
+	Preconditioner* prec ; // (optionnel) prconditionneur utilisateur (cvode_spils)
+	int prec_lr ; // ct o prec est appliqu si le solveur linaire appelle les deux (PREC_BOTH) : 1 = gauche ; 0 =  chaque appel
+};
+
+#define DIRECT_CONFIG 1 // SolverMemory::config[0]
+#define SPILS_CONFIG 2
+
+static void timeOfDay(char* s) { // heure courante "%H:%M:%S" (thread safe)
+	struct tm tm_ ;
+#ifdef _WIN32
+	localtime_s(&tm_, &current) ;
+#else
+	localtime_r(&current, &tm_) ;
+#endif
+	strftime(s, 50, "%H:%M:%S", &tm_) ;
+}
 
 inline int ffff(realtype t, N_Vector yy, N_Vector yydot, void *f_data) {
 // Forme de f compatible avec cvode: noter dcalage des indices entre double* y et NV_DATA_S(N_Vector y)
-    ff(t, NV_DATA_S(yy) - 1, NV_DATA_S(yydot) - 1) ;
+	SolverData* data = (SolverData*)f_data ;
+	data->f(t, NV_DATA_S(yy) - 1, NV_DATA_S(yydot) - 1, data->user_data) ;
 	return 0;
 }
 
-// les 2 fonctions suivantes sont  reformuler avec fonctions 'synonymes'  traiter comme f
-// pour devenir indpendantes du nom d'appel ('rootfind'...)
-extern void rootfind(double t, double* y, double* g);       // (optionnel) dfinit d'ventuelles quations g(t,y)=0  rsoudre
-
 inline int gg(realtype t, N_Vector yy, realtype *g, void *g_data) {  // Idem pour rootfind / gg :
-    rootfind(t, NV_DATA_S(yy) - 1, g-1) ; // retourne le nb d'quations dans la var. n
-    return 0;
+	SolverData* data = (SolverData*)g_data ;
+	data->rootfind(t, NV_DATA_S(yy) - 1, g-1, data->user_data) ; // retourne le nb d'quations dans la var. n
+	return 0;
 }
 
-SUNLinearSolver LS(NULL);
 /* Other Constants pour calcul KLU_DQ_Jac : */
 #define MIN_INC_MULT RCONST(1000.0)
 #define ZERO         RCONST(0.0)
@@ -75,7 +94,8 @@ static int Jac_(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_dat
 	realtype *y_data, *fy_data, *ftemp_data, *ewt_data, *cns_data;
 	sunindextype i, j, N, NNZ, NNZ0, retval, npnz, ntnz = 0; // ntnz sera le nombre de NZ effectivement trouv, y compris les lments diagonaux mme si nuls
 	realtype J_ij ; bool nnz_str_changed(false) ;
-	cv_mem = (CVodeMem)cvode_mem;
+	SolverData* sdata = (SolverData*)user_data ;
+	cv_mem = (CVodeMem)(sdata->cvode_mem);
 	SUNMatZero(J);
 	y_data = N_VGetArrayPointer(y);
 	retval = 0;
@@ -181,17 +201,129 @@ static int Jac_(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_dat
 		nnz_str_changed = true;
 	}
 	if (nnz_str_changed) {
-		if (LS) { // le solveur a dj t initialis par cvode_direct( ), donc une rinit. PARTIAL suffit :
-			SUNLinSol_KLUReInit(LS, J, ntnz, SUNKLU_REINIT_PARTIAL);
+		if (sdata->LS) { // le solveur a dj t initialis par cvode_direct( ), donc une rinit. PARTIAL suffit :
+			SUNLinSol_KLUReInit(sdata->LS, J, ntnz, SUNKLU_REINIT_PARTIAL);
 		}
 	}
 	return(0);
 }
 
 
-int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_vector &T, void(*aux)(double,double*), Fortran_vector& atol, Fortran_vector& rtol, int solver,
-	     int nbVar_dot, Fortran_vector** Var_primitive, Fortran_vector** Var_dot, bool verbose, bool STALD, void(*rootfind)(double, double*, double*), int nrootfns, int mu, int ml) {
-	ff = f ;
+// Jacobien analytique (KLU) : le motif est fixe, seules les valeurs sont calcules par l'utilisateur
+static int Jac_analytic(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+	SolverData* sdata = (SolverData*)user_data ;
+	SparseJacobian* jac = sdata->jac ;
+	// cvode efface la matrice (motif compris) avant l'appel : on restaure le motif
+	std::copy(jac->colptrs.begin(), jac->colptrs.end(), SUNSparseMatrix_IndexPointers(J)) ;
+	std::copy(jac->rowvals.begin(), jac->rowvals.end(), SUNSparseMatrix_IndexValues(J)) ;
+	// f(t, y) met  jour les variables intermdiaires de l'objet utilisateur (concentrations, flux) en y
+	sdata->f(t, NV_DATA_S(y) - 1, NV_DATA_S(tmp1) - 1, sdata->user_data) ;
+	jac->values(t, NV_DATA_S(y) - 1, SUNSparseMatrix_Data(J), sdata->user_data) ;
+	return 0 ;
+}
+
+// Comme SUNLinSolInitialize_KLU, mais conserve la factorisation existante : le motif du jacobien n'a pas chang,
+// l'analyse symbolique est donc rutilise (seule une refactorisation numrique est faite au prochain setup)
+static int KLUInitialize_keepSymbolic(SUNLinearSolver S) {
+	SUNLinearSolverContent_KLU content = (SUNLinearSolverContent_KLU)(S->content) ;
+	if ((content->symbolic == NULL) || (content->numeric == NULL)) content->first_factorize = 1 ;
+	content->last_flag = SUNLS_SUCCESS ;
+	return SUNLS_SUCCESS ;
+}
+
+// Prconditionneur utilisateur (cvode_spils) : forme compatible avec cvode, mme dcalage des indices que ffff
+static int Psetup_(realtype t, N_Vector y, N_Vector fy, booleantype jok, booleantype *jcurPtr, realtype gamma, void *user_data) {
+	SolverData* sdata = (SolverData*)user_data ;
+	bool jcur = false ;
+	int retval = sdata->prec->setup(t, NV_DATA_S(y) - 1, jok, &jcur, gamma, sdata->user_data) ;
+	*jcurPtr = jcur ? SUNTRUE : SUNFALSE ;
+	return retval ;
+}
+
+static int Psolve_(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z, realtype gamma, realtype delta, int lr, void *user_data) {
+	SolverData* sdata = (SolverData*)user_data ;
+	if (sdata->prec_lr && (lr != sdata->prec_lr)) { // P n'est pas factoris en P1.P2 : appliqu d'un seul ct
+		N_VScale(ONE, r, z) ;
+		return 0 ;
+	}
+	return sdata->prec->solve(NV_DATA_S(r) - 1, NV_DATA_S(z) - 1, sdata->user_data) ;
+}
+
+// Ajoute les statistiques du solveur  stats (iterative : solveur linaire de Krylov, sinon direct)
+static void addStats(void* cvode_mem, SolverStats& stats, bool iterative) {
+	long int n ;
+	n = 0 ; CVodeGetNumSteps(cvode_mem, &n) ; stats["nst"] += n ;
+	n = 0 ; CVodeGetNumRhsEvals(cvode_mem, &n) ; stats["nfe"] += n ;
+	n = 0 ; CVodeGetNumLinSolvSetups(cvode_mem, &n) ; stats["nsetups"] += n ;
+	n = 0 ; CVodeGetNumErrTestFails(cvode_mem, &n) ; stats["netf"] += n ;
+	n = 0 ; CVodeGetNumNonlinSolvIters(cvode_mem, &n) ; stats["nni"] += n ;
+	n = 0 ; CVodeGetNumNonlinSolvConvFails(cvode_mem, &n) ; stats["ncfn"] += n ;
+	n = 0 ; CVodeGetNumLinRhsEvals(cvode_mem, &n) ; stats["nfeLS"] += n ;
+	if (iterative) {
+		n = 0 ; CVodeGetNumLinIters(cvode_mem, &n) ; stats["nli"] += n ;
+		n = 0 ; CVodeGetNumLinConvFails(cvode_mem, &n) ; stats["ncfl"] += n ;
+		n = 0 ; CVodeGetNumPrecEvals(cvode_mem, &n) ; stats["npe"] += n ;
+		n = 0 ; CVodeGetNumPrecSolves(cvode_mem, &n) ; stats["nps"] += n ;
+		n = 0 ; CVodeGetNumJtimesEvals(cvode_mem, &n) ; stats["njtv"] += n ;
+	}
+	else {
+		n = 0 ; CVodeGetNumJacEvals(cvode_mem, &n) ; stats["nje"] += n ;
+	}
+}
+
+SparseJacobian& SparseJacobian::operator=(const SparseJacobian& J) {
+	if (this != &J) {
+		freeSolver() ;
+		colptrs = J.colptrs ; rowvals = J.rowvals ; values = J.values ;
+	}
+	return *this ;
+}
+
+SUNLinearSolver SparseJacobian::solver(N_Vector y, SUNMatrix A) {
+	vector<sunindextype> pattern(colptrs) ;
+	pattern.insert(pattern.end(), rowvals.begin(), rowvals.end()) ;
+	if (LS && (pattern != analyzed)) freeSolver() ; // nouveau motif (topologie modifie) : nouvelle analyse symbolique
+	if (!LS) {
+		LS = SUNLinSol_KLU(y, A) ;
+		if (!LS) return NULL ;
+		LS->ops->initialize = KLUInitialize_keepSymbolic ;
+		analyzed.swap(pattern) ;
+	}
+	return LS ;
+}
+
+void SparseJacobian::freeSolver() {
+	if (LS) SUNLinSolFree(LS) ;
+	LS = NULL ;
+	analyzed.clear() ;
+}
+
+void SolverMemory::free() {
+	if (cvode_mem) CVodeFree(&cvode_mem) ;
+	if (LS && ownLS) SUNLinSolFree(LS) ;
+	if (A) SUNMatDestroy(A) ;
+	cvode_mem = NULL ; LS = NULL ; A = NULL ; ownLS = true ;
+	config.clear() ; h = 0. ;
+}
+
+// Reprise  chaud (mem) : rinitialise l'intgrateur conserv  (t0, yy), avec le dernier pas de temps de l'appel prcdent
+static int warmRestart(SolverMemory* mem, SolverData& sdata, double t0, double tf, N_Vector yy, double rtol, N_Vector abstol) {
+	sdata.cvode_mem = mem->cvode_mem ; sdata.LS = mem->LS ;
+	int flag = CVodeSetUserData(mem->cvode_mem, &sdata) ;
+	if (check_flag(&flag, "CVodeSetUserData", 1)) { _LogMessage("erreur CVodeSetUserData") ; return -1 ; }
+	flag = CVodeReInit(mem->cvode_mem, t0, yy) ;
+	if (check_flag(&flag, "CVodeReInit", 1)) { _LogMessage("erreur CVodeReInit") ; return -1 ; }
+	flag = CVodeSVtolerances(mem->cvode_mem, rtol, abstol) ;
+	if (check_flag(&flag, "CVodeSVtolerances", 1)) return -1 ;
+	flag = CVodeSetInitStep(mem->cvode_mem, std::min(mem->h, tf - t0)) ; // 0 : estim par cvode
+	if (check_flag(&flag, "CVodeSetInitStep", 1)) return -1 ;
+	return 0 ;
+}
+
+int cvode_direct(void(*f)(double,double*,double*,void*), void* user_data, Fortran_vector& y, Fortran_vector &T, void(*aux)(double,double*,void*), Fortran_vector& atol, Fortran_vector& rtol, int solver,
+	     int nbVar_dot, Fortran_vector** Var_primitive, Fortran_vector** Var_dot, bool verbose, bool STALD, void(*rootfind)(double, double*, double*, void*), int nrootfns, int mu, int ml, SparseJacobian* jac, SolverStats* stats, SolverMemory* mem) {
+	SolverData sdata = { f, rootfind, user_data, NULL, NULL, jac, NULL, 0 } ;
+	void* cvode_mem ; SUNLinearSolver LS(NULL) ; char message[200] ;
   int itol = 1 ;
 /* 	itol = 1 (= CV_SS) : atol & rtol tous 2 scalaires ;
 		itol = 2 (= CV_SV) : atol vecteur, rtol scalaire ;
@@ -206,11 +338,11 @@ int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_ve
   double t, tout, t_sav, dt ;
   N_Vector abstol(InPlace_NVector(atol)) ;
   N_Vector yy(InPlace_NVector(y));              // "habille" le Fortran_vector y en N_Vector sans occuper de mmoire suppl.
-  SUNMatrix A;
+  SUNMatrix A = NULL;
   double* y_ = InPlace_Array(y);	// y_ = y.v_
 	t = t_sav = T[1] ;
    Fortran_vector** Var_primitive_sav ;
-   if (aux != NULL) aux(T[1], y_) ; // instant t0 = T[1]
+   if (aux != NULL) aux(T[1], y_, user_data) ; // instant t0 = T[1]
   Update_Output(true) ;
   if (nbVar_dot) {
 	  assert(Var_primitive) ;
@@ -223,69 +355,95 @@ int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_ve
 	  Var_primitive_sav = new Fortran_vector*[nbVar_dot] ;
 	  for (j = 0 ; j < nbVar_dot ; j ++) 	  Var_primitive_sav[j] = new Fortran_vector(Var_primitive[j]->size()) ;
   }
-  cvode_mem = CVodeCreate(CV_BDF);    // init. le solveur avec la mthode d'intgr. BDF (et la rsol. de type Newton)
-    if (check_flag(cvode_mem, "CVodeCreate", 0)) {_LogMessage("erreur CVodeCreate") ; return -1 ; }
-  flag = CVodeInit(cvode_mem, ffff, T[1], yy); // alloue l'espace de travail du solveur
-    if (check_flag(&flag, "CVodeInit", 1)) {_LogMessage("erreur CVodeInit") ; return -1 ; }
-
-/* Call CVodeSVtolerances to specify the scalar relative tolerance
-* and vector absolute tolerances */
-	flag = CVodeSVtolerances(cvode_mem, rtol[1], abstol);
-	if (check_flag(&flag, "CVodeSVtolerances", 1)) return(1);
-
-  if (STALD) {                // algorithme de dtection/correction de stabilit aux ordres > 2 (intgration par mthode BDF)
-      flag = CVodeSetStabLimDet(cvode_mem, SUNTRUE);    // FALSE par dfaut
-        if (check_flag(&flag, "CVodeSetStabLimDet", 1)) {_LogMessage("erreur CVodeSetStabLimDet") ; return -1 ; }
-  }
   int* rootsfound = NULL ;
   if (rootfind != NULL) {
       if(nrootfns < 1) {_LogMessage("erreur RootFind : nrootfns =< 0 q.  rsoudre !") ; return -1 ; }
       rootsfound = new int[nrootfns] ;
-	  flag = CVodeRootInit(cvode_mem, nrootfns, gg);
-	  if (check_flag(&flag, "CVodeRootInit", 1)) {_LogMessage("erreur CVodeRootInit") ; return -1 ; }
   }
-  if (solver == DIAG) {
-	  flag = CVDiag(cvode_mem);
-	  if (check_flag(&flag, "CVDiag", 1)) { _LogMessage("erreur CVDiag"); return -1; }
-  } else {
-	  if (solver == DENSE) {
-		  /* Create dense SUNMatrix for use in linear solves */
-		  A = SUNDenseMatrix(neq, neq);
-		  if (!(SM_ROWS_S(A) == neq)) { _LogMessage("erreur SunDenseMatrix"); return -1; }
-		  /* Create dense SUNLinearSolver object for use by CVode */
-		  LS = SUNLinSol_Dense(yy, A);
-		  if (!LS) { _LogMessage("erreur SUNLinSol_Dense"); return -1; }
+  vector<long> config = { DIRECT_CONFIG, solver, neq, itol, STALD, nrootfns, mu, ml, jac != NULL } ;
+  if (mem && mem->cvode_mem && (mem->config != config)) mem->free() ;
+  if (mem && mem->cvode_mem) {
+	  if (warmRestart(mem, sdata, T[1], T[nbt], yy, rtol[1], abstol)) return -1 ;
+	  cvode_mem = mem->cvode_mem ; LS = mem->LS ; A = mem->A ;
+  }
+  else {
+	  cvode_mem = CVodeCreate(CV_BDF);    // init. le solveur avec la mthode d'intgr. BDF (et la rsol. de type Newton)
+	    if (check_flag(cvode_mem, "CVodeCreate", 0)) {_LogMessage("erreur CVodeCreate") ; return -1 ; }
+	  sdata.cvode_mem = cvode_mem ;
+	  flag = CVodeSetUserData(cvode_mem, &sdata) ; // transmis  ffff, gg et Jac_
+	    if (check_flag(&flag, "CVodeSetUserData", 1)) {_LogMessage("erreur CVodeSetUserData") ; return -1 ; }
+	  flag = CVodeInit(cvode_mem, ffff, T[1], yy); // alloue l'espace de travail du solveur
+	    if (check_flag(&flag, "CVodeInit", 1)) {_LogMessage("erreur CVodeInit") ; return -1 ; }
+
+	/* Call CVodeSVtolerances to specify the scalar relative tolerance
+	* and vector absolute tolerances */
+		flag = CVodeSVtolerances(cvode_mem, rtol[1], abstol);
+		if (check_flag(&flag, "CVodeSVtolerances", 1)) return(1);
+
+	  if (STALD) {                // algorithme de dtection/correction de stabilit aux ordres > 2 (intgration par mthode BDF)
+	      flag = CVodeSetStabLimDet(cvode_mem, SUNTRUE);    // FALSE par dfaut
+	        if (check_flag(&flag, "CVodeSetStabLimDet", 1)) {_LogMessage("erreur CVodeSetStabLimDet") ; return -1 ; }
+	  }
+	  if (rootfind != NULL) {
+		  flag = CVodeRootInit(cvode_mem, nrootfns, gg);
+		  if (check_flag(&flag, "CVodeRootInit", 1)) {_LogMessage("erreur CVodeRootInit") ; return -1 ; }
+	  }
+	  if (solver == DIAG) {
+		  flag = CVDiag(cvode_mem);
+		  if (check_flag(&flag, "CVDiag", 1)) { _LogMessage("erreur CVDiag"); return -1; }
 	  } else {
-		  if (solver == BAND) {
-			  A = SUNBandMatrix(neq, mu, ml);
-			  if (!(SM_ROWS_S(A) == neq)) { _LogMessage("erreur SunBandMatrix"); return -1; }
-			  /* Create banded SUNLinearSolver object for use by CVode */
-			  LS = SUNLinSol_Band(yy, A);
-			  if (!LS) { _LogMessage("erreur SUNLinSol_Band"); return -1; }
+		  if (solver == DENSE) {
+			  /* Create dense SUNMatrix for use in linear solves */
+			  A = SUNDenseMatrix(neq, neq);
+			  if (!(SM_ROWS_S(A) == neq)) { _LogMessage("erreur SunDenseMatrix"); return -1; }
+			  /* Create dense SUNLinearSolver object for use by CVode */
+			  LS = SUNLinSol_Dense(yy, A);
+			  if (!LS) { _LogMessage("erreur SUNLinSol_Dense"); return -1; }
 		  } else {
-				if (solver == KLU) {// cre les 3 espaces mmoire (KLU::Ax, Ai, Ap) dimensionns ; on pourra les redimensionner ultrieurement...
-					A = SUNSparseMatrix(neq, neq, neq, CSC_MAT);// 3me arg : nnz = neq = le + petit a priori (la diag.)
-					if (check_flag((void *)A, "SUNSparseMatrix", 0)) return(1);
-					/* Create KLU solver object for use by CVode */
-					LS = SUNLinSol_KLU(yy, A);
-					if (check_flag((void *)LS, "SUNLinSol_KLU", 0)) return(1);
-				}
-				else { (void)sprintf(message, "%d : nom de solveur inconnu", solver); _LogMessage(message); return -1; }
+			  if (solver == BAND) {
+				  A = SUNBandMatrix(neq, mu, ml);
+				  if (!(SM_ROWS_S(A) == neq)) { _LogMessage("erreur SunBandMatrix"); return -1; }
+				  /* Create banded SUNLinearSolver object for use by CVode */
+				  LS = SUNLinSol_Band(yy, A);
+				  if (!LS) { _LogMessage("erreur SUNLinSol_Band"); return -1; }
+			  } else {
+					if ((solver == KLU) && jac) { // jacobien analytique : motif fixe, le solveur KLU (et son analyse symbolique) est conserv par jac
+						if ((jac->colptrs.size() != neq + 1) || (jac->colptrs[neq] != (sunindextype)jac->rowvals.size()) || !jac->values) {
+							_LogMessage("erreur SparseJacobian : motif incompatible avec y") ; return -1 ;
+						}
+						A = SUNSparseMatrix(neq, neq, jac->rowvals.size(), CSC_MAT);
+						if (check_flag((void *)A, "SUNSparseMatrix", 0)) return(1);
+						LS = jac->solver(yy, A);
+						if (check_flag((void *)LS, "SUNLinSol_KLU", 0)) return(1);
+					}
+					else if (solver == KLU) {// cre les 3 espaces mmoire (KLU::Ax, Ai, Ap) dimensionns ; on pourra les redimensionner ultrieurement...
+						A = SUNSparseMatrix(neq, neq, neq, CSC_MAT);// 3me arg : nnz = neq = le + petit a priori (la diag.)
+						if (check_flag((void *)A, "SUNSparseMatrix", 0)) return(1);
+						/* Create KLU solver object for use by CVode */
+						LS = SUNLinSol_KLU(yy, A);
+						if (check_flag((void *)LS, "SUNLinSol_KLU", 0)) return(1);
+					}
+					else { (void)sprintf(message, "%d : nom de solveur inconnu", solver); _LogMessage(message); return -1; }
+			  }
+		  }
+		  sdata.LS = LS ;
+		  /* Call CVodeSetLinearSolver to attach the matrix and linear solver to CVode */
+		  flag = CVodeSetLinearSolver(cvode_mem, LS, A);
+		  if (check_flag(&flag, "CVodeSetLinearSolver", 1)) return(1);
+		  if (solver == KLU) {
+			  flag = CVodeSetJacFn(cvode_mem, jac ? Jac_analytic : Jac_);
+			  if (check_flag(&flag, "CVodeSetJacFn", 1)) return(1); // Non-zero = erreur
 		  }
 	  }
-	  /* Call CVodeSetLinearSolver to attach the matrix and linear solver to CVode */
-	  flag = CVodeSetLinearSolver(cvode_mem, LS, A);
-	  if (check_flag(&flag, "CVodeSetLinearSolver", 1)) return(1);
-	  if (solver == KLU) {
-		  flag = CVodeSetJacFn(cvode_mem, Jac_);
-		  if (check_flag(&flag, "CVodeSetJacFn", 1)) return(1); // Non-zero = erreur
+	  if (mem) { // conserv pour l'appel suivant
+		  mem->cvode_mem = cvode_mem ; mem->LS = LS ; mem->A = A ; mem->ownLS = !((solver == KLU) && jac) ; mem->config = config ;
 	  }
   }
   flag = CVodeSetMaxConvFails(cvode_mem, 100) ; // pour prvenir l'erreur de non-convergence (error code = -4), sauf si la convergence n'est effectivement jamais atteinte !
   for (i = 2 ; i <= nbt ; i++) {						// pour chaque instant o l'on souhaite la solution
 	tout=T[i];
 	if (verbose) {
-			strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  starting step n" << i-1 << " (tf = " << tout << ")" << endl ;
+			timeOfDay(message) ; cout <<  "at " << message << " :  starting step n" << i-1 << " (tf = " << tout << ")" << endl ;
 			Update_Output(i == 2) ;
 	}
 	while (t < tout) {
@@ -295,7 +453,7 @@ int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_ve
 			  if (flag == CV_ROOT_RETURN) {
 				 flagr = CVodeGetRootInfo(cvode_mem, rootsfound);
 				   if (check_flag(&flagr, "CVodeGetRootInfo", 1)) { _LogMessage(" Erreur CVodeGetRootInfo") ;
-						strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ; return i ;
+						timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ; return i ;
 				   }
 				 for (j = 0 ; j < nrootfns ; j++) {
 					 if (rootsfound[j] == 1) {
@@ -303,13 +461,14 @@ int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_ve
 						Update_Output() ;
 					 }
 				 }
-				 aux(t, y_) ;
+				 aux(t, y_, user_data) ;
 			  }
 			  else {
 				   if (flag != CV_SUCCESS) {
 				  //    if (check_flag(&flag, "CVode", 1)) break ; // routine   reprendre...
 					   (void)sprintf(message, "error-flag CVode = %d", flag) ; _LogMessage(message) ;
-						strftime(message, 50, "%H:-%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output(true) ;
+						timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output(true) ;
+					   if (stats) { addStats(cvode_mem, *stats, false) ; (*stats)["flag"] = flag ; }
 					   return i ;
 				  }
 			  }
@@ -327,7 +486,7 @@ int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_ve
 								//  ce stade t_curr est juste suprieur  tout : on interpole y  y_out = y(tout) :
 			flag = CVodeGetDky(cvode_mem, tout, 0, yy);
 			check_flag(&flag, "CVodeGetDky", 1);
-			aux(T[i], y_);
+			aux(T[i], y_, user_data);
 		}
 		t_sav = t;
 	} // fin boucle i (T[i])
@@ -354,8 +513,13 @@ int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_ve
            _LogMessage(message) ;
       (void)sprintf(message, "nni = %-6ld ncfn = %-6ld netf = %-6ld nge = %ld\n \n", nni, ncfn, netf, nge); _LogMessage(message) ;
   }
-  /* Free integrator memory : */
-  CVodeFree(&cvode_mem);
+  if (stats) addStats(cvode_mem, *stats, false) ;
+  if (mem) CVodeGetLastStep(cvode_mem, &mem->h) ;
+  else {  /* Free integrator memory : */
+	CVodeFree(&cvode_mem);
+	if (LS && !((solver == KLU) && jac)) SUNLinSolFree(LS) ; // sinon, conserv par jac
+	if (A) SUNMatDestroy(A) ;
+  }
   N_VDestroy_Serial(yy) ; N_VDestroy_Serial(abstol) ; // heureusement, ne dsallouent pas leurs 'double* NV_DATA_S()' car issus de 'N_VMake_Serial'
   if (rootfind != NULL) delete [] rootsfound ;
   if (nbVar_dot) {
@@ -363,15 +527,16 @@ int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_ve
 	delete[] Var_primitive_sav ;
   }
 //  _strtime_s(message, 100); cout << "at " << message << " :  exiting solver" << endl ; Update_Output() ;
-   strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ;
+   if (verbose) { timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ; }
 	return 0 ;
 }
 
 
-int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_vector &T, void(*aux)(double, double*), Fortran_vector& atol, Fortran_vector& rtol,
+int cvode_spils(void(*f)(double, double*, double*, void*), void* user_data, Fortran_vector &y, Fortran_vector &T, void(*aux)(double, double*, void*), Fortran_vector& atol, Fortran_vector& rtol,
 	int solver, int GSType, int prectype, int nbVar_dot, Fortran_vector** Var_primitive, Fortran_vector** Var_dot,
-	bool verbose, bool STALD, void(*rootfind)(double, double*, double*), int nrootfns, int mu, int ml, int maxl) {
-	ff = f;
+	bool verbose, bool STALD, void(*rootfind)(double, double*, double*, void*), int nrootfns, int mu, int ml, int maxl, Preconditioner* prec, SolverStats* stats, SolverMemory* mem) {
+	SolverData sdata = { f, rootfind, user_data, NULL, NULL, NULL, prec, ((prectype == PREC_BOTH) && (solver != SPFGMR) && (solver != PCG)) ? 1 : 0 } ;
+	void* cvode_mem ; SUNLinearSolver LS(NULL) ; char message[200] ;
 	int itol = 1;
 	// 		itol = 1 (= CV_SS) : atol & rtol tous 2 scalaires ;
 	//		itol = 2 (= CV_SV) : atol vecteur, rtol scalaire ;
@@ -389,7 +554,7 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
 	double* y_ = NV_DATA_S(yy) - 1;
 	t = t_sav = T[1];
 	Fortran_vector** Var_primitive_sav;
-	if (aux != NULL) aux(T[1], y_); // instant t0 = T[1]
+	if (aux != NULL) aux(T[1], y_, user_data); // instant t0 = T[1]
 	Update_Output(true);
 	if (nbVar_dot) {
 		assert(Var_primitive);
@@ -402,73 +567,93 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
 		Var_primitive_sav = new Fortran_vector*[nbVar_dot];
 		for (j = 0; j < nbVar_dot; j++) 	  Var_primitive_sav[j] = new Fortran_vector(Var_primitive[j]->size());
 	}
-	cvode_mem = CVodeCreate(CV_BDF);    // init. le solveur avec la mthode d'intgr. BDF et la rsol. de type Newton
-	if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) { _LogMessage("erreur CVodeCreate"); return -1; }
-
-	flag = CVodeInit(cvode_mem, ffff, T[1], yy); // alloue l'espace de travail du solveur
-	if (check_flag(&flag, "CVodeInit", 1)) { _LogMessage("erreur CVodeInit"); return -1; }
-
-	/* Call CVodeSVtolerances to specify the scalar relative tolerance
-	* and vector absolute tolerances */
-	flag = CVodeSVtolerances(cvode_mem, rtol[1], abstol);
-	if (check_flag(&flag, "CVodeSVtolerances", 1)) return(1);
-
-	if (STALD) {                // algorithme de dtection/correction de stabilit aux ordres > 2 (intgration par mthode BDF)
-		flag = CVodeSetStabLimDet(cvode_mem, SUNTRUE);    // FALSE par dfaut
-		if (check_flag(&flag, "CVodeSetStabLimDet", 1)) { _LogMessage("erreur CVodeSetStabLimDet"); return -1; }
-	}
 	int* rootsfound = NULL;
 	if (rootfind != NULL) {
 		if (nrootfns < 1) { _LogMessage("erreur RootFind : nrootfns =< 0 q.  rsoudre !"); return -1; }
 		rootsfound = new int[nrootfns];
-		flag = CVodeRootInit(cvode_mem, nrootfns, gg);
-		if (check_flag(&flag, "CVodeRootInit", 1)) { _LogMessage("erreur CVodeRootInit"); return -1; }
 	}
-	if (solver == SPGMR) {
-		LS = SUNLinSol_SPGMR(yy, prectype, maxl);
-		if (!LS) { _LogMessage("erreur SUNLinSol_spgmr"); return -1; }
-		flag = SUNLinSol_SPGMRSetGSType(LS, GSType); // Gram-Schmidt orthogonalisation method
-		if (check_flag(&flag, "SUNLinSol_SPGMRSetGSType", 1)) { _LogMessage("erreur SUNLinSol_SPGMRSetGSType"); return -1; }
+	vector<long> config = { SPILS_CONFIG, solver, neq, itol, STALD, nrootfns, mu, ml, GSType, prectype, maxl, prec != NULL };
+	if (mem && mem->cvode_mem && (mem->config != config)) mem->free();
+	if (mem && mem->cvode_mem) {
+		if (warmRestart(mem, sdata, T[1], T[nbt], yy, rtol[1], abstol)) return -1;
+		cvode_mem = mem->cvode_mem; LS = mem->LS;
 	}
 	else {
-		if (solver == SPFGMR) {
-			LS = SUNLinSol_SPFGMR(yy, prectype, maxl);
-			if (!LS) { _LogMessage("erreur SUNLinSol_spfgmr"); return -1; }
-			flag = SUNLinSol_SPFGMRSetGSType(LS, GSType); // Gram-Schmidt orthogonalisation method
-			if (check_flag(&flag, "SUNLinSol_SPFGMRSetGSType", 1)) { _LogMessage("erreur SUNLinSol_SPFGMRSetGSType"); return -1; }
+		cvode_mem = CVodeCreate(CV_BDF);    // init. le solveur avec la mthode d'intgr. BDF et la rsol. de type Newton
+		if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) { _LogMessage("erreur CVodeCreate"); return -1; }
+		sdata.cvode_mem = cvode_mem;
+		flag = CVodeSetUserData(cvode_mem, &sdata); // transmis  ffff et gg
+		if (check_flag(&flag, "CVodeSetUserData", 1)) { _LogMessage("erreur CVodeSetUserData"); return -1; }
+
+		flag = CVodeInit(cvode_mem, ffff, T[1], yy); // alloue l'espace de travail du solveur
+		if (check_flag(&flag, "CVodeInit", 1)) { _LogMessage("erreur CVodeInit"); return -1; }
+
+		/* Call CVodeSVtolerances to specify the scalar relative tolerance
+		* and vector absolute tolerances */
+		flag = CVodeSVtolerances(cvode_mem, rtol[1], abstol);
+		if (check_flag(&flag, "CVodeSVtolerances", 1)) return(1);
+
+		if (STALD) {                // algorithme de dtection/correction de stabilit aux ordres > 2 (intgration par mthode BDF)
+			flag = CVodeSetStabLimDet(cvode_mem, SUNTRUE);    // FALSE par dfaut
+			if (check_flag(&flag, "CVodeSetStabLimDet", 1)) { _LogMessage("erreur CVodeSetStabLimDet"); return -1; }
+		}
+		if (rootfind != NULL) {
+			flag = CVodeRootInit(cvode_mem, nrootfns, gg);
+			if (check_flag(&flag, "CVodeRootInit", 1)) { _LogMessage("erreur CVodeRootInit"); return -1; }
+		}
+		if (solver == SPGMR) {
+			LS = SUNLinSol_SPGMR(yy, prectype, maxl);
+			if (!LS) { _LogMessage("erreur SUNLinSol_spgmr"); return -1; }
+			flag = SUNLinSol_SPGMRSetGSType(LS, GSType); // Gram-Schmidt orthogonalisation method
+			if (check_flag(&flag, "SUNLinSol_SPGMRSetGSType", 1)) { _LogMessage("erreur SUNLinSol_SPGMRSetGSType"); return -1; }
 		}
 		else {
-			if (solver == SPBCGS) {
-				LS = SUNLinSol_SPBCGS(yy, prectype, maxl);
-				if (!LS) { _LogMessage("erreur SUNLinSol_spbcgs"); return -1; }
+			if (solver == SPFGMR) {
+				LS = SUNLinSol_SPFGMR(yy, prectype, maxl);
+				if (!LS) { _LogMessage("erreur SUNLinSol_spfgmr"); return -1; }
+				flag = SUNLinSol_SPFGMRSetGSType(LS, GSType); // Gram-Schmidt orthogonalisation method
+				if (check_flag(&flag, "SUNLinSol_SPFGMRSetGSType", 1)) { _LogMessage("erreur SUNLinSol_SPFGMRSetGSType"); return -1; }
 			}
 			else {
-				if (solver == SPTFQMR) {
-					LS = SUNLinSol_SPTFQMR(yy, prectype, maxl);
-					if (!LS) { _LogMessage("erreur SUNLinSol_sptfqmr"); return -1; }
+				if (solver == SPBCGS) {
+					LS = SUNLinSol_SPBCGS(yy, prectype, maxl);
+					if (!LS) { _LogMessage("erreur SUNLinSol_spbcgs"); return -1; }
 				}
 				else {
-					if (solver == PCG) {
-						LS = SUNLinSol_PCG(yy, prectype, maxl);
-						if (!LS) { _LogMessage("erreur SUNLinSol_PCG"); return -1; }
+					if (solver == SPTFQMR) {
+						LS = SUNLinSol_SPTFQMR(yy, prectype, maxl);
+						if (!LS) { _LogMessage("erreur SUNLinSol_sptfqmr"); return -1; }
+					}
+					else {
+						if (solver == PCG) {
+							LS = SUNLinSol_PCG(yy, prectype, maxl);
+							if (!LS) { _LogMessage("erreur SUNLinSol_PCG"); return -1; }
+						}
+						else { (void)sprintf(message, "%d : nom de solveur inconnu", solver); _LogMessage(message); return -1; }
 					}
-					else { (void)sprintf(message, "%d : nom de solveur inconnu", solver); _LogMessage(message); return -1; }
 				}
 			}
 		}
-	}
-	flag = CVodeSetLinearSolver(cvode_mem, LS, NULL);
-	if (check_flag(&flag, "CVodeSetLinearSolver", 1)) return -1;
-	if (prectype != PREC_NONE) {
-		flag = CVBandPrecInit(cvode_mem, neq, mu, ml);
-		cout << "CVBandPrecInit flag = " << flag << endl;
-		if (check_flag(&flag, "CVBandPrecInit", 1)) { _LogMessage("erreur CVBandPrecInit"); return -1; }
+		sdata.LS = LS;
+		flag = CVodeSetLinearSolver(cvode_mem, LS, NULL);
+		if (check_flag(&flag, "CVodeSetLinearSolver", 1)) return -1;
+		if ((prectype != PREC_NONE) && prec) {
+			flag = CVodeSetPreconditioner(cvode_mem, Psetup_, Psolve_);
+			if (check_flag(&flag, "CVodeSetPreconditioner", 1)) { _LogMessage("erreur CVodeSetPreconditioner"); return -1; }
+		}
+		else if (prectype != PREC_NONE) {
+			flag = CVBandPrecInit(cvode_mem, neq, mu, ml);
+			if (check_flag(&flag, "CVBandPrecInit", 1)) { _LogMessage("erreur CVBandPrecInit"); return -1; }
+		}
+		if (mem) { // conserv pour l'appel suivant
+			mem->cvode_mem = cvode_mem; mem->LS = LS; mem->A = NULL; mem->ownLS = true; mem->config = config;
+		}
 	}
   flag = CVodeSetMaxConvFails(cvode_mem, 100) ; // pour prvenir l'erreur de non-convergence (error code = -4), sauf si la convergence n'est effectivement jamais atteinte !
   for (i = 2 ; i <= nbt ; i++) {						// pour chaque instant o l'on souhaite la solution
 	tout=T[i];
 	if (verbose) {
-			strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  starting step n" << i-1 << " (tf = " << tout << ")" << endl ;
+			timeOfDay(message) ; cout <<  "at " << message << " :  starting step n" << i-1 << " (tf = " << tout << ")" << endl ;
 			Update_Output(i == 2) ;
 	}
 	while (t < tout) {
@@ -478,7 +663,7 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
 			  if (flag == CV_ROOT_RETURN) {
 				 flagr = CVodeGetRootInfo(cvode_mem, rootsfound);
 				   if (check_flag(&flagr, "CVodeGetRootInfo", 1)) { _LogMessage(" Erreur CVodeGetRootInfo") ;
-		       			strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ; return i ;
+		       			timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ; return i ;
 				   }
 				 for (j = 0 ; j < nrootfns ; j++) {
 					 if (rootsfound[j] == 1) {
@@ -487,14 +672,14 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
 					 }
 				 }
 				 
-				std::cout<<"aux for t < tout"<<std::endl;
-				aux(t, y_) ;
+				aux(t, y_, user_data) ;
 			  }
 			  else {
 				  if (flag != CV_SUCCESS) {
 				  //    if (check_flag(&flag, "CVode", 1)) break ; // routine   reprendre...
 					   (void)sprintf(message, "error-flag CVode = %d", flag) ; _LogMessage(message) ;
-					   	strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ;
+					   	timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output() ;
+					   if (stats) { addStats(cvode_mem, *stats, true) ; (*stats)["flag"] = flag ; }
 					   return i ;
 				  }
 			  }
@@ -513,7 +698,7 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
 								//  ce stade t_curr est juste suprieur  tout : on interpole y  y_out = y(tout) :
 		  flag = CVodeGetDky(cvode_mem, tout, 0, yy);
 		  check_flag(&flag, "CVodeGetDky", 1);
-		  aux(T[i], y_);
+		  aux(T[i], y_, user_data);
 	  }
 	  t_sav = t;
 	} // fin boucle i (T[i])
@@ -536,10 +721,24 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
       _LogMessage("\nFinal Statistics:");
       (void)sprintf(message, "nst (num steps) = %-6ld nfe  (num call to f)= %-6ld nsetups (call to lin solver setup func)= %-6ld\n", nst, nfe, nsetups);
            _LogMessage(message) ;
-      (void)sprintf(message, "nni (iter of nonlinear solver) = %-6ld ncfn (non linsolver conv fail)= %-6ld netf (num err test fail) = %-6ld nge (call to root function) = %ld\n \n", nni, ncfn, netf, nge); _LogMessage(message) ;
+      (void)sprintf(message, "nni (iter of nonlinear solver) = %-6ld ncfn (non linsolver conv fail)= %-6ld netf (num err test fail) = %-6ld nge (call to root function) = %ld\n", nni, ncfn, netf, nge); _LogMessage(message) ;
+      long int nli, ncfl, npe, nps;
+      flag = CVodeGetNumLinIters(cvode_mem, &nli);
+           check_flag(&flag, "CVodeGetNumLinIters", 1);
+      flag = CVodeGetNumLinConvFails(cvode_mem, &ncfl);
+           check_flag(&flag, "CVodeGetNumLinConvFails", 1);
+      flag = CVodeGetNumPrecEvals(cvode_mem, &npe);
+           check_flag(&flag, "CVodeGetNumPrecEvals", 1);
+      flag = CVodeGetNumPrecSolves(cvode_mem, &nps);
+           check_flag(&flag, "CVodeGetNumPrecSolves", 1);
+      (void)sprintf(message, "nli (iter of linear solver) = %-6ld ncfl (linsolver conv fail) = %-6ld npe (prec setups) = %-6ld nps (prec solves) = %ld\n \n", nli, ncfl, npe, nps); _LogMessage(message) ;
+  }
+  if (stats) addStats(cvode_mem, *stats, true) ;
+  if (mem) CVodeGetLastStep(cvode_mem, &mem->h) ;
+  else {  // Free integrator memory :
+	CVodeFree(&cvode_mem);
+	SUNLinSolFree(LS) ;
   }
-  // Free integrator memory :
-  CVodeFree(&cvode_mem);
   N_VDestroy_Serial(yy) ; N_VDestroy_Serial(abstol) ; // heureusement, ne dsallouent pas leurs 'double* NV_DATA_S()' car issus de 'N_VMake_Serial'
   if (rootfind != NULL) delete [] rootsfound ;
   if (nbVar_dot) {
@@ -547,7 +746,7 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
 	delete[] Var_primitive_sav ;
   }
 //  _strtime_s(message, 100); cout << "at " << message << " :  exiting solver" << endl ; Update_Output();
-	strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output();
+	if (verbose) { timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl ; Update_Output(); }
 
 	return 0 ;
 }
@@ -561,7 +760,7 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
  *            NULL pointer
  */
 	int check_flag(void *flagvalue, string funcname_, int opt) {
-  int *errflag;
+  int *errflag; char message[200];
   /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
   const char * funcname = funcname_.c_str();
   if (opt == 0 && flagvalue == NULL) {
@@ -588,9 +787,10 @@ int cvode_spils(void(*f)(double, double*, double*), Fortran_vector &y, Fortran_v
 }
 
 
-int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector &T, void(*aux)(double, double*), Fortran_vector& atol, Fortran_vector& rtol,
-	int nbVar_dot, Fortran_vector** Var_primitive, Fortran_vector** Var_dot, bool verbose,	void(*rootfind)(double, double*, double*), int nrootfns) {
-	ff = f;
+int arkode(void(*f)(double, double*, double*, void*), void* user_data, Fortran_vector& y, Fortran_vector &T, void(*aux)(double, double*, void*), Fortran_vector& atol, Fortran_vector& rtol,
+	int nbVar_dot, Fortran_vector** Var_primitive, Fortran_vector** Var_dot, bool verbose,	void(*rootfind)(double, double*, double*, void*), int nrootfns) {
+	SolverData sdata = { f, rootfind, user_data, NULL, NULL, NULL, NULL, 0 } ;
+	void* arkode_mem ; char message[200] ;
 	int itol = 1;
 	/* 	itol = 1 (= CV_SS) : atol & rtol tous 2 scalaires ;
 	itol = 2 (= CV_SV) : atol vecteur, rtol scalaire ;
@@ -608,7 +808,7 @@ int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector
 	double* y_ = InPlace_Array(y);	// y_ = y.v_
 	t = t_sav = T[1];
 	Fortran_vector** Var_primitive_sav;
-	if (aux != NULL) aux(T[1], y_); // instant t0 = T[1]
+	if (aux != NULL) aux(T[1], y_, user_data); // instant t0 = T[1]
 	Update_Output(true);
 	if (nbVar_dot) {
 		assert(Var_primitive);
@@ -623,6 +823,8 @@ int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector
 	}
 	arkode_mem = ERKStepCreate(ffff, T[1], yy);    // init. le solveur
 	if (check_flag(arkode_mem, "ERKStepCreate", 0)) { _LogMessage("erreur ERKStepCreate"); return -1; }
+	flag = ERKStepSetUserData(arkode_mem, &sdata); // transmis  ffff et gg
+	if (check_flag(&flag, "ERKStepSetUserData", 1)) { _LogMessage("erreur ERKStepSetUserData"); return -1; }
 
 	/* Call CVodeSVtolerances to specify the scalar relative tolerance
 	* and vector absolute tolerances */
@@ -638,7 +840,7 @@ int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector
 	for (i = 2; i <= nbt; i++) {						// pour chaque instant o l'on souhaite la solution
 		tout = T[i];
 		if (verbose) {
-			strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  starting step n" << i - 1 << " (tf = " << tout << ")" << endl;
+			timeOfDay(message) ; cout <<  "at " << message << " :  starting step n" << i - 1 << " (tf = " << tout << ")" << endl;
 			Update_Output(i == 2);
 		}
 		while (t < tout) {
@@ -649,7 +851,7 @@ int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector
 					flagr = ERKStepGetRootInfo(arkode_mem, rootsfound);
 					if (check_flag(&flagr, "ERKStepGetRootInfo", 1)) {
 						_LogMessage(" Erreur ERKStepGetRootInfo");
-				        strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl; Update_Output(); return i;
+				        timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl; Update_Output(); return i;
 					}
 					for (j = 0; j < nrootfns; j++) {
 						if (rootsfound[j] == 1) {
@@ -657,13 +859,13 @@ int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector
 							Update_Output();
 						}
 					}
-					aux(t, y_);
+					aux(t, y_, user_data);
 				}
 				else {
 					if (flag != ARK_SUCCESS) {
 						//    if (check_flag(&flag, "CVode", 1)) break ; // routine   reprendre...
 						(void)sprintf(message, "error-flag Arkode = %d", flag); _LogMessage(message);
-						strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl; Update_Output(true);
+						timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl; Update_Output(true);
 						return i;
 					}
 				}
@@ -681,7 +883,7 @@ int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector
 								//  ce stade t_curr est juste suprieur  tout : on interpole y  y_out = y(tout) :
 			flag = ERKStepGetDky(arkode_mem, tout, 0, yy);
 			check_flag(&flag, "ERKStepGetDky", 1);
-			aux(T[i], y_);
+			aux(T[i], y_, user_data);
 		}
 		t_sav = t;
 	} // fin boucle i (T[i])
@@ -706,7 +908,7 @@ int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector
 		delete[] Var_primitive_sav;
 	}
 //	_strtime_s(message, 100); cout << "at " << message << " :  exiting solver" << endl; Update_Output();
-	strftime(message, 50, "%H:%M:%S", localtime(&current)) ; cout <<  "at " << message << " :  exiting solver" << endl; Update_Output();
+	if (verbose) { timeOfDay(message) ; cout <<  "at " << message << " :  exiting solver" << endl; Update_Output(); }
 	return 0;
 }
 
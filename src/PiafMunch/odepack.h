@@ -29,6 +29,8 @@
 #include <stdio.h>
 #include "PiafMunch/PM_arrays.h"
 #include <memory>
+#include <map>
+#include <string>
 
 #include <sundials/sundials_types.h>    /* defs. of realtype, sunindextype      */
 #include <sundials/sundials_math.h>
@@ -71,18 +73,73 @@
 #define SPTFQMR 7
 #define KLU 8
 
-//void(*aux)(double,double*, shared_ptr<PhloemFlux>),
-												  
-int cvode_direct(void(*f)(double,double*,double*), Fortran_vector& y, Fortran_vector &T, void(*aux)(double,double*), Fortran_vector& atol, Fortran_vector& rtol,
+// Analytical jacobian df/dy for the KLU solver of cvode_direct (instead of finite differences).
+// The user sets the sparsity pattern (CSC, 0-based, all diagonal entries included) and values(t, y, Jx, user_data),
+// which fills the non zeros Jx in the order of the pattern; f(t, y) is evaluated just before each call.
+// The KLU solver is kept between calls of cvode_direct, its symbolic analysis is reused as long as the pattern does not change.
+class SparseJacobian {
+public:
+	SparseJacobian() { }
+	SparseJacobian(const SparseJacobian& J): colptrs(J.colptrs), rowvals(J.rowvals), values(J.values) { } // copies do not share the KLU solver
+	SparseJacobian& operator=(const SparseJacobian& J) ;
+	virtual ~SparseJacobian() { freeSolver() ; }
+
+	vector<sunindextype> colptrs, rowvals ; // CSC pattern of df/dy
+	void(*values)(double t, double* y, double* Jx, void* user_data) = NULL ;
+
+	SUNLinearSolver solver(N_Vector y, SUNMatrix A) ; // KLU solver for the current pattern (created, or reused with its symbolic analysis)
+	void freeSolver() ;
+
+protected:
+	SUNLinearSolver LS = NULL ;
+	vector<sunindextype> analyzed ; // pattern LS was created for (colptrs followed by rowvals)
+};
+
+// User preconditioner for cvode_spils (prectype != PREC_NONE), replaces the band preconditioner of CVBandPrecInit.
+// setup(t, y, jok, jcur, gamma, user_data) prepares P ~ I - gamma * df/dy (jok: the last jacobian may be reused, *jcur: the jacobian was updated),
+// solve(r, z, user_data) solves P z = r. Arrays are 1-based as in f ; both return 0 on success, > 0 for a recoverable failure, < 0 otherwise.
+// With PREC_BOTH, P is applied on one side only (on the left, unless the linear solver only calls the right side, i.e. SPFGMR).
+struct Preconditioner {
+	int(*setup)(double t, double* y, bool jok, bool* jcur, double gamma, void* user_data) ;
+	int(*solve)(double* r, double* z, void* user_data) ;
+};
+
+// Solver statistics (CVodeGetNum...), added up over the calls: nst, nfe, nsetups, netf, nni, ncfn, nfeLS,
+// and nje (cvode_direct), or nli, ncfl, npe, nps, njtv (cvode_spils)
+typedef std::map<std::string, long int> SolverStats ;
+
+// CVODE integrator kept between calls of cvode_direct / cvode_spils (warm restart): as long as the configuration
+// (solver, neq, prectype, ...) does not change, the integrator and its linear solver are reinitialized with CVodeReInit
+// at the new initial time and state, instead of being created again, and the first step is the last step of the previous call.
+// The user data, tolerances and state vector may change between calls ; free() before a change of the structure of the problem.
+class SolverMemory {
+public:
+	SolverMemory() { }
+	SolverMemory(const SolverMemory& m) { } // copies do not share the integrator
+	SolverMemory& operator=(const SolverMemory& m) { free() ; return *this ; }
+	virtual ~SolverMemory() { free() ; }
+
+	void* cvode_mem = NULL ;
+	SUNLinearSolver LS = NULL ; bool ownLS = true ; // LS is not freed if it is kept by a SparseJacobian
+	SUNMatrix A = NULL ;
+	vector<long> config ; // configuration the integrator was created for
+	double h = 0. ; // last step size
+	void free() ;
+};
+
+// f(t, y, y_dot, user_data), aux(t, y, user_data) and rootfind(t, y, g, user_data) receive the user_data pointer given to the solver (e.g. the PhloemFlux object),
+// the solvers keep no global state, and can run concurrently on different problems
+int cvode_direct(void(*f)(double,double*,double*,void*), void* user_data, Fortran_vector& y, Fortran_vector &T, void(*aux)(double,double*,void*), Fortran_vector& atol, Fortran_vector& rtol,
 			  int solver = DENSE, int nbVar_dot = 0, Fortran_vector** Var_primitive = NULL, Fortran_vector** Var_dot = NULL, bool verbose = true, bool STALD = true,
-			  void(*rootfind)(double, double*, double*) = NULL, int nrootfns = 0, int mu = 1, int ml = 1);
+			  void(*rootfind)(double, double*, double*, void*) = NULL, int nrootfns = 0, int mu = 1, int ml = 1, SparseJacobian* jac = NULL, SolverStats* stats = NULL, SolverMemory* mem = NULL);
 
-int cvode_spils(void(*f)(double,double*,double*), Fortran_vector &y, Fortran_vector &T, void(*aux)(double,double*), Fortran_vector& atol, Fortran_vector& rtol,
+int cvode_spils(void(*f)(double,double*,double*,void*), void* user_data, Fortran_vector &y, Fortran_vector &T, void(*aux)(double,double*,void*), Fortran_vector& atol, Fortran_vector& rtol,
 			int solver = SPGMR, int GSType = MODIFIED_GS, int prectype = PREC_NONE, int nbVar_dot = 0, Fortran_vector** Var_primitive = NULL, Fortran_vector** Var_dot = NULL,
-			bool verbose = true, bool STALD = true, void(*rootfind)(double,double*,double*) = NULL, int nrootfns = 0, int mu = 1, int ml = 1, int maxl = 5);
+			bool verbose = true, bool STALD = true, void(*rootfind)(double,double*,double*,void*) = NULL, int nrootfns = 0, int mu = 1, int ml = 1, int maxl = 5,
+			Preconditioner* prec = NULL, SolverStats* stats = NULL, SolverMemory* mem = NULL);
 
-int arkode(void(*f)(double, double*, double*), Fortran_vector& y, Fortran_vector &T, void(*aux)(double, double*), Fortran_vector& atol, Fortran_vector& rtol,
-	int nbVar_dot=0, Fortran_vector** Var_primitive=NULL, Fortran_vector** Var_dot=NULL, bool verbose=true, void(*rootfind)(double, double*, double*)=NULL, int nrootfns=0);
+int arkode(void(*f)(double, double*, double*, void*), void* user_data, Fortran_vector& y, Fortran_vector &T, void(*aux)(double, double*, void*), Fortran_vector& atol, Fortran_vector& rtol,
+	int nbVar_dot=0, Fortran_vector** Var_primitive=NULL, Fortran_vector** Var_dot=NULL, bool verbose=true, void(*rootfind)(double, double*, double*, void*)=NULL, int nrootfns=0);
 
 /*
 int cvode_spils(void(*f)(double,double*,double*), Fortran_vector &y, Fortran_vector &T, void(*aux)(double,double*), Fortran_vector& atol, Fortran_vector& rtol,
@@ -91,18 +148,19 @@ int cvode_spils(void(*f)(double,double*,double*), Fortran_vector &y, Fortran_vec
 
 Les solveurs :
 
- cvode_direct(f, y, T, aux, atol, rtol [, solver [, nbVar_dot [, Var_primitive [, Var_dot [, verbose [, STALD [, rootfind, nrootfns [, mu, ml]]]]]]]] )
- cvode_spils(f, y, T, aux, atol, rtol [, solver [, GSType [, prectype [, nbVar_dot [, Var_primitive [, Var_dot [, verbose [, STALD [, rootfind, nrootfns [, mu, ml [, maxl]]]]]]]]]]] )
- arkode(f, y, T, aux, atol, rtol [, nbVar_dot [, Var_primitive [, Var_dot [, verbose [, rootfind, nrootfns]]]]] )
+ cvode_direct(f, user_data, y, T, aux, atol, rtol [, solver [, nbVar_dot [, Var_primitive [, Var_dot [, verbose [, STALD [, rootfind, nrootfns [, mu, ml [, jac [, stats]]]]]]]]]] )
+ cvode_spils(f, user_data, y, T, aux, atol, rtol [, solver [, GSType [, prectype [, nbVar_dot [, Var_primitive [, Var_dot [, verbose [, STALD [, rootfind, nrootfns [, mu, ml [, maxl [, prec [, stats]]]]]]]]]]]]] )
+ arkode(f, user_data, y, T, aux, atol, rtol [, nbVar_dot [, Var_primitive [, Var_dot [, verbose [, rootfind, nrootfns]]]]] )
 
- impliquent 6 arguments obligatoires, plus 6  12 facultatifs :
+ impliquent 7 arguments obligatoires, plus 6  12 facultatifs :
 
  arguments obligatoires :
 
- f(double t, double* y, double* ydot) : fonction exprimant le systme  rsoudre :  ydot[] = dy[]/dt  en fonction de t et de y.
+ f(double t, double* y, double* ydot, void* user_data) : fonction exprimant le systme  rsoudre :  ydot[] = dy[]/dt  en fonction de t et de y.
+ user_data : pointeur transmis tel quel  f et aux (p.ex. l'objet PhloemFlux) ; les solveurs n'utilisent pas de variables globales.
  y  : Fortran_vector des variables d'tat dcrivant le systme ; doit tre initialis   y0 = y(t=t0)  avant l'appel du solveur.
  T  : Fortran_vector spcifiant les valeurs de t pour lesquelles on dsire la solution, y compris le temps initial t0 = T[1].
- aux(double t, double* y) : dfinit une tche auxiliaire (NULL si aucune)  excuter  chacun des instants  t  de T  demands
+ aux(double t, double* y, void* user_data) : dfinit une tche auxiliaire (NULL si aucune)  excuter  chacun des instants  t  de T  demands
 		et galement aux ventuels instants t solutions de rootfind (cf. ci-aprs).
  atol, rtol : (Fortran_Vector) prcision  absolue, relative -> erreur sur y[i] ~ ewt[i]= (rtol[i]* |y[i]|) + atol[i];
 		si xtol (= atol ou rtol) est de size 1, alors pour chaque composante (i= 1  neq), xtol[i] = xtol[1].
@@ -122,10 +180,18 @@ arguments facultatifs annexes :
  verbose: boolen (true par dfaut) : si true =>  affiche le droulement (pas par pas) ;
  STALD : (spc. cvode_xxxx) : boolen (true par dfaut)  : si true => active l'algorithme de dtection/corr. d'instab. li aux ordres >2.
  rootfind : (spc. cvode_xxxx) : fonction (NULL si aucune) dfinissant un systme de nrootfns q.  rsoudre en cours
-           d'intgration : g[i](t, y) = 0   [i = 1..nroots]. Dcl. suivant le prototype: rootfind(double t, double* y, double* g).
+           d'intgration : g[i](t, y) = 0   [i = 1..nroots]. Dcl. suivant le prototype: rootfind(double t, double* y, double* g, void* user_data).
  nrootfns : (spc. cvode_xxxx) : int : nombre d'quations  g[i](t, y) = 0  (ci-dessus) ventuellement  rsoudre ; ignor si rootfind = NULL.
  mu, ml : (spc. cvode_xxxx) : int : pris en compte seulement si solver = BAND ou si prectype <> PREC_NONE : nb de super-diag. resp. suprieures et infrieures.
  maxl : (spc. cvode_spils) : int (= 5 par dfaut) : la taille max. du sous-espace de Krylov.
+ jac : (spc. cvode_direct) : SparseJacobian* (NULL par dfaut) : jacobien analytique, pris en compte seulement si solver = KLU ;
+		sinon, le jacobien creux est estim par diffrences finies (Jac_).
+ prec : (spc. cvode_spils) : Preconditioner* (NULL par dfaut) : prconditionneur utilisateur, pris en compte si prectype <> PREC_NONE ;
+		sinon, le prconditionneur bande CVBandPrecInit(mu, ml) est utilis.
+ stats : (spc. cvode_xxxx) : SolverStats* (NULL par dfaut) : les statistiques du solveur y sont ajoutes ;
+		si CVode choue, (*stats)["flag"] = code d'erreur de CVode (< 0).
+ mem : (spc. cvode_xxxx) : SolverMemory* (NULL par dfaut) : si non NULL, le solveur y est conserv en fin d'intgration,
+		et rutilis (CVodeReInit, avec le dernier pas de temps) par l'appel suivant de mme configuration.
 */
 
 #endif
@@ -33,6 +33,7 @@
 // sepcialized
 #include "MappedOrganism.h"
 #include "Photosynthesis.h"
+#include "TreeSolver.h"
 
 
 #include <math.h>
@@ -43,6 +44,7 @@
 #include "odepack.h"
 //#include "PiafMunch2.h"
 #include <fstream>
+#include <sstream>
 
 #include <stdio.h>
 #include "PM_arrays.h"
@@ -78,12 +80,176 @@
 #include <arkode/arkode_erkstep.h>
 #include <arkode/arkode_butcher.h>
 
-//take those functions out
-extern int Jac_(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
-void TimeSegmentConfig() ; // User-editable (implemented in 'PiafMunch2.cpp')
-void OutputSettings() ;
-void BreakpointSharpParameterChanges(int s, double t) ; // User-editable (implemented in 'PiafMunch2.cpp') ; s = # of integration segment (first = 1) ; t = time
-void aux(double t, double * y) ;	
+
+/**
+ * Diagnostics of the phloem integration, kept in memory (see PhloemFlux::flushDiagnostics())
+ *
+ * f() and C_fluxes() only update the counters and the context of the last error,
+ * progress and troubleshooting messages are buffered in log. Nothing is written to disk before the flush.
+ * Every PhloemFlux object owns its diagnostics, no locks are needed.
+ */
+struct PhloemDiagnostics
+{
+	long nf = 0 ; // number of calls to f()
+	long nClamped = 0 ; // number of negative Q_ST or Q_Mesophyll values set to 0 in f()
+	long nErrors = 0 ; // number of nodes with a negative sucrose usage rate found by C_fluxes()
+	struct Error { // context of the last error found by C_fluxes()
+		double t = 0. ; int node = -1 ;
+		double C_ST = 0., Q_ST = 0., Q_ST_dot = 0., Fu_lim = 0., Rm = 0., Rmmax = 0., Gr = 0., Grmax = 0., Exud = 0., Delta_JS_ST = 0., vol_ST = 0. ;
+	} lastError ;
+	std::ostringstream log ; // progress (if verbose) and troubleshooting (if doTroubleshooting) messages
+
+	PhloemDiagnostics() { }
+	PhloemDiagnostics(const PhloemDiagnostics& d) { *this = d; }
+	PhloemDiagnostics& operator=(const PhloemDiagnostics& d) {
+		nf = d.nf; nClamped = d.nClamped; nErrors = d.nErrors; lastError = d.lastError;
+		log.str(d.log.str()); log.seekp(0, std::ios_base::end);
+		return *this;
+	}
+	void clear() { nf = nClamped = nErrors = 0; lastError = Error(); log.str(""); log.clear(); }
+};
+
+
+/**
+ * Tissue parameter given per organ type and subtype (see PhloemFlux::setKx_st(), ...), compiled into a dense table
+ *
+ * values = {{v}}: constant, {{v_root}, {v_stem}, {v_leaf}}: per organ type, otherwise per organ type and subtype.
+ * Organ types go from 2 (root) to 4 (leaf), a look up is an index computation.
+ */
+class OrganTypeTable
+{
+public:
+	OrganTypeTable(std::string name = "") : name(name) { }
+	void set(const std::vector<std::vector<double>>& values) ; // (implemented in 'runPM.cpp')
+	double operator()(int subType, int organType) const {
+		int i = (nOrganTypes > 1) ? organType - 2 : 0 ;
+		int j = (nSubTypes > 1) ? subType : 0 ;
+		if((i < 0)||(i >= nOrganTypes)||(j < 0)||(j >= nSubTypes)||std::isnan(table[i*nSubTypes + j])) {
+			throw std::out_of_range(name + ": no value for organ type " + std::to_string(organType) + ", subtype " + std::to_string(subType)) ;
+		}
+		return table[i*nSubTypes + j] ;
+	}
+	std::string name ;
+protected:
+	int nOrganTypes = 0, nSubTypes = 0 ;
+	std::vector<double> table ; // nOrganTypes x nSubTypes, NaN where no value was given
+};
+
+
+/**
+ * Maximal sucrose need for growth of the organs per node (see PhloemFlux::waterLimitedGrowth()), flat per organ:
+ * the entries of organ i (in the order of plant->getOrgans(-1, true)) are start[i] .. start[i+1]-1
+ */
+struct OrganGrowthNeed
+{
+	std::vector<int> orgId ; // per organ, Organ::getId()
+	std::vector<int> start ; // per organ, and one past the last entry
+	std::vector<int> node ; // per entry, global node index
+	std::vector<double> deltaSuc ; // per entry (mmol Suc)
+	std::vector<double> total ; // per node, sum over the organs (mmol Suc)
+
+	std::vector<std::map<int,double>> toMaps() const { // per node {organ id: need, -1: total}, for python
+		std::vector<std::map<int,double>> maps(total.size()) ;
+		for(int n = 0; n < (int)total.size(); n++) { maps[n][-1] = total[n]; }
+		for(int i = 0; i < (int)orgId.size(); i++) {
+			for(int e = start[i]; e < start[i+1]; e++) { maps.at(node[e])[orgId[i]] = deltaSuc[e]; }
+		}
+		return maps ;
+	}
+};
+
+
+/**
+ * Parameters of the organs read once per PhloemFlux::waterLimitedGrowth() (serial, before the parallel loop),
+ * flat per organ in the order of plant->getOrgans(-1, true), also used by PhloemFlux::computeOrgGrowth()
+ */
+struct OrganGrowthParameters
+{
+	std::vector<int> organType ; // per organ
+	std::vector<int> subType ; // per organ, Organ::getParameter("subType")
+	std::vector<int> st ; // per organ, sub type of the tissue tables (plant->st2newst)
+	std::vector<int> gf ; // per organ, index of the growth function (only for growing organs)
+	std::vector<double> rlt, k ; // per organ, life time [day] and maximal length [cm] (only for growing organs)
+	std::vector<double> delayNGStart, delayNGEnd ; // per organ, growth pause [day] (only for growing stems)
+
+	void assign(int n) {
+		organType.assign(n, -1); subType.assign(n, -1); st.assign(n, -1); gf.assign(n, -1);
+		rlt.assign(n, 0.); k.assign(n, 0.); delayNGStart.assign(n, 0.); delayNGEnd.assign(n, 0.);
+	}
+};
+
+
+/**
+ * Error of one organ found in the parallel loops of PhloemFlux::waterLimitedGrowth() and PhloemFlux::computeOrgGrowth(),
+ * written to diagnostics.log after the loop, in organ order (see PhloemFlux::writeOrganErrors())
+ */
+struct OrganError
+{
+	std::string log ; // messages, empty if the organ had no error
+	std::string what ; // message of the exception, empty if only assertions failed
+};
+
+
+/**
+ * Working state of the PiafMunch model (used to be file scope globals of the PiafMunch sources).
+ *
+ * Every PhloemFlux object owns its state, the object is passed to the solver callbacks as CVODE user_data,
+ * therefore several PhloemFlux objects can be integrated at the same time (e.g. on a ThreadPool).
+ * All vectors are Fortran_vectors, i.e. 1-based
+ */
+struct PiafMunchState
+{
+	//		network architecture
+	int Nt = 0; // total number of nodes
+	int Nc = 0; // total number of connections (segments), Nc = Nt - 1
+	vector<int> I_Upflow, I_Downflow ; // I_Upflow (resp. I_Downflow)[jf = 1..Nc] = id# of upflow (resp. downflow) node of connection jf
+	Fortran_vector i_amont ; // i_amont[jf] = id# of the true upflow node of connection jf
+	vector<int> I_Upflow_old, I_Downflow_old ; // connections of the last startPM(): the network related structures are kept while they do not change
+	int Nc_param = 0 ; // number of segments (the first ones) whose parameters below are up to date, see initializePM_()
+	vector<double> Across_seg, kx_seg, kr_seg, krm1_seg, krm2_seg, rhoSucrose_seg ; // per segment values of the parameter tables (kr_seg: without exchange zone)
+
+	//		solver
+	Fortran_vector Y0 ; // state vector: Q_ST, Q_Mesophyll, Q_RespMaint, Q_Exudation, Q_Growthtot, Q_RespMaintmax, Q_Growthtotmax, Q_Exudationmax, Q_out
+	Fortran_vector atol_, rtol ; // integration accuracy
+	vector<double> y_dot ; // derivatives of Y0 (1-based), updated in aux()
+	int nbv = 0 ; // number of output steps
+	SparseJacobian Jac ; // pattern of df/dy and KLU solver, used by solver 32 (see initialize_jacobian() and jacobian())
+	vector<sunindextype> Jac_diag, Jac_conn ; // positions in Jac of the Q_ST diagonal entries, and of the entries (up, down), (down, up) of each connection
+	SolverMemory CV_mem ; // CVODE integrator kept between the calls of startPM() if warmRestart (declared after Jac, which may own its linear solver)
+	CPlantBox::TreeSolver Prec_ST ; // sieve tube block of the preconditioner, eliminated along the tree (see precSetup())
+	vector<double> Prec_Jx ; // df/dy at the last preconditioner setup (pattern of Jac)
+	vector<double> Prec_node ; // per node: P[ST,Meso], P[Meso,ST], P[Meso,Meso], P[Rm,ST], P[Exud,ST], P[Gtot,ST], P[Rmmax,ST]
+	vector<double> Prec_b, Prec_fy ; // work vectors of precSolve() and precSetup()
+
+	//		components of y and y_dot in f() (pointers into the solver vectors)
+	double *Q_ST = NULL, *Q_Mesophyll = NULL, *Q_RespMaint = NULL, *Q_Exudation = NULL, *Q_Growthtot = NULL ; // (mmol)
+	double *Q_RespMaintmax = NULL, *Q_Growthtotmax = NULL, *Q_Exudationmax = NULL, *Q_out = NULL ; // (mmol)
+	double *Q_ST_dot = NULL, *Q_Mesophyll_dot = NULL, *Q_Rm_dot = NULL, *Q_Exud_dot = NULL, *Q_Gtot_dot = NULL ; // (mmol d-1)
+	double *Q_Rmmax_dot = NULL, *Q_Gtotmax_dot = NULL, *Q_Exudmax_dot = NULL, *Q_out_dot = NULL ; // (mmol d-1)
+
+	//		carbon fluxes
+	Fortran_vector JS_ST ; // axial phloem sucrose flux (mmol d-1)
+	Fortran_vector C_amont ; // sieve tube sucrose concentration at the true upflow node (mmol / ml)
+	Fortran_vector C_ST ; // sieve tube sucrose concentration (mmol / ml)
+	Fortran_vector Input ; // phloem loading (mmol d-1)
+	Fortran_vector RespMaint ; // maintenance respiration rate (mmol d-1)
+	Fortran_vector Delta_JS_ST ; // net axial sucrose flux per node (mmol d-1)
+	Fortran_vector Q_Exud, Q_Gr, Q_Rm, Q_Fl ; // realized sucrose sinks and phloem loading (mmol d-1)
+	Fortran_vector Ag, Q_Grmax, Q_Rmmax, Q_Exudmax, exud_k, krm2, len_leaf ; // per node parameters, see initializePM_()
+	Fortran_vector vol_ST, vol_ParApo, vol_Seg ; // volumes of sieve tube, mesophyll, and segment (ml)
+
+	//		water fluxes
+	Fortran_vector Psi_Xyl ; // xylem water potential (hPa)
+	Fortran_vector P_ST, P_ST_dot ; // sieve tube pressure (hPa), and its variation rate
+	Fortran_vector P_Sympl, P_Sympl_dot ; // parenchyma symplasmic pressure (hPa), and its variation rate
+	Fortran_vector JW_ST ; // axial sieve tube water flux (ml d-1)
+	Fortran_vector r_ST, r_ST_ref ; // axial sieve tube resistance (hPa d ml-1), and reference value (without viscosity)
+
+	//		sucrose viscosity
+	bool Adv_BioPhysics = false ;
+	double TdC = 0., dEauPure = 0., siPhi = 0., newPhi = 0., PartMolalVol = 0. ;
+	double T_old = -9999. ; // temperature of the last viscosity update (K)
+};
 
 
 /**
@@ -94,7 +260,7 @@ void aux(double t, double * y) ;
  * CplantBox object making link with PiafMunh
  * Wraps a Photosynthesis class
  */
-class PhloemFlux: public CPlantBox::Photosynthesis
+class PhloemFlux: public CPlantBox::Photosynthesis, protected PiafMunchState
 {
 	public:
 	PhloemFlux(std::shared_ptr<CPlantBox::MappedPlant> plant_, double psiXylInit = -500., double ciInit = 350e-6): 
@@ -106,40 +272,19 @@ class PhloemFlux: public CPlantBox::Photosynthesis
 	void computeOrgGrowth(double t);///< returns max sucrose need for growth per segment
 	
 	//		from plant shape
-	std::vector<std::map<int,double>> waterLimitedGrowth(double t);
-	void setKr_st(std::vector<std::vector<double>> values, double kr_length_); ///< sets a callback for kr_suc:=kr_suc(ot,type), 
-	void setKx_st(std::vector<std::vector<double>> values); ///< sets a callback for kx_suc:=kx_suc(ot,type), 
-	void setRmax_st(std::vector<std::vector<double>> values); ///< sets a callback for kx_suc:=kx_suc(ot,type), 
-	void setAcross_st(std::vector<std::vector<double>> values); ///< sets a callback for kx_suc:=kx_suc(ot,type), 
-	void setPerimeter_st(std::vector<std::vector<double>> values); ///< sets a callback for kx_suc:=kx_suc(ot,type),  
-	void setRhoSucrose(std::vector<std::vector<double>> values); ///< sets a callback for kx_suc:=kx_suc(ot,type),  
-	void setKrm1(std::vector<std::vector<double>> values); ///< sets a callback for kx_suc:=kx_suc(ot,type), 
-	void setKrm2(std::vector<std::vector<double>> values); ///< sets a callback for kx_suc:=kx_suc(ot,type), 
+	void waterLimitedGrowth(double t);///< max sucrose need for growth per organ and node, see deltaSucOrgNode_
+	void setKr_st(const std::vector<std::vector<double>>& values, double kr_length_); ///< fills kr_st per organ type and subtype [1 day-1], kr_st > 0 only within kr_length_ of the root tips
+	void setKx_st(const std::vector<std::vector<double>>& values); ///< fills kx_st, the sieve tube axial conductance per organ type and subtype [cm3 hPa-1 day-1]
+	void setRmax_st(const std::vector<std::vector<double>>& values); ///< fills Rmax_st, the maximum initial growth rate per organ type and subtype [cm day-1]
+	void setAcross_st(const std::vector<std::vector<double>>& values); ///< fills Across_st, the cross-sectional area of the sieve tubes per organ type and subtype [cm2]
+	void setPerimeter_st(const std::vector<std::vector<double>>& values); ///< fills Perimeter_st, the perimeter of the sieve tubes per organ type and subtype [cm]
+	void setRhoSucrose(const std::vector<std::vector<double>>& values); ///< fills rhoSucrose, the sucrose density of the structural tissue per organ type and subtype [mmol cm-3]
+	void setKrm1(const std::vector<std::vector<double>>& values); ///< fills krm1v, the maintenance respiration coefficient of the structural sucrose per organ type and subtype [-]
+	void setKrm2(const std::vector<std::vector<double>>& values); ///< fills krm2v, the maintenance respiration coefficient of the sieve tube sucrose per organ type and subtype [-]
 	
-    std::function<double(int, int, int)> kr_st_f = []( int type, int orgtype, int si) {
-		throw std::runtime_error("kr_st_f not implemented"); 
-		return 0.; };
-    std::function<double(int,int)> kx_st_f = [](int type, int orgtype) {
-		throw std::runtime_error("kx_st_f not implemented"); 
-		return 0.; };
-    std::function<double(int, int)> Across_st_f = [](int type, int orgtype) {//cross-sectional area of all the sieve tubes in segment
-		throw std::runtime_error("get_Across_st not implemented"); 
-		return 0.; };
-    std::function<double(int, int)> Perimeter_st_f = [](int type, int orgtype) {//cross-sectional area of all the sieve tubes in segment
-		throw std::runtime_error("get_Across_st not implemented"); 
-		return 0.; };
-    std::function<double(int,int)> Rmax_st_f = []( int type, int orgtype){//maximum initial growth rate use by phloem module
-		throw std::runtime_error("get_Rmax not implemented"); 
-		return 0.; };
     std::function<double(int,int)> rhoSucrose_f = []( int type, int orgtype){//maximum initial growth rate use by phloem module
 		throw std::runtime_error("get_rhoSucrose not implemented"); 
 		return 0.; };
-    std::function<double(int,int)> krm1_f = []( int type, int orgtype){//maximum initial growth rate use by phloem module
-		throw std::runtime_error("get_rhoSucrose not implemented"); 
-		return 0.; };
-    std::function<double(int,int)> krm2_f = []( int type, int orgtype){//maximum initial growth rate use by phloem module
-		throw std::runtime_error("get_rhoSucrose not implemented"); 
-		return 0.; };
 
 
 	//		for python post-processing and checks
@@ -172,7 +317,7 @@ class PhloemFlux: public CPlantBox::Photosynthesis
 	std::vector<double> vol_Mesov;//volume of mesophyll (same as leaf blade volume), (cm3)
 	std::vector<double> JW_STv;//sieve tube water flow, (cm3 d-1)
 	std::vector<double> Fpsi;//water scarcity factor for growth, (-)
-	std::vector<std::map<int,double>> deltaSucOrgNode_;//maximal sucrose need for growth per node, (mmol Suc d-1)
+	OrganGrowthNeed deltaSucOrgNode_;//maximal sucrose need for growth per organ and node, (mmol Suc)
 	
 	
 	//		To calibrate
@@ -202,17 +347,32 @@ class PhloemFlux: public CPlantBox::Photosynthesis
 	bool sameVolume_meso_st = true; //use same volume for mesophyll and leaf st compartment?
 	bool withInitVal = false;//use initValST and initValMeso
 	int solver = 1;//which solver to use
-	bool doTroubleshooting =false; //do extra printing
-	bool useCWGr; //use water- and carbon- limited growth?
+	int growthThreads = 0;//number of threads used by waterLimitedGrowth() and computeOrgGrowth() (0 = serial)
+	bool warmRestart = false;//keep the CVODE integrator between calls of startPM while no segment is added, restart with its last step size
+	bool treePreconditioner = true;//Krylov solvers with PREC_xxx use the tree preconditioner (see precSetup()), otherwise, or if the connections do not form a tree, the band preconditioner of CVODE
+	SolverStats solverStats; //statistics of the solver over the last startPM() (nst, nfe, nni, nli, npe, nps, ..., flag: CVode error flag if it failed)
+	PhloemDiagnostics diagnostics; //counters, last error and messages of the last startPM(), see flushDiagnostics()
+	std::string diagnosticsFile = "outpm.txt"; //default file of flushDiagnostics(), set by startPM()
+	void flushDiagnostics(std::string filename = ""); ///< appends the diagnostics to filename (or diagnosticsFile) and empties the message buffer
+	bool doTroubleshooting =false; //do extra printing (into diagnostics.log)
+	bool useCWGr = true; //use water- and carbon- limited growth?
 	int expression = 1;//if implement several possible expression in C_fluxes
 	
 	//internal PiafMunch functions but cannot protect
 	void initialize_carbon(vector<double> vecIn) ;							// initializes carbon system parameters & constants (implemented in 'initialize.cpp')
 	void initialize_hydric() ;							// initializes hydric system parameters & constants (implemented in 'initialize.cpp')
 	void initializePM_(double dt,  double TairK); //copmutes PiafMunch input data from CPlantBox data
+	void initialize_jacobian() ;						// sparsity pattern of df/dy, and tree of the preconditioner (implemented in 'initialize.cpp')
 	void f(double t, double *y, double *y_dot) ;	//function launched by CVODE-SUNDIALS
+	void jacobian(double t, double *y, double *Jx) ;	// analytical df/dy in the pattern of initialize_jacobian(), launched by CVODE-SUNDIALS after f(t, y)
+	double jacobianError(double t, double eps = 1.e-6) ;	// largest relative difference between jacobian() and central finite differences of f at the state of the last startPM() (for testing)
+	int precSetup(double t, double *y, bool jok, bool& jcur, double gamma) ;	// tree preconditioner P = I - gamma * df/dy of the Krylov solvers (implemented in 'solve.cpp')
+	int precSolve(double *r, double *z) ;	// solves P z = r
+	sunindextype jacIndex(int row, int col) const ;	// position of the entry (row, col) in the pattern of initialize_jacobian()
 	void aux(double t, double * y);
 	void update_viscosity() ;
+	void update_water_properties() ; // density and viscosity coefficients of pure water at TairK_phloem (implemented in 'solve.cpp')
+	double viscosity(double C) const ; // viscosity of the sieve tube sap (hPa d) at the sucrose concentration C (mmol / ml)
 	void C_fluxes(double t, int Nt) ; // in  PiafMunch2.cpp
 	
 	protected:
@@ -225,56 +385,30 @@ class PhloemFlux: public CPlantBox::Photosynthesis
 	int errorID = -1;
 	int neq_coef = 9;//number of variables solved by PiafMunch. n# eq = num nodes * neq_coef
 	std::vector<double> BackUpMaxGrowth;//to check at runtime if growth is correct
+	OrganGrowthParameters orgParam_;//organ parameters of the last waterLimitedGrowth()
+	void forEachOrgan(int n, const std::function<void(int)>& f);//calls f(i) for i = 0..n-1 on growthThreads threads
+	void writeOrganErrors(const std::vector<OrganError>& errors);//writes the errors of forEachOrgan() in organ order, and throws
+	std::shared_ptr<CPlantBox::ThreadPool> growthPool; // used by forEachOrgan if growthThreads > 0, created on first use
+	int growthPoolThreads = 0; // growthThreads of growthPool, it is rebuilt if growthThreads changes
 	
-	//retrieve tissue-specific parameters
-	double kr_st_const(  int type, int organType, int si) { return kr_st.at(0).at(0); }  //constant
-    double kr_st_perOrgType( int type, int organType, int si) { return kr_st.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double kr_st_perType( int type, int organType, int si) {return kr_st.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-	double kr_st_RootExchangeZonePerType(int type, int organType, int si)
-	{ 
-		if (organType == CPlantBox::Organism::ot_root){
+	//tissue-specific parameters, see the set... functions
+	OrganTypeTable kr_st{"kr_st"};//  [mmol hPa-1 day-1]
+	OrganTypeTable kx_st{"kx_st"}; //  [cm3 hPa-1 day-1]
+	OrganTypeTable Across_st{"Across_st"}; // [cm2]
+	OrganTypeTable Perimeter_st{"Perimeter_st"}; // [cm]
+	OrganTypeTable Rmax_st{"Rmax_st"}; // [cm day-1]
+	OrganTypeTable rhoSucrose{"rhoSucrose"}; // [mmol cm-3]
+	OrganTypeTable krm1v{"krm1"};
+	OrganTypeTable krm2v{"krm2"};
+	bool kr_st_exchangeZone = false; // kr_st > 0 only in the root exchange zone, i.e. multiplied by plant->exchangeZoneCoefs (see setKr_st())
+	double kr_st_segment(int type, int organType, int si) const { //subtype, type and depend on distance to tip for roots
+		double kr = kr_st(type, organType);
+		if (kr_st_exchangeZone&&(organType == CPlantBox::Organism::ot_root)){
 			double coef = plant->exchangeZoneCoefs.at(si);//% of segment length in the root exchange zone, see MappedPlant::simulate
-			return coef * kr_st.at(organType - 2).at(type); 
+			return coef * kr;
 		}
-		return kr_st.at(organType - 2).at(type);  
-	} //subtype, type and depend on distance to tip for roots
-	
-	double kx_st_const( int type, int organType) { return kx_st.at(0).at(0); }  //constant
-    double kx_st_perOrgType( int type, int organType) { return kx_st.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double kx_st_perType( int type, int organType) {return kx_st.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-	
-	double Across_st_const( int type, int organType) { return Across_st.at(0).at(0); }  //constant
-    double Across_st_perOrgType( int type, int organType) { return Across_st.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double Across_st_perType( int type, int organType) {return Across_st.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-    
-	double Perimeter_st_const( int type, int organType) { return Perimeter_st.at(0).at(0); }  //constant
-    double Perimeter_st_perOrgType( int type, int organType) { return Perimeter_st.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double Perimeter_st_perType( int type, int organType) {return Perimeter_st.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-	
-	double Rmax_st_const( int type, int organType) { return Rmax_st.at(0).at(0); }  //constant
-    double Rmax_st_perOrgType( int type, int organType) { return Rmax_st.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double Rmax_st_perType( int type, int organType) {return Rmax_st.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-	
-	double rhoSucrose_const( int type, int organType) { return rhoSucrose.at(0).at(0); }  //constant
-    double rhoSucrose_perOrgType( int type, int organType) { return rhoSucrose.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double rhoSucrose_perType( int type, int organType) {return rhoSucrose.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-	
-	double krm1_const( int type, int organType) { return krm1v.at(0).at(0); }  //constant
-    double krm1_perOrgType( int type, int organType) { return krm1v.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double krm1_perType( int type, int organType) {return krm1v.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-	
-	double krm2_const( int type, int organType) { return krm2v.at(0).at(0); }  //constant
-    double krm2_perOrgType( int type, int organType) { return krm2v.at(organType - 2).at(0); } //per organ type (goes from 2 (root) to 4 (leaf))
-    double krm2_perType( int type, int organType) {return krm2v.at(organType - 2).at(type); }//per subtype and organ type (goes from 2 (root) to 4 (leaf))
-	
-    std::vector<std::vector<double>> kr_st;//  [mmol hPa-1 day-1]
-	 std::vector<std::vector<double>> kx_st; //  [cm3 hPa-1 day-1]
-    std::vector<std::vector<double>> Across_st; // [cm2]
-    std::vector<std::vector<double>> Perimeter_st; // [cm]
-	 std::vector<std::vector<double>> Rmax_st; // [cm day-1]
-	std::vector<std::vector<double>> rhoSucrose;
-	 std::vector<std::vector<double>> krm1v; 
-	std::vector<std::vector<double>> krm2v;
+		return kr;
+	}
 	
 };
 
@@ -28,170 +28,49 @@
 #include "PM_arrays.h"
 #include "runPM.h"
 
-/**********************************************  Network Architecture: *********************************************/
-
-//extern Fortran_vector Q_FuFl_seg;
-//extern Fortran_vector Q_FuFl_node;
-Fortran_vector Q_ST_seg_init;
-
-extern Fortran_vector  Q_Exud_seg, Q_Gr_seg, Q_Rm_seg, Q_Fl_seg;
-extern Fortran_vector C_ST_seg, Q_ST_seg, Q_ST_seg_new, Q_ST_newFuFl, grad_Q_ST_seg;
-extern Fortran_vector vol_ST_seg, Length;
-vector<int> Deg ;
-int Nt, Nc ; // Nt = Total number of nodes, Nc = total number of connections in network.
-int N1R ; // Number of  'root tip's, i.e. nodes of conn.order 1 that have imposed soil water potential as a limit condition.
-extern int N1L ; // Organ type # 1L : 'leaf end' ; has imposed transpiration stream as a limit condition
-extern Index_vector i_[] ; // i_[o = 0..8][k = 1..No] = id# of kth node in (1-based list)  list of all nodes of conn.ord. co(o). For o=0: No=N1L ; o=1: No=N1R ; o=2..8: No=N[o] :
-extern Index_vector &RootEnds, &LeafEnds ; // (= i_[1] and i_[0], resp.) : label which nodes are network ends = nodes of co=1 , which are either 'leaf' or 'root' ends :
-vector<int> jf_RootEnds ; // indices to label end nodes = those of conn.order 1
-extern vector<int> I_Upflow, I_Downflow ; // I_Upflow(resp.I_Downflow)[jf=1..Nc] = id# du noeud amont (resp. aval) : jf = JF(i,i2) > 0 si I_Upflow[(abs(jf)]==i, i.e. si I_Downflow[(abs(jf)]==i2
-SpUnit_matrix Delta2 ; // describe hydraulic architecture (topology)
-SpUnit_matrix Delta2abs ; // describe hydraulic architecture (topology)
-Sparse_matrix Deltaabs ; // describe hydraulic architecture (topology)
-Sparse_matrix Delta2W;
-Sparse_matrix X ;	// intermdiaires de calcul ;
-int** ipiv_ptr ; void**TM_ptr ; // id. -- initialis dans inialize_hydric()
-#ifdef Full_Matrix // solve full linear system for all hydraulic variables, chained as YY below :
-Fortran_vector YY, SM ; // resp., inconnue et second membre de l'q. matricielle
-#else // reduce linear system to only one unknown hydraulic variable (P_ST) => significant speed up and reduce required memory -- needs pre-solving recalculation if local model is changed
-SpUnit_matrix Delta ; // =  - Transpose(Delta2) : describe hydraulic architecture (topology)
-Sparse_matrix M1, Delta_rxyl, Delta_rphl ;	// intermdiaires de calcul ;
-Fortran_vector Km, rG, O ; //  intermdiaires de calcul (Km : rien  voir avec Michaelis !)
-Fortran_vector inv_Km, rs_rG, inv_rPhlM, inv_rG ; //  intermdiaires de calcul, drivs ou inverses des prcdents
-# endif
-double C, _0089_099803 = 0.089/0.99803 ; // intermdiaire de celcul de la molalit
-extern int jf, i ; int is ; // is = # of current integration time segment (first = 1)
-
-/******************************************  Environmental Variables: *********************************************/
-extern double T ; // (K) absolute temperature : set in GUI, but may be updated anytime in function 'parameter_and_boundary_conditions()' at the end of file 'PiafMunch2.cpp'.
-// The following 2 environment data are set by the user in function  'parameter_and_boundary_conditions()'  at the end of file 'PiafMunch2.cpp' :
-extern Fortran_vector Transpirat		; // Leaf transpiration rate (used in water-fluxes calc.)				(mmol / h)
-extern Fortran_vector PsiSoil			; // Soil water potential at root end (used in water-fluxes calc.)		(MPa)
-
-/******************************************  Constants & Parameters: *********************************************/
-#define R 83.14//0.0083143	// constante des gaz parfaits -											(MPa ml K-1 mmol-1)
-double TdC, dEauPure,  siPhi, newPhi ; // pour visc. calc. par  www.seas.upenn.edu et/ou NonLinPsi
-bool Adv_BioPhysics ; // true if  non-zero sugar specific volume, osmotic pot.=non-linear function of molality (Thompson and Holbrook), and viscosity changes with C_TC (Thompson and Holbrook ; Seas, Flanagan)  ; set in IntroDialogBox
-
-// Hydro Resistance Parameters (set in GUI) :
-Fortran_vector r_Xyl			; //(MPa h / ml) : xylem water resistance
-Fortran_vector r_ST			; // (MPa h / ml) : axial phloem water resistance
-Fortran_vector r_ST_ref 	; // r_ST_ ref. values for C_TC =  0.5 mmol / ml sap solution
-Fortran_vector r_abs			; // soil - root  water resistances (may be changed by user)			(MPa h / ml)
-Fortran_vector r_Trsv			; // Transverse xylem to phloem apoplasm water resistance										(MPa h / ml)
-Fortran_vector r_PhlMb		; // Transmembrane Phloem (ST,CC) Apoplasm to Symplasm water resistance		(MPa h / ml)
-Fortran_vector r_ParMb		; // Transmembrane Parenchyma Apoplasm to Symplasm water resistance		(MPa h / ml)
-Fortran_vector r_Apo			;//  Lateral parenchyma to phloem Apoplastic (MPa h / ml)
-Fortran_vector r_Sympl			; // Lateral parenchyma to phloem ST Symplasmic water resistance (MPa h / ml)
-
-// constants to express hydro resistance changes :
-#define NONE 0
-#define XYL 1
-#define TRSV 2
-#define APO 4
-#define SYMPL 8
-#define PHL 16
-#define PHLMB 32
-#define PARMB 64
-#define RABS 128
-
-int resistance_changed = NONE ; // = NONE a priori
-void UpdateResistances(double t) ; // in  initialize.cpp
-void Smooth_Parameter_and_BoundaryConditions_Changes(int s, double t) ; // User-editable (implemented in 'PiafMunch2.cpp') ; s = # of integration segment
-//void C_fluxes(double t, int Nt) ; // in  PiafMunch2.cpp
-void vector_init(double t, double *y, double *y_dot);
-
-// ******************  mere C-fluxes related variables or parameters ********** :
-extern double *Q_ST, *Q_Mesophyll, *Q_RespMaint, *Q_Exudation, *Q_Growthtot, *Q_out ;		  // components of vector y as used in diff. system f()...
-extern double *Q_ST_dot, *Q_Mesophyll_dot, *Q_Rm_dot, *Q_Exud_dot, *Q_Gtot_dot, *Q_out_dot ; //... and its derivatives.  ;
-extern double *vol_Sympl ;
-extern Fortran_vector JS_ST, C_amont, JS_Sympl, JS_Apo, RespMaint ;
-extern Fortran_vector vol_ST, vol_PhlApo, vol_ParApo ;
-extern Fortran_vector r_abs, PsiSoil, Transpirat, Input, Q_RespMaintSyn ;
-extern Fortran_vector P_ST_dot, P_Sympl_dot ; /******* variation rate of any variable X is noted: X_dot = dX/dt *******/
-//Index_vector i_amont					; // i_amont[i] =Id# of  *true*  upflow node
-Fortran_vector i_amont					;
-extern Fortran_vector C_SymplUpflow, C_ApoUpflow ; // to derive JS_Sympl, and maybe JS_Apo, from resp. water fluxes JW_xxx
-
-// ******************  auxiliary sugar- or anatomy- related, non-hydraulic variables or parameters that may be involved in water-system equations ********** :
-extern Fortran_vector C_ST, C_PhlApo		; // Concentration of sugar in phloem  sieve tubes  and  apoplasm, resp.							(mmol / ml)   (ml of solution)
-extern Fortran_vector  JS_PhlMb, JS_ParMb ; //  (if Adv_BioPhysics)  to compute NZS and NZSP (see next line)
-// NZS : optional non-zero volume sugar flow (not a distinct variable)   (ml / h) : NZS = JS_PhlMb * PartMolalVol (=0.2155 in Thompson & Holbrook -- 0.214 might be more accurate)
-extern Fortran_vector C_Sympl, C_ParApo		; // Concentration of sugar in lateral tissue symplasm  and  apoplasm, resp.								(mmol / ml)   (ml of solution)
-extern Fortran_vector Delta_JS_ST ; // sera la composante purement phlomienne de Q_TC_dot[ ]							(mmol / h)
-
-// tracer-specific add-ins :
-extern double *Q_RespMaintmax, *TracerQ_Mesophyll, *TracerQ_RespMaint, *Q_Exudationmax, *Q_Growthtotmax ;		  // components of vector y as used in diff. system f()...
-extern double *Q_Rmmax_dot, *TracerQ_Mesophyll_dot, *TracerQ_Rm_dot, *Q_Exudmax_dot, *Q_Gtotmax_dot ; //... and its derivatives.  ;
-extern Fortran_vector TracerJS_ST, TracerC_Sympl, TracerC_ST, TracerJS_Sympl, TracerJS_Apo, TracerJS_ParMb, TracerJS_PhlMb, TracerC_PhlApo, TracerC_ParApo ;
-extern Fortran_vector TracerQ_RespMaintSyn, TracerInput, TracerRespMaint, TracerC_SymplUpflow, TracerC_ApoUpflow ;
-extern Fortran_vector TracerRatioSympl, TracerRatioQ_RespMaint ;
-extern Fortran_vector Delta_TracerJS_ST ; // sera la composante purement phlomienne de Q_TC_dot[ ]							(mmol / h)
-
-/*************************** VARIABLES INVOLVED IN HYDRIC SYSTEM (Water fluxes): ******************************* */
-extern double* vol_Sympl_dot ; // Rate of symplasmic vol. change (eq. 8)
-Fortran_vector P_Xyl		    	; // Xylem Pressure (= water potential since there is no solute in this version)					(MPa)
-Fortran_vector Psi_Xyl		    	; // Xylem Pressure (= water potential since there is no solute in this version)					(MPa)
-Fortran_vector Psi_ST	 		; // Phloem sieve-tube (+CC) water potential												(MPa)
-Fortran_vector Psi_PhlApo		; // Phloem Apoplam water potential												(MPa)
-Fortran_vector Psi_ParApo		; // Lateral parenchyma apoplasmic water potential												(MPa)
-Fortran_vector P_PhlApo		; // Phloem Apoplam pressure												(MPa)
-Fortran_vector P_ParApo		; // Lateral parenchyma apoplasmic pressure												(MPa)
-Fortran_vector Psi_Sympl		; // Lateral parenchyma symplasmic water potential												(MPa)
-Fortran_vector P_ST			; // Phloem sieve-tube (+CC) turgor pressure 								(MPa)
-Fortran_vector P_Sympl		; // Lateral parenchyma symplasmic turgor pressure 								(MPa)
-Fortran_vector Absorb			; // Root end water absorbtion flux										(ml / h)
-Fortran_vector JW_Xyl			; // Axial xylem water flux
-Fortran_vector JW_ST			; // Axial phloem sieve-tube liquid flux
-Fortran_vector JW_Trsv			; // Transverse xylem to phloem apoplasm water flux									(ml / h)
-Fortran_vector JW_PhlMb		; // Transmembrane Phloem (ST,CC) Apoplasm to Symplasm water flux
-Fortran_vector JW_ParMb		; // Transmembrane Parenchyma Apoplasm to Symplasm water flux
-Fortran_vector JW_Apo			; // Lateral parenchyma to phloem Apoplastic water flux									(ml / h)
-Fortran_vector JW_Sympl		; // Lateral parenchyma to phloem ST Symplasmic liquid flux									(ml / h)
-
-/********************* WATER SYSTEM EQUATIONS  ***************************/
-
-
-double  PartMolalVol =0;
 //comes from Genotelle, J. Expression de la viscosite des solutions sucrees. Ind. Aliment. Agric. 1978, 95, 747-755
 //prooved to hold by https://doi.org/10.1021/ie000266e
 //taken here as presented in "Sucrose Properties and Applications" for pure sucrose solution
 //see 10.1007/978-1-4615-2676-6_6
 //Mathlouthi, M.; Reiser, P., 1995
 //eq. 6.29
-void PhloemFlux::update_viscosity() { // called if (Adv_BioPhysics)
-	static double T_old(-9999.);//V_ref(-9999.) ; // memory of previous T (do not compute dEauPure, siPhi, etc. if T unchanged), and V_ref
-	double d, siEnne,  mu ; 
+void PhloemFlux::update_water_properties() { // T_old : memory of previous T (do not compute dEauPure, siPhi, etc. if T unchanged)
 	if (T_old != TairK_phloem) {
 		TdC = TairK_phloem - 273.15;
 		//in g/L or mg/cm3
 		dEauPure = (999.83952 + TdC * (16.952577 + TdC * (- 0.0079905127 + TdC * (- 0.000046241757 + TdC * (0.00000010584601 + TdC * (- 0.00000000028103006)))))) / (1 + 0.016887236 * TdC); 
 		siPhi = (30 - TdC) / (91 + TdC) ;  T_old = TairK_phloem ;//  R.Gilli 1997, after Mathlouthi & Gnotelle 1995 - valid for any T :
 	}
-   for (int i=1 ; i <= Nc ; i++) { // this loop computes the viscosity profile, temporarily stored as vector r_ST_ before scaling to actual r_ST values:
-		C = C_amont[i] ; // (mmol / ml solution)
-		//  R.Gilli 1997, after Mathlouthi & Gnotelle 1995 - valid for any T :
-		if (C < 0.) C = 0. ; // fix any artefact from solver (may try C<0 even if actual C never does)
-		//342.3 g/mol or mg/mmol
-		double PartMolalVol_ = 0;//0.2155;
-		d = C * 342.3 + (1 - C * PartMolalVol_) * dEauPure ;//in mg/cm3
-		siEnne = (100 * 342.30 * C) / d ; // actually this is sc = sucrose content (g.suc. % g.solution) ; 342.30 = molar mass of sacch.
-		siEnne /= 1900 - (18 * siEnne) ;
-		//mPa s
-		mu =  pow(10, ((22.46 * siEnne) - 0.114 + (siPhi * (1.1 + 43.1 * pow(siEnne, 1.25) )))) ; // peut atteindre des valeurs > 1.e200 !! (sans signification videmment -- le sucre doit prcipiter bien avant !!)
-		mu = mu /(24*60*60)/100/1000; //mPa s to hPa d, 1.11837e-10 hPa d for pure water at 293.15K
-		r_ST[i] = mu*r_ST_ref[i];
-   }
+}
+
+double PhloemFlux::viscosity(double C) const { // viscosity (hPa d) of a sucrose solution of concentration C (mmol / ml solution), see update_water_properties()
+	//  R.Gilli 1997, after Mathlouthi & Gnotelle 1995 - valid for any T :
+	if (C < 0.) C = 0. ; // fix any artefact from solver (may try C<0 even if actual C never does)
+	//342.3 g/mol or mg/mmol
+	double PartMolalVol_ = 0;//0.2155;
+	double d = C * 342.3 + (1 - C * PartMolalVol_) * dEauPure ;//in mg/cm3
+	double siEnne = (100 * 342.30 * C) / d ; // actually this is sc = sucrose content (g.suc. % g.solution) ; 342.30 = molar mass of sacch.
+	siEnne /= 1900 - (18 * siEnne) ;
+	//mPa s
+	double mu =  exp(M_LN10 * ((22.46 * siEnne) - 0.114 + (siPhi * (1.1 + 43.1 * siEnne * sqrt(sqrt(siEnne)) )))) ; // = 10^(...), siEnne^1.25 ; cheaper than pow() // peut atteindre des valeurs > 1.e200 !! (sans signification videmment -- le sucre doit prcipiter bien avant !!)
+	return mu /(24*60*60)/100/1000; //mPa s to hPa d, 1.11837e-10 hPa d for pure water at 293.15K
+}
+
+void PhloemFlux::update_viscosity() { // r_ST from the sucrose concentration C_amont
+	update_water_properties() ;
+	for (int i=1 ; i <= Nc ; i++) r_ST[i] = viscosity(C_amont[i])*r_ST_ref[i];
 }
 
 
 
 
-double R_ = 83.14;//cm^3 hPa K-1 mmol-1
+const double R_ = 83.14;//cm^3 hPa K-1 mmol-1
 void PhloemFlux::f(double t, double *y, double *y_dot) { // the function to be processed by the solver
-	
+	// f is evaluated some 10^5 times per simulated day: fused loops over the raw (1-based) arrays of the Fortran_vectors,
+	// without temporaries nor bound checks. The products by the incidence matrices, JW_ST = Delta * P_ST and
+	// Delta_JS_ST = Delta2 * JS_ST, are computed from I_Upflow and I_Downflow
+	diagnostics.nf ++ ;
 	double RT = R_*TairK_phloem ; // int k ; T may be changed anytime, in function 'parameter_and_boundary_conditions(t)  in PiafMunch2.cpp
-	static Fortran_vector dummy(Nt);
 	Q_ST = y ;							// note: zero_indices  Q_ST[0],..., Q_RespMaint[0]... are ignored
 	Q_Mesophyll = Q_ST + Nt ; 
 	Q_RespMaint = Q_Mesophyll + Nt ; 
@@ -205,15 +84,6 @@ void PhloemFlux::f(double t, double *y, double *y_dot) { // the function to be p
 	//if delete, lower neq
 	Q_out = Q_Exudationmax + Nt;//for intermediary compartment between ST and outside. useless (not implemented) delete?
 	
-	for (int i=1; i<=Nt; i++)  {
-		double volSTi = vol_ST[i];
-		double QSTi = Q_ST[i];
-		
-		if (QSTi < 0.){ QSTi = 0. ; Q_ST[i] =0;}// fix any artefact from solver (may try C<0 even if actual C never does)
-		if (Q_Mesophyll[i] < 0.){ Q_Mesophyll[i] =0;}// fix any artefact from solver (may try C<0 even if actual C never does)
-		C_ST[i] = QSTi / volSTi ; // Concentration of sugar in sieve tubes		(mmol / ml)
-	
-	}
 	Q_ST_dot = y_dot ; 
 	Q_Mesophyll_dot = Q_ST_dot + Nt ; 
 	Q_Rm_dot = Q_Mesophyll_dot + Nt ; 
@@ -235,40 +105,187 @@ void PhloemFlux::f(double t, double *y, double *y_dot) { // the function to be p
 		Psi_ST *= - RT ;
 	}	*/
 	
-	P_ST.set(C_ST);
-	P_ST *= RT;
-	if(usePsiXyl){P_ST += Psi_Xyl ;}
-	JW_ST.set_matmult(Delta, P_ST) ; 
+	double *C_ST_a = InPlace_Array(C_ST), *P_ST_a = InPlace_Array(P_ST), *Delta_JS_ST_a = InPlace_Array(Delta_JS_ST) ;
+	const double *vol_ST_a = InPlace_Array(vol_ST), *Psi_Xyl_a = InPlace_Array(Psi_Xyl) ;
+	for (int i=1; i<=Nt; i++)  {
+		if (Q_ST[i] < 0.){ Q_ST[i] =0; diagnostics.nClamped ++;}// fix any artefact from solver (may try C<0 even if actual C never does)
+		if (Q_Mesophyll[i] < 0.){ Q_Mesophyll[i] =0; diagnostics.nClamped ++;}// fix any artefact from solver (may try C<0 even if actual C never does)
+		C_ST_a[i] = Q_ST[i] / vol_ST_a[i] ; // Concentration of sugar in sieve tubes		(mmol / ml)
+		P_ST_a[i] = C_ST_a[i] * RT ;
+		if(usePsiXyl){P_ST_a[i] += Psi_Xyl_a[i] ;}
+		Delta_JS_ST_a[i] = 0. ;
+	}
+	
+	double *JW_ST_a = InPlace_Array(JW_ST), *JS_ST_a = InPlace_Array(JS_ST), *C_amont_a = InPlace_Array(C_amont), *i_amont_a = InPlace_Array(i_amont) ;
+	double *r_ST_a = InPlace_Array(r_ST) ;
+	const double *r_ST_ref_a = InPlace_Array(r_ST_ref) ;
+	if(update_viscosity_){update_water_properties() ;}
 	for(int j = 1 ; j <= Nc ; j ++) {
-		//int i_aval; double C_aval;
-		if(JW_ST[j] > 0)
-		{  
-			i_amont[j] = I_Upflow[j] ; 
-		}else{  
-			i_amont[j] = I_Downflow[j] ; 
-		}
-		C_amont[j] = C_ST[i_amont[j]] ; 
-		
-		if((errorID == I_Upflow[j])||(errorID == I_Downflow[j]))//found an error in last run of C_fluxes function
-		{
-			std::ofstream outfile;
-			outfile.open("errors.txt", std::ios_base::app); // append instead of overwrite
-			outfile<< "JW_ST "<<JW_ST[j]<<" r_ST "<<r_ST[j]<<" ide "<<errorID<<" ids "<<I_Upflow[j]<<" "<< I_Downflow[j]<<std::flush;
-			outfile<<" cst: "<<C_ST[I_Upflow[j]]<<" "<<C_ST[I_Downflow[j]] <<std::flush;
-			outfile<<" pst: "<<P_ST[I_Upflow[j]]<<" "<<P_ST[I_Downflow[j]] <<std::flush;
-			outfile<<" vol: "<<vol_ST[I_Upflow[j]]<<" "<<vol_ST[I_Downflow[j]] <<std::flush;
-			outfile<<std::endl<<std::flush;
-			assert(false&&"PhloemFlux::C_fluxes : negative maximal flux of sucrose concentration");
-			
+		int u = I_Upflow[j], d = I_Downflow[j] ;
+		JW_ST_a[j] = P_ST_a[u] - P_ST_a[d] ;
+		int i_a = (JW_ST_a[j] > 0) ? u : d ; // true upflow node
+		i_amont_a[j] = i_a ;
+		C_amont_a[j] = C_ST_a[i_a] ; 
+		if (C_amont_a[j] < 0.) C_amont_a[j] = 0. ; // fix any artefact from solver (may try C<0 even if actual C never does)
+		if(update_viscosity_){r_ST_a[j] = viscosity(C_amont_a[j])*r_ST_ref_a[j];}
+		JW_ST_a[j] /= r_ST_a[j];
+		JS_ST_a[j] = JW_ST_a[j] * C_amont_a[j] ;	// 	i.e.   JS_ST = JW_ST * C_amont			   (eq. 11)
+		Delta_JS_ST_a[u] -= JS_ST_a[j] ;
+		Delta_JS_ST_a[d] += JS_ST_a[j] ;
+	}
+	if(errorID >= 0) { // found an error in last run of C_fluxes function: log the adjacent connections, startPM() stops after the integration
+		for(int j = 1 ; j <= Nc ; j ++) {
+			int u = I_Upflow[j], d = I_Downflow[j] ;
+			if((errorID != u)&&(errorID != d)) continue ;
+			diagnostics.log<< "JW_ST "<<JW_ST_a[j]<<" r_ST "<<r_ST_a[j]<<" ide "<<errorID<<" ids "<<u<<" "<< d ;
+			diagnostics.log<<" cst: "<<C_ST_a[u]<<" "<<C_ST_a[d] ;
+			diagnostics.log<<" pst: "<<P_ST_a[u]<<" "<<P_ST_a[d] ;
+			diagnostics.log<<" vol: "<<vol_ST_a[u]<<" "<<vol_ST_a[d]<<std::endl ;
 		}
-		if (C_amont[j] < 0.) C_amont[j] = 0. ; // fix any artefact from solver (may try C<0 even if actual C never does)
+		errorID = -1 ;
 	}
-	if(update_viscosity_){update_viscosity() ;}
-	JW_ST /= r_ST;
-	
-	JS_ST.set_elemult(JW_ST, C_amont) ;	// 	i.e.   JS_ST = JW_ST * C_amont			   (eq. 11)
-	Delta_JS_ST.set_matmult(Delta2, JS_ST) ;
 	
 	C_fluxes(t, Nt) ; //see PiafMunch2.cpp
 	
 }
+
+sunindextype PhloemFlux::jacIndex(int row, int col) const { // position of the entry (row, col) in the pattern of Jac, 0-based, see initialize_jacobian()
+	if (col >= 2 * Nt) return Jac.colptrs[col] ; // diagonal only
+	if (col >= Nt) return Jac.colptrs[col] + ((row >= Nt) ? 1 : 0) ; // Q_ST_dot, Q_Mesophyll_dot
+	if (row >= Nt) return Jac.colptrs[col + 1] - 6 + row / Nt ; // Q_Mesophyll_dot, Q_Rm_dot, Q_Exud_dot, Q_Gtot_dot, Q_Rmmax_dot
+	if (row == col) return Jac_diag[col] ;
+	return std::lower_bound(Jac.rowvals.begin() + Jac.colptrs[col], Jac.rowvals.begin() + Jac.colptrs[col + 1], row) - Jac.rowvals.begin() ; // neighbour node, the loops use Jac_conn instead
+}
+
+void PhloemFlux::jacobian(double t, double *y, double *Jx) { // analytical df/dy, f(t, y) was called just before (C_ST, JW_ST, C_amont, r_ST are up to date)
+	auto at = [&](int row, int col) -> double& { return Jx[jacIndex(row, col)] ; } ;
+	std::fill(Jx, Jx + Jac.rowvals.size(), 0.) ;
+	double RT = R_*TairK_phloem ;
+	double fQ10 = pow(Q10,(TairC - TrefQ10)/10) ;
+	for (int i = 1 ; i <= Nt ; i ++) { // sucrose loading and usage, see C_fluxes() in PiafMunch2.cpp
+		double dC = 1./vol_ST[i] ; // dC_ST / dQ_ST
+		double dCm = (vol_ParApo[i] > 0.) ? 1./vol_ParApo[i] : 0. ; // dCmeso / dQ_Mesophyll (vol_ParApo < 0 for nodes without mesophyll)
+		double CSTi = max(0.,C_ST[i]) ;
+		double Cmeso = max(0.,Q_Mesophyll[i]/vol_ParApo[i]) ;
+		double Fl_max = (Vmaxloading *len_leaf[i]) * exp(-CSTi* beta_loading) ;
+		double dFl_dC = - beta_loading * Fl_max * Cmeso/(Mloading + Cmeso) ;
+		double dFl_dCm = Fl_max * Mloading/((Mloading + Cmeso)*(Mloading + Cmeso)) ;
+		double dCu = (CSTi > CSTimin) ? 1. : 0. ; // no sucrose usage below CSTimin
+		CSTi = max(0., CSTi-CSTimin) ;
+		double dExud = (CSTi > Csoil) ? Q_Exudmax[i] * dCu : 0. ;
+		double Q_Rmmax_ = (Q_Rmmax[i] + krm2[i] * CSTi) * fQ10 ;
+		double dRmmax = krm2[i] * fQ10 * dCu ;
+		double Fu_lim = (Q_Rmmax_ + Q_Grmax[i]) * (CSTi/(CSTi + KMfu)) ;
+		double dFu = dRmmax * (CSTi/(CSTi + KMfu)) + (Q_Rmmax_ + Q_Grmax[i]) * KMfu/((CSTi + KMfu)*(CSTi + KMfu)) * dCu ;
+		double dRm = (Fu_lim < Q_Rmmax_) ? dFu : dRmmax ;
+		double dGr = ((Fu_lim >= Q_Rmmax_) && (Fu_lim - Q_Rmmax_ < Q_Grmax[i])) ? dFu - dRmmax : 0. ;
+		int col = i - 1 ; // column of Q_ST[i]
+		at(i - 1, col) += (dFl_dC - dFu - dExud) * dC ;
+		at(Nt + i - 1, col) = - dFl_dC * dC ;
+		at(2*Nt + i - 1, col) = dRm * dC ;
+		at(3*Nt + i - 1, col) = dExud * dC ;
+		at(4*Nt + i - 1, col) = dGr * dC ;
+		at(5*Nt + i - 1, col) = dRmmax * dC ;
+		col = Nt + i - 1 ; // column of Q_Mesophyll[i]
+		at(i - 1, col) = dFl_dCm * dCm ;
+		at(Nt + i - 1, col) = - dFl_dCm * dCm ;
+	}
+	for (int j = 1 ; j <= Nc ; j ++) { // axial sucrose flux JS_ST = JW_ST * C_amont, JW_ST = (P_ST[up] - P_ST[down]) / r_ST
+		int u = I_Upflow[j] ; int d = I_Downflow[j] ;
+		double dJS_dP = C_amont[j] / r_ST[j] ; // through P_ST[up] (and - P_ST[down])
+		double dJS_dCa = JW_ST[j] ; // through C_amont
+		if (update_viscosity_) { // r_ST = mu(C_amont) * r_ST_ref, see update_viscosity()
+			double C = C_amont[j] ;
+			double dens = C * 342.3 + dEauPure ;
+			double sc = (100 * 342.30 * C) / dens ;
+			double siEnne = sc / (1900 - (18 * sc)) ;
+			double dsiEnne = (100 * 342.30 * dEauPure) / (dens * dens) * 1900 / ((1900 - (18 * sc))*(1900 - (18 * sc))) ;
+			double dlnmu = log(10.) * (22.46 + siPhi * 43.1 * 1.25 * pow(siEnne, 0.25)) * dsiEnne ;
+			dJS_dCa *= 1. - C * dlnmu ;
+		}
+		double dJS_du = (RT * dJS_dP + ((i_amont[j] == u) ? dJS_dCa : 0.)) / vol_ST[u] ; // d JS_ST / d Q_ST[up]
+		double dJS_dd = (- RT * dJS_dP + ((i_amont[j] == d) ? dJS_dCa : 0.)) / vol_ST[d] ; // d JS_ST / d Q_ST[down]
+		Jx[Jac_diag[u - 1]] -= dJS_du ; Jx[Jac_conn[2 * (j - 1)]] -= dJS_dd ; // Delta_JS_ST[up] = ... - JS_ST
+		Jx[Jac_conn[2 * (j - 1) + 1]] += dJS_du ; Jx[Jac_diag[d - 1]] += dJS_dd ; // Delta_JS_ST[down] = ... + JS_ST
+	}
+}
+
+double PhloemFlux::jacobianError(double t, double eps) { // compares jacobian() column by column with central finite differences of f at y = Y0
+	int n = Y0.size() ;
+	vector<double> y(n + 1), yp(n + 1), ym(n + 1), fy(n + 1), fp(n + 1), fm(n + 1), Jx(Jac.rowvals.size()), col(n) ;
+	for (int i = 1 ; i <= n ; i ++) y[i] = Y0[i] ;
+	f(t, y.data(), fy.data()) ;
+	jacobian(t, y.data(), Jx.data()) ;
+	double err = 0. ;
+	for (int c = 0 ; c < n ; c ++) {
+		double h = eps * max(1.e-6, std::abs(y[c + 1])) ; // relative step (the sucrose contents are small)
+		yp = y ; yp[c + 1] += h ;
+		ym = y ; ym[c + 1] -= h ;
+		f(t, yp.data(), fp.data()) ;
+		f(t, ym.data(), fm.data()) ;
+		std::fill(col.begin(), col.end(), 0.) ; // analytical column, zero outside the pattern
+		for (sunindextype k = Jac.colptrs[c] ; k < Jac.colptrs[c + 1] ; k ++) col[Jac.rowvals[k]] = Jx[k] ;
+		double scale = 0., e = 0. ;
+		for (int r = 0 ; r < n ; r ++) {
+			double fd = (fp[r + 1] - fm[r + 1]) / (2 * h) ;
+			scale = max(scale, max(std::abs(fd), std::abs(col[r]))) ;
+			e = max(e, std::abs(fd - col[r])) ;
+		}
+		if (scale > 0.) err = max(err, e / scale) ;
+	}
+	f(t, y.data(), fy.data()) ; // intermediate variables at y again
+	return err ;
+}
+
+int PhloemFlux::precSetup(double t, double *y, bool jok, bool& jcur, double gamma) { // P = I - gamma * df/dy, with the analytical jacobian
+	// Only the Q_ST and Q_Mesophyll columns of df/dy have off-diagonal entries (see initialize_jacobian()): Q_Mesophyll is eliminated per node,
+	// the Schur complement on Q_ST couples the nodes along the sieve tube connections only, and is factorized along the tree (O(Nt)).
+	// P is therefore solved exactly; the other variables follow by back substitution in precSolve()
+	if (Prec_ST.getNumberOfNodes() != Nt) return -1 ; // the connections do not form a tree, see initialize_jacobian()
+	jcur = (!jok) || (Prec_Jx.size() != Jac.rowvals.size()) ;
+	if (jcur) {
+		Prec_fy.resize(Y0.size() + 1) ;
+		f(t, y, Prec_fy.data()) ; // updates the intermediate variables (C_ST, JW_ST, C_amont, r_ST) at y
+		Prec_Jx.resize(Jac.rowvals.size()) ;
+		jacobian(t, y, Prec_Jx.data()) ;
+	}
+	auto J = [&](int row, int col) { return Prec_Jx[jacIndex(row, col)] ; } ;
+	vector<double> diag(Nt), lower(Nc), upper(Nc) ;
+	Prec_node.resize(7 * Nt) ;
+	for (int i = 1 ; i <= Nt ; i ++) {
+		int s = i - 1, m = Nt + i - 1 ; // rows (and columns) of Q_ST[i] and Q_Mesophyll[i]
+		double* P = &Prec_node[7 * (i - 1)] ;
+		P[0] = - gamma * J(s, m) ;
+		P[1] = - gamma * J(m, s) ;
+		P[2] = 1. - gamma * J(m, m) ; // >= 1, since loading decreases Q_Mesophyll
+		for (int b = 2 ; b <= 5 ; b ++) P[b + 1] = - gamma * J(b * Nt + i - 1, s) ;
+		diag[s] = 1. - gamma * J(s, s) - P[0] * P[1] / P[2] ;
+	}
+	for (int j = 1 ; j <= Nc ; j ++) {
+		lower[j - 1] = - gamma * Prec_Jx[Jac_conn[2 * (j - 1)]] ; // (up, down)
+		upper[j - 1] = - gamma * Prec_Jx[Jac_conn[2 * (j - 1) + 1]] ; // (down, up)
+	}
+	try {
+		Prec_ST.factorize(diag, lower, upper) ;
+	} catch (const std::runtime_error& e) { // zero pivot: recoverable, CVODE retries with a new jacobian or a smaller step
+		return 1 ;
+	}
+	return 0 ;
+}
+
+int PhloemFlux::precSolve(double *r, double *z) { // solves P z = r (1-based), P factorized in precSetup()
+	Prec_b.resize(Nt) ;
+	for (int i = 1 ; i <= Nt ; i ++) {
+		const double* P = &Prec_node[7 * (i - 1)] ;
+		Prec_b[i - 1] = r[i] - P[0] / P[2] * r[Nt + i] ;
+	}
+	Prec_ST.solve(Prec_b.data(), 1) ;
+	for (int i = 1 ; i <= Nt ; i ++) {
+		const double* P = &Prec_node[7 * (i - 1)] ;
+		z[i] = Prec_b[i - 1] ;
+		z[Nt + i] = (r[Nt + i] - P[1] * z[i]) / P[2] ;
+		for (int b = 2 ; b <= 5 ; b ++) z[b * Nt + i] = r[b * Nt + i] - P[b + 1] * z[i] ;
+		for (int b = 6 ; b < neq_coef ; b ++) z[b * Nt + i] = r[b * Nt + i] ;
+	}
+	return 0 ;
+}
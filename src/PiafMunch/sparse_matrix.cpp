@@ -2565,7 +2565,7 @@ SpUnit_matrix::SpUnit_matrix(const Sparse_matrix &S): m_(S.m_), n_(S.n_), nnz_(S
 		else {
 			if (S_v[k] == -1.) U_ij[k] = false ;
 			else {
-				(void)sprintf(message, "SpUnit_matrix(Sparse_matrix &S): constructor failed: S.cmv[%d] is not 0, 1 or -1", k+1) ; _LogMessage(message) ;
+				char message[200] ; (void)sprintf(message, "SpUnit_matrix(Sparse_matrix &S): constructor failed: S.cmv[%d] is not 0, 1 or -1", k+1) ; _LogMessage(message) ;
 				assert(false) ;
 			}
 		}
@@ -2576,7 +2576,7 @@ SpUnit_matrix::SpUnit_matrix(const Sparse_matrix &S): m_(S.m_), n_(S.n_), nnz_(S
 		else {
 			if (S_v[k] == -1.) U_ij[k] = false ;
 			else {
-				(void)sprintf(message, "SpUnit_matrix(Sparse_matrix &S): constructor failed: S.rmv[%d] is not 0, 1 or -1", k+1) ; _LogMessage(message) ;
+				char message[200] ; (void)sprintf(message, "SpUnit_matrix(Sparse_matrix &S): constructor failed: S.rmv[%d] is not 0, 1 or -1", k+1) ; _LogMessage(message) ;
 				assert(false) ;
 			}
 		}
@@ -67,6 +67,7 @@ void Plant::initializeReader()
 void Plant::reset()
 {
     baseOrgans.clear();
+    store.clear();
     simtime = 0;
     organId = -1;
     nodeId = -1;
@@ -241,6 +242,7 @@ void Plant::setTropism(std::shared_ptr<Tropism> tf, int organType, int subType)
     Organism::simulate(dt, verbose);	
 	rel2abs();
 	relCoord = false;
+	updateSegmentStore(true); // stems and leaves report their moved nodes (@see Organ::getMovedNodes)
 }
 
 /**
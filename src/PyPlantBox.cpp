@@ -1,6 +1,7 @@
 // -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
 #include "external/pybind11/include/pybind11/pybind11.h"
 #include "external/pybind11/include/pybind11/stl.h"
+#include "external/pybind11/include/pybind11/numpy.h"
 #include <pybind11/functional.h>
 namespace py = pybind11;
 
@@ -80,6 +81,150 @@ public:
 
 };
 
+/**
+ * NumPy arrays
+ *
+ * Copies C++ data into a read only NumPy array in one block (instead of one Python object per element).
+ * The array owns its data, it stays valid if the C++ vectors are resized or reallocated (e.g. by simulate()),
+ * but does not follow later changes; request a new array after such calls.
+ *
+ * @param data      pointer to the first element
+ * @param shape     shape of the array (C order)
+ */
+template<class T>
+py::array_t<T> arrayCopy(const T* data, std::vector<py::ssize_t> shape)
+{
+    py::array_t<T> a(shape, data); // no base, copies the data
+    a.attr("setflags")(py::arg("write") = false);
+    return a;
+}
+
+/**
+ * NumPy array of a std::vector<T> (1D), @see arrayCopy
+ */
+template<class T>
+py::array_t<T> vectorCopy(const std::vector<T>& v)
+{
+    return arrayCopy<T>(v.data(), { (py::ssize_t)v.size() });
+}
+
+/**
+ * NumPy array of a std::vector of Vector2i or Vector3d (2D, one row per vector), @see arrayCopy
+ */
+template<class T, class V>
+py::array_t<T> vectorCopy(const std::vector<V>& v)
+{
+    static_assert(std::is_standard_layout<V>::value && (sizeof(V)%sizeof(T)==0), "vectorCopy: V must consist of values of type T");
+    return arrayCopy<T>(reinterpret_cast<const T*>(v.data()), { (py::ssize_t)v.size(), (py::ssize_t)(sizeof(V)/sizeof(T)) });
+}
+
+/**
+ * Read only dict like views of the soil mappers of MappedSegments (seg2cell, cell2seg)
+ *
+ * Items are looked up in the C++ vectors (seg2cell, and the CSR cell to segment mapper) when they are accessed,
+ * no map is copied. The views keep their owner alive, and follow later changes of the mappers (e.g. by simulate()).
+ */
+struct Seg2CellView
+{
+    py::object owner; // keeps ms alive
+    const MappedSegments* ms;
+
+    bool contains(int si) const {
+        return (si>=0) && (si<ms->seg2cell.size()) && (ms->seg2cell[si]!=MappedSegments::unmapped);
+    }
+    int at(int si) const {
+        if (!contains(si)) {
+            throw py::key_error(std::to_string(si));
+        }
+        return ms->seg2cell[si];
+    }
+    std::vector<int> keys() const {
+        std::vector<int> k;
+        for (int si = 0; si<ms->seg2cell.size(); si++) {
+            if (ms->seg2cell[si]!=MappedSegments::unmapped) {
+                k.push_back(si);
+            }
+        }
+        return k;
+    }
+};
+
+struct Cell2SegView
+{
+    py::object owner; // keeps ms alive
+    const MappedSegments* ms;
+
+    std::vector<int> segs(int c) const { // segments of cell c, cell -1 holds the segments outside the soil domain
+        if (c==-1) {
+            std::vector<int> s;
+            for (int si = 0; si<ms->seg2cell.size(); si++) {
+                if (ms->seg2cell[si]==-1) {
+                    s.push_back(si);
+                }
+            }
+            return s;
+        }
+        const auto& offsets = ms->getCell2SegOffsets();
+        const auto& indices = ms->getCell2SegIndices();
+        if ((c<0) || (c+1>=offsets.size())) {
+            return std::vector<int>();
+        }
+        return std::vector<int>(indices.begin()+offsets[c], indices.begin()+offsets[c+1]);
+    }
+    bool contains(int c) const {
+        if (c==-1) {
+            return std::find(ms->seg2cell.begin(), ms->seg2cell.end(), -1)!=ms->seg2cell.end();
+        }
+        const auto& offsets = ms->getCell2SegOffsets();
+        return (c>=0) && (c+1<offsets.size()) && (offsets[c+1]>offsets[c]);
+    }
+    std::vector<int> at(int c) const {
+        if (!contains(c)) {
+            throw py::key_error(std::to_string(c));
+        }
+        return segs(c);
+    }
+    std::vector<int> keys() const {
+        std::vector<int> k;
+        if (contains(-1)) {
+            k.push_back(-1);
+        }
+        const auto& offsets = ms->getCell2SegOffsets();
+        for (int c = 0; c<int(offsets.size())-1; c++) {
+            if (offsets[c+1]>offsets[c]) {
+                k.push_back(c);
+            }
+        }
+        return k;
+    }
+};
+
+/**
+ * Binds the read only dict interface of a mapper view V (Seg2CellView or Cell2SegView)
+ */
+template<class V>
+void bindMapperView(py::module& m, const char* name)
+{
+    py::class_<V>(m, name)
+        .def("__getitem__", &V::at)
+        .def("__contains__", &V::contains)
+        .def("__len__", [](const V& v) { return v.keys().size(); })
+        .def("__iter__", [](const V& v) { return py::iter(py::cast(v.keys())); })
+        .def("keys", &V::keys)
+        .def("values", [](const V& v) {
+            py::list l;
+            for (int k : v.keys()) { l.append(py::cast(v.at(k))); }
+            return l;
+        })
+        .def("items", [](const V& v) {
+            py::list l;
+            for (int k : v.keys()) { l.append(py::make_tuple(k, v.at(k))); }
+            return l;
+        })
+        .def("get", [](const V& v, int k, py::object d) { return v.contains(k) ? py::cast(v.at(k)) : d; }, py::arg("k"), py::arg("default") = py::none())
+        .def("__repr__", [](const V& v) { return py::str(py::dict(py::cast(v))); });
+}
+
 // todo
 // SignedDistanceFunction
 // OrganRandomParameter
@@ -309,6 +454,16 @@ PYBIND11_MODULE(plantbox, m) {
     /*
      * Organism.h
      */
+    py::class_<SegmentStore>(m, "SegmentStore") // read only NumPy arrays (@see arrayCopy)
+            .def("getNumberOfSegments", &SegmentStore::getNumberOfSegments, py::arg("ot") = -1) // default
+            .def_property_readonly("nodes", [](const SegmentStore& s) { return arrayCopy<double>(s.nodes.data(), { (py::ssize_t)s.nodeCTs.size(), 3 }); })
+            .def_property_readonly("nodeCTs", [](const SegmentStore& s) { return vectorCopy(s.nodeCTs); })
+            .def_property_readonly("segments", [](const SegmentStore& s) { return arrayCopy<int>(s.segments.data(), { (py::ssize_t)s.organIds.size(), 2 }); })
+            .def_property_readonly("organIds", [](const SegmentStore& s) { return vectorCopy(s.organIds); })
+            .def_property_readonly("organTypes", [](const SegmentStore& s) { return vectorCopy(s.organTypes); })
+            .def_property_readonly("subTypes", [](const SegmentStore& s) { return vectorCopy(s.subTypes); })
+            .def_property_readonly("radii", [](const SegmentStore& s) { return vectorCopy(s.radii); })
+            .def_property_readonly("updatedNodeIndices", [](const SegmentStore& s) { return vectorCopy(s.updatedNodeIndices); });
     py::class_<Organism, std::shared_ptr<Organism>>(m, "Organism")
             .def(py::init<double>(),  py::arg("seednum") = 0)
             .def("copy", &Organism::copy)
@@ -320,8 +475,10 @@ PYBIND11_MODULE(plantbox, m) {
 
             .def("addOrgan", &Organism::addOrgan)
             .def("initialize", &Organism::initialize, py::arg("verbose") = true)
-            .def("simulate", &Organism::simulate, py::arg("dt"), py::arg("verbose") = false) //default
+            .def("simulate", &Organism::simulate, py::arg("dt"), py::arg("verbose") = false, py::call_guard<py::gil_scoped_release>()) //default, Python callbacks acquire the GIL (parallel simulation)
             .def("getSimTime", &Organism::getSimTime)
+            .def("setThreads", &Organism::setThreads)
+            .def("getThreads", &Organism::getThreads)
 
             .def("getOrgans", &Organism::getOrgans, py::arg("ot") = -1, py::arg("allOrgs")=false) // default
             .def("getParameter", &Organism::getParameter, py::arg("name"), py::arg("ot") = -1, py::arg("organs") = std::vector<std::shared_ptr<Organ>>(0)) // default
@@ -348,6 +505,7 @@ PYBIND11_MODULE(plantbox, m) {
             .def("getNewNodeCTs", &Organism::getNewNodeCTs)
             .def("getNewSegments", &Organism::getNewSegments, py::arg("ot") = -1)  // default
             .def("getNewSegmentOrigins", &Organism::getNewSegmentOrigins, py::arg("ot") = -1)  // default
+            .def("getSegmentStore", &Organism::getSegmentStore, py::return_value_policy::reference_internal)
 
             .def("initializeReader", &Organism::initializeReader)
             .def("readParameters", &Organism::readParameters, py::arg("name"), py::arg("basetag") = "plant", py::arg("fromFile") = true)  // default
@@ -788,7 +946,7 @@ PYBIND11_MODULE(plantbox, m) {
             .def("initializeLB", (void (RootSystem::*)(int, int, bool)) &RootSystem::initializeLB, py::arg("basal"), py::arg("shootborne"), py::arg("verbose") = true)
             .def("initializeDB", (void (RootSystem::*)(int, int, bool)) &RootSystem::initializeDB, py::arg("basal"), py::arg("shootborne"), py::arg("verbose") = true)
 			.def("setTropism", &RootSystem::setTropism)
-            .def("simulate",(void (RootSystem::*)(double,bool)) &RootSystem::simulate, py::arg("dt"), py::arg("verbose") = false)
+            .def("simulate",(void (RootSystem::*)(double,bool)) &RootSystem::simulate, py::arg("dt"), py::arg("verbose") = false, py::call_guard<py::gil_scoped_release>())
             .def("simulate",(void (RootSystem::*)()) &RootSystem::simulate)
             .def("simulate",(void (RootSystem::*)(double, double, ProportionalElongation*, bool)) &RootSystem::simulate)
             .def("getRoots", &RootSystem::getRoots)
@@ -806,6 +964,8 @@ PYBIND11_MODULE(plantbox, m) {
     /*
      * MappedOrganism.h
      */
+    bindMapperView<Seg2CellView>(m, "Seg2CellView");
+    bindMapperView<Cell2SegView>(m, "Cell2SegView");
     py::class_<MappedSegments, std::shared_ptr<MappedSegments>>(m, "MappedSegments")
         .def(py::init<>())
         .def(py::init<std::vector<Vector3d>, std::vector<double>, std::vector<Vector2i>, std::vector<double>, std::vector<int>,  std::vector<int>>())
@@ -821,6 +981,8 @@ PYBIND11_MODULE(plantbox, m) {
         .def("mapSegments",  &MappedSegments::mapSegments)
         .def("cutSegments", &MappedSegments::cutSegments)
         .def_readwrite("soil_index", &MappedSegments::soil_index)
+        .def_readwrite("soil_indices", &MappedSegments::soil_indices)
+        .def("soilIndices", &MappedSegments::soilIndices)
         .def("sort",&MappedSegments::sort)
         .def("segOuterRadii",&MappedSegments::segOuterRadii, py::arg("type") = 0, py::arg("vols") = std::vector<double>(0))
 		.def("segLength",&MappedSegments::segLength)
@@ -831,12 +993,30 @@ PYBIND11_MODULE(plantbox, m) {
         .def_readwrite("organTypes", &MappedSegments::organTypes)
         .def_readwrite("Types", &MappedSegments::subTypes) //kept for backward compatibility
         .def_readwrite("subTypes", &MappedSegments::subTypes)
-        .def_readwrite("seg2cell", &MappedSegments::seg2cell)
-        .def_readwrite("cell2seg", &MappedSegments::cell2seg)
+        .def_property("seg2cell", [](py::object self) { return Seg2CellView{ self, self.cast<const MappedSegments*>() }; },
+            [](MappedSegments& ms, py::object map) { // from a dict, or a Seg2CellView
+                ms.setSeg2CellMap(py::isinstance<Seg2CellView>(map) ? map.cast<const Seg2CellView&>().ms->getSeg2CellMap() : map.cast<std::map<int, int>>());
+            }) // read only view, @see Seg2CellView
+        .def_property_readonly("cell2seg", [](py::object self) { return Cell2SegView{ self, self.cast<const MappedSegments*>() }; }) // read only view, @see Cell2SegView
+        .def("getSeg2CellMap", &MappedSegments::getSeg2CellMap)
+        .def("setSeg2CellMap", &MappedSegments::setSeg2CellMap)
+        .def("getCell2SegMap", &MappedSegments::getCell2SegMap)
+        .def("getCellIndex", &MappedSegments::getCellIndex)
         .def_readwrite("minBound", &MappedSegments::minBound)
         .def_readwrite("maxBound", &MappedSegments::maxBound)
         .def_readwrite("resolution", &MappedSegments::resolution)
-		.def_readwrite("organParam", &MappedSegments::plantParam);
+        .def_readwrite("cutThreads", &MappedSegments::cutThreads)
+		.def_readwrite("organParam", &MappedSegments::plantParam)
+        // read only NumPy arrays (@see arrayCopy)
+        .def("getNodesArray", [](const MappedSegments& ms) { return vectorCopy<double>(ms.nodes); })
+        .def("getNodeCTsArray", [](const MappedSegments& ms) { return vectorCopy(ms.nodeCTs); })
+        .def("getSegmentsArray", [](const MappedSegments& ms) { return vectorCopy<int>(ms.segments); })
+        .def("getRadiiArray", [](const MappedSegments& ms) { return vectorCopy(ms.radii); })
+        .def("getSubTypesArray", [](const MappedSegments& ms) { return vectorCopy(ms.subTypes); })
+        .def("getOrganTypesArray", [](const MappedSegments& ms) { return vectorCopy(ms.organTypes); })
+        .def("getSeg2CellArray", [](const MappedSegments& ms) { return vectorCopy(ms.seg2cell); }) // -1 outside the soil domain, -2 (unmapped) not mapped
+        .def("getCell2SegOffsetsArray", [](const MappedSegments& ms) { return vectorCopy(ms.getCell2SegOffsets()); })
+        .def("getCell2SegIndicesArray", [](const MappedSegments& ms) { return vectorCopy(ms.getCell2SegIndices()); });
     py::class_<MappedRootSystem, RootSystem, MappedSegments,  std::shared_ptr<MappedRootSystem>>(m, "MappedRootSystem")
         .def(py::init<>())
         .def("mappedSegments",  &MappedRootSystem::mappedSegments)
@@ -868,16 +1048,43 @@ PYBIND11_MODULE(plantbox, m) {
             		py::arg("cells") = false, py::arg("soil_k") = std::vector<double>())
 			.def("sumSegFluxes",&XylemFlux::sumSegFluxes)
 			.def("splitSoilFluxes",&XylemFlux::splitSoilFluxes, py::arg("soilFluxes"), py::arg("type") = 0)
+            .def("solveNeumann",&XylemFlux::solveNeumann, py::arg("simTime"), py::arg("value"), py::arg("sx"), py::arg("cells"),
+                    py::arg("soil_k") = std::vector<double>())
+            .def("solveDirichlet",&XylemFlux::solveDirichlet, py::arg("simTime"), py::arg("value"), py::arg("sx"), py::arg("cells"),
+                    py::arg("soil_k") = std::vector<double>())
+            .def("solveLinearSystem",&XylemFlux::solveLinearSystem, py::arg("ind"), py::arg("value"), py::arg("dirichlet"))
+            .def("solveNeumannBatch",&XylemFlux::solveNeumannBatch, py::arg("simTime"), py::arg("value"), py::arg("sxx"), py::arg("cells"),
+                py::arg("soil_k") = std::vector<std::vector<double>>())
+            .def("solveDirichletBatch",&XylemFlux::solveDirichletBatch, py::arg("simTime"), py::arg("value"), py::arg("sxx"), py::arg("cells"),
+                py::arg("soil_k") = std::vector<std::vector<double>>())
+            .def("solve",&XylemFlux::solve, py::arg("simTime"), py::arg("trans"), py::arg("sx"), py::arg("sxx"), py::arg("cells"), py::arg("wiltingPoint"),
+                py::arg("soil_k") = std::vector<double>())
+            .def_readwrite("neumann_ind", &XylemFlux::neumann_ind)
+            .def_readwrite("last", &XylemFlux::last)
+            .def_readwrite("dirichlet_ind", &XylemFlux::dirichlet_ind)
 			.def_readonly("kr_f_cpp", &XylemFlux::kr_f)
             .def_readonly("kx_f_cpp", &XylemFlux::kx_f)
-            .def_readwrite("aI", &XylemFlux::aI)
-            .def_readwrite("aJ", &XylemFlux::aJ)
+            .def_property("aI", [](XylemFlux& x) { return x.aI; },
+                [](XylemFlux& x, std::vector<int> aI) { x.aI = aI; x.topology++; }) // the solvers analyze the new pattern
+            .def_property("aJ", [](XylemFlux& x) { return x.aJ; },
+                [](XylemFlux& x, std::vector<int> aJ) { x.aJ = aJ; x.topology++; })
+            .def_readwrite("useTreeSolver", &XylemFlux::useTreeSolver)
             .def_readwrite("aV", &XylemFlux::aV)
             .def_readwrite("aB", &XylemFlux::aB)
-            .def_readwrite("kr", &XylemFlux::kr)
-            .def_readwrite("kx", &XylemFlux::kx)
+            .def_property("kr", [](XylemFlux& x) { return x.kr; },
+                [](XylemFlux& x, std::vector<std::vector<double>> kr) { x.kr = kr; x.compileConductivities(); }) // recompiles the conductivity tables
+            .def_property("kx", [](XylemFlux& x) { return x.kx; },
+                [](XylemFlux& x, std::vector<std::vector<double>> kx) { x.kx = kx; x.compileConductivities(); })
+            .def("compileConductivities", &XylemFlux::compileConductivities)
+            .def("conductivities", [](XylemFlux& x, double simTime) {
+                std::vector<double> kr, kx;
+                x.conductivities(simTime, kr, kx);
+                return py::make_tuple(kr, kx); }, py::arg("simTime"))
             .def_readwrite("rs", &XylemFlux::rs)
-			.def_readwrite("psi_air", &XylemFlux::psi_air);
+			.def_readwrite("psi_air", &XylemFlux::psi_air)
+            // read only NumPy arrays of the linear system (@see arrayCopy)
+            .def("getLinearSystemArrays", [](const XylemFlux& x) {
+                return py::make_tuple(vectorCopy(x.aI), vectorCopy(x.aJ), vectorCopy(x.aV), vectorCopy(x.aB)); });
 
     /*
      * Plant.h
@@ -893,7 +1100,7 @@ PYBIND11_MODULE(plantbox, m) {
             .def("reset", &Plant::reset)
             .def("openXML", &Plant::openXML)
             .def("setTropism", &Plant::setTropism)
-            .def("simulate",(void (Plant::*)(double,bool)) &Plant::simulate, py::arg("dt"), py::arg("verbose") = false)
+            .def("simulate",(void (Plant::*)(double,bool)) &Plant::simulate, py::arg("dt"), py::arg("verbose") = false, py::call_guard<py::gil_scoped_release>())
             .def("simulate",(void (Plant::*)()) &Plant::simulate)
             .def("initCallbacks", &Plant::initCallbacks)
             .def("createTropismFunction", &Plant::createTropismFunction)
@@ -948,6 +1155,12 @@ PYBIND11_MODULE(plantbox, m) {
             .def_readwrite("Ag4Phloem", &Photosynthesis::Ag4Phloem)
             .def_readwrite("minLoop", &Photosynthesis::minLoop)
             .def_readwrite("maxLoop", &Photosynthesis::maxLoop)
+            .def_readonly("loop", &Photosynthesis::loop)
+            .def_readonly("maxMaxErr", &Photosynthesis::maxMaxErr)
+            .def_readwrite("andersonDepth", &Photosynthesis::andersonDepth)
+            .def_readwrite("loopThreads", &Photosynthesis::loopThreads)
+            .def_readonly("solveTime", &Photosynthesis::solveTime)
+            .def_readonly("trace", &Photosynthesis::trace)
             .def_readwrite("Patm", &Photosynthesis::Patm)
             .def_readwrite("cs", &Photosynthesis::cs)
             .def_readwrite("TleafK", &Photosynthesis::TleafK)
@@ -974,7 +1187,7 @@ PYBIND11_MODULE(plantbox, m) {
     py::class_<PhloemFlux, Photosynthesis, std::shared_ptr<PhloemFlux>>(m, "PhloemFlux")
             .def(py::init<std::shared_ptr<CPlantBox::MappedPlant>, double, double>(),  py::arg("plant_"),  
 			py::arg("psiXylInit"),  py::arg("ciInit") )
-            .def("waterLimitedGrowth",&PhloemFlux::waterLimitedGrowth)
+            .def("waterLimitedGrowth",[](PhloemFlux& p, double t) { p.waterLimitedGrowth(t); return p.deltaSucOrgNode_.toMaps(); })
             .def("setKr_st",&PhloemFlux::setKr_st, py::arg("values"), py::arg("kr_length_") = -1.0)
 			
             .def("setKx_st",&PhloemFlux::setKx_st)
@@ -983,7 +1196,8 @@ PYBIND11_MODULE(plantbox, m) {
             .def("setRhoSucrose",&PhloemFlux::setRhoSucrose)
             .def("setKrm1",&PhloemFlux::setKrm1)
             .def("setKrm2",&PhloemFlux::setKrm2)
-			.def("startPM",&PhloemFlux::startPM)
+			.def("startPM",&PhloemFlux::startPM, py::call_guard<py::gil_scoped_release>()) // releases the GIL, PhloemFlux objects can run in Python threads
+            .def("jacobianError",&PhloemFlux::jacobianError, py::arg("t"), py::arg("eps") = 1.e-6)
             .def_readonly("rhoSucrose_f",&PhloemFlux::rhoSucrose_f)
             .def_readwrite("psiMax", &PhloemFlux::psiMax)
             .def_readwrite("psiMin", &PhloemFlux::psiMin)
@@ -1014,12 +1228,21 @@ PYBIND11_MODULE(plantbox, m) {
             .def_readwrite("KMfu",&PhloemFlux::KMfu)
             //.def_readwrite("k_meso",&PhloemFlux::k_meso)
             .def_readwrite("Csoil",&PhloemFlux::Csoil)
-            .def_readwrite("deltaSucOrgNode",&PhloemFlux::deltaSucOrgNode_)
+            .def_property_readonly("deltaSucOrgNode",[](const PhloemFlux& p) { return p.deltaSucOrgNode_.toMaps(); })
             .def_readwrite("usePsiXyl",&PhloemFlux::usePsiXyl)
             .def_readwrite("expression",&PhloemFlux::expression)
             .def_readwrite("JW_ST",&PhloemFlux::JW_STv)
             .def_readwrite("Gr_Y",&PhloemFlux::Gr_Y)
             .def_readwrite("solver",&PhloemFlux::solver)
+            .def_readwrite("warmRestart",&PhloemFlux::warmRestart)
+            .def_readwrite("treePreconditioner",&PhloemFlux::treePreconditioner)
+            .def_readwrite("growthThreads",&PhloemFlux::growthThreads)
+            .def_readonly("solverStats",&PhloemFlux::solverStats)
+            .def("flushDiagnostics",&PhloemFlux::flushDiagnostics, py::arg("filename") = "")
+            .def_readwrite("diagnosticsFile",&PhloemFlux::diagnosticsFile)
+            .def_property_readonly("diagnosticsLog",[](const PhloemFlux& p) { return p.diagnostics.log.str(); })
+            .def_property_readonly("diagnosticsCounters",[](const PhloemFlux& p) {
+                return std::map<std::string,long>({{"nf", p.diagnostics.nf}, {"nClamped", p.diagnostics.nClamped}, {"nErrors", p.diagnostics.nErrors}}); })
             .def_readwrite("atol",&PhloemFlux::atol_double)
             .def_readwrite("rtol",&PhloemFlux::rtol_double)
             .def_readwrite("surfMeso",&PhloemFlux::surfMeso)
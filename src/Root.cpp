@@ -114,9 +114,7 @@ void Root::simulate(double dt, bool verbose)
         if (age>0) { // unborn  roots have no children
 
             // children first (lateral roots grow even if base root is inactive)
-            for (auto l:children) {
-                l->simulate(dt,verbose);
-            }
+            plant.lock()->simulateOrgans(children, dt, verbose);
 
             if (active) {
 
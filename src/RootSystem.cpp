@@ -21,7 +21,7 @@ std::shared_ptr<Organism> RootSystem::copy()
     roots.clear(); // clear buffer
     auto nrs = std::make_shared<RootSystem>(*this); // copy constructor
     nrs->seed = std::static_pointer_cast<Seed>(seed->copy(nrs));
-    baseOrgans = nrs->seed->copyBaseOrgans();
+    nrs->baseOrgans = nrs->seed->copyBaseOrgans();
     for (int ot = 0; ot < numberOfOrganTypes; ot++) { // copy organ type parameters
         for (auto& otp : nrs->organParam[ot]) {
             otp.second = otp.second->copy(nrs);
@@ -75,6 +75,7 @@ void RootSystem::reset()
 {
     roots.clear(); // clear buffer
     baseOrgans.clear();
+    store.clear();
     simtime = 0;
     organId = -1;
     nodeId = -1;
@@ -648,6 +649,7 @@ RootSystemState::RootSystemState(const RootSystem& rs) : simtime(rs.simtime), dt
 void RootSystemState::restore(RootSystem& rs)
 {
     rs.roots.clear(); // clear buffer
+    rs.store.clear(); // rebuilt on next access
     rs.simtime = simtime; // copy back everything
     rs.dt = dt;
     rs.organId = organId;
@@ -670,7 +672,7 @@ void RootSystemState::restore(RootSystem& rs)
  * @param r        the root to be stored
  */
 RootState::RootState(const Root& r): alive(r.alive), active(r.active), age(r.age), length(r.getLength(true)),
-    epsilonDx(r.epsilonDx), moved(r.moved), oldNumberOfNodes(r.oldNumberOfNodes), firstCall(r.firstCall)
+    epsilonDx(r.epsilonDx), moved(r.moved), oldNumberOfNodes(r.oldNumberOfNodes), firstCall(r.firstCall), randomStream(r.randomStream)
 {
     lNode = r.nodes.back();
     lNodeId = r.nodeIds.back();
@@ -697,6 +699,7 @@ void RootState::restore(Root& r)
     r.moved = moved;
     r.oldNumberOfNodes = oldNumberOfNodes;
     r.firstCall = firstCall; //
+    r.randomStream = randomStream;
 
     r.nodes.resize(non); // shrink vectors
     r.nodeIds.resize(non);
@@ -181,6 +181,7 @@ private:
     bool moved = false;
     int oldNumberOfNodes = 0;
     bool firstCall = true;
+    RandomStream randomStream; ///< random numbers of the root (parallel simulation)
 
     /* down the root branch*/
     std::vector<RootState> laterals = std::vector<RootState>(0); ///< the lateral roots of this root
@@ -46,21 +46,29 @@ SegmentAnalyser::SegmentAnalyser(const Organism& plant)
 {
     //std::cout << "construct from Organism\n";
     nodes = plant.getNodes();
-    segments = plant.getSegments();
-    auto segCTs = plant.getSegmentCTs();
-    assert(segments.size()==segCTs.size() && "SegmentAnalyser::SegmentAnalyser(Organism p): Unequal vector sizes");
-    data["creationTime"] = segCTs;
-    auto sego = plant.getSegmentOrigins();
-    segO = std::vector<std::weak_ptr<Organ>>(segments.size());
-    auto radii = std::vector<double>(segments.size());
-    auto subType = std::vector<double>(segments.size());
-    auto id = std::vector<double>(segments.size());
-    for (size_t i=0; i<segments.size(); i++) {
-        segO[i] = sego[i]; // convert shared_ptr to weak_ptr
-        radii[i] = segO[i].lock()->getParameter("radius");
-        subType[i] = segO[i].lock()->getParameter("type");
-        id[i] = segO[i].lock()->getParameter("id");
+    const auto& store = plant.getSegmentStore(); // per segment data is copied directly from the store
+    auto segIds = plant.getSegmentIds(); // in organ order, like Organism::getSegments
+    int n = segIds.size();
+    segments.reserve(n);
+    segO.reserve(n);
+    auto segCTs = std::vector<double>(0);
+    auto radii = std::vector<double>(0);
+    auto subType = std::vector<double>(0);
+    auto id = std::vector<double>(0);
+    segCTs.reserve(n);
+    radii.reserve(n);
+    subType.reserve(n);
+    id.reserve(n);
+    for (int i : segIds) {
+        int oid = store.organIds[i];
+        segments.push_back(Vector2i(store.segments[2*i], store.segments[2*i+1]));
+        segCTs.push_back(store.nodeCTs[i+1]);
+        segO.push_back(store.organs[oid]); // convert shared_ptr to weak_ptr
+        radii.push_back(store.radii[i]);
+        subType.push_back(store.subTypes[i]);
+        id.push_back(oid);
     }
+    data["creationTime"] = segCTs;
     data["radius"] = radii;
     data["subType"] = subType;
     data["id"] = id;
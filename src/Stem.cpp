@@ -158,9 +158,7 @@ void Stem::simulate(double dt, bool verbose)
 		if (age>0) { // unborn  roots have no children
 
 			// children first (lateral roots grow even if base root is inactive)
-			for (auto l:children) {
-				l->simulate(dt,verbose);
-			}
+			plant.lock()->simulateOrgans(children, dt, verbose);
 
 			if (active) {
 
@@ -788,6 +786,7 @@ void Stem::rel2abs()
 		
 		
 	}
+	findMovedNodes();
 	//if carry children, update their pos
 	
 	for(size_t i=0; i<children.size(); i++){
@@ -801,6 +800,7 @@ void Stem::rel2abs()
  */
 void Stem::abs2rel()
 {
+	saveNodes();
 	for (int j = nodes.size(); j>1; j--) {
 		nodes[j-1] = nodes.at(j-1).minus(nodes.at(j-2));
 	}
@@ -0,0 +1,171 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "ThreadPool.h"
+
+#include <chrono>
+
+namespace CPlantBox {
+
+thread_local const ThreadPool* ThreadPool::owner = nullptr;
+thread_local int ThreadPool::ownerIndex = 0;
+
+/**
+ * Starts the worker threads
+ *
+ * @param n         number of worker threads
+ */
+ThreadPool::ThreadPool(int n): queued(0), done(false)
+{
+    for (int i = 0; i < n+1; i++) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (int i = 1; i < n+1; i++) {
+        workers.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+}
+
+/**
+ * Stops and joins the worker threads
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        done = true;
+    }
+    sleep.notify_all();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+/**
+ * Submits a task, the task is put into the queue of the calling thread
+ *
+ * @param group     the group the task belongs to
+ * @param task      the task
+ */
+void ThreadPool::run(TaskGroup& group, std::function<void()> task)
+{
+    group.pending++;
+    Queue& q = *queues[index()];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(Task{ task, &group });
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued++;
+    }
+    sleep.notify_one();
+}
+
+/**
+ * Works on pending tasks until all tasks of the group are finished, sleeps while its remaining tasks run on other threads.
+ * Rethrows the first exception that was thrown by a task of the group.
+ *
+ * @param group     the group to wait for
+ */
+void ThreadPool::wait(TaskGroup& group)
+{
+    int i = index();
+    Task task;
+    while (group.pending>0) {
+        if (pop(i, task)) {
+            execute(task);
+        } else { // the remaining tasks run on other threads: sleep until they are finished, or new tasks are queued
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleep.wait_for(lock, std::chrono::milliseconds(10), [this, &group] { return group.pending==0 || queued>0; });
+        }
+    }
+    if (group.error) {
+        std::exception_ptr e = group.error;
+        group.error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+/**
+ * @return the queue index of the calling thread
+ */
+int ThreadPool::index() const
+{
+    return (owner==this) ? ownerIndex : 0;
+}
+
+/**
+ * Takes the newest task of queue @param i, or steals the oldest task of another queue
+ *
+ * @param i         queue index of the calling thread
+ * @param task      the task (output)
+ * @return          true, if a task was found
+ */
+bool ThreadPool::pop(int i, Task& task)
+{
+    if (queued==0) {
+        return false;
+    }
+    {
+        Queue& q = *queues[i];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    int n = queues.size();
+    for (int j = 1; j < n; j++) {
+        Queue& q = *queues[(i+j)%n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Runs the task, stores exceptions in the task group, and decreases the number of pending tasks
+ */
+void ThreadPool::execute(Task& task)
+{
+    try {
+        task.f();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(task.group->mutex);
+        if (!task.group->error) {
+            task.group->error = std::current_exception();
+        }
+    }
+    if (--task.group->pending==0) { // wakes the threads waiting for the group
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        sleep.notify_all();
+    }
+}
+
+/**
+ * Main loop of worker @param i
+ */
+void ThreadPool::work(int i)
+{
+    owner = this;
+    ownerIndex = i;
+    Task task;
+    while (true) {
+        if (pop(i, task)) {
+            execute(task);
+        } else {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            if (done) {
+                return;
+            }
+            sleep.wait_for(lock, std::chrono::milliseconds(10), [this] { return done || queued>0; });
+        }
+    }
+}
+
+} // namespace CPlantBox
@@ -0,0 +1,83 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+namespace CPlantBox {
+
+/**
+ * ThreadPool
+ *
+ * Minimal work stealing thread pool. Every worker owns a task queue, it takes tasks from the back of its own queue,
+ * and steals from the front of the other queues, when its queue is empty.
+ *
+ * Tasks are collected in a TaskGroup, ThreadPool::wait blocks until all tasks of the group are finished.
+ * Waiting threads work on pending tasks meanwhile, therefore tasks may submit and wait for tasks themselves (nested parallelism).
+ */
+class ThreadPool
+{
+public:
+
+    /**
+     * Collection of tasks, that can be waited for
+     */
+    class TaskGroup
+    {
+    public:
+        TaskGroup(): pending(0) { }
+    protected:
+        friend class ThreadPool;
+        std::atomic<int> pending; ///< number of unfinished tasks
+        std::exception_ptr error; ///< first exception thrown by a task
+        std::mutex mutex; ///< protects error
+    };
+
+    ThreadPool(int n); ///< starts @param n worker threads (n = 0 is valid, tasks are then executed by the waiting thread)
+    virtual ~ThreadPool(); ///< joins the worker threads
+
+    int getNumberOfWorkers() const { return workers.size(); } ///< number of worker threads
+
+    void run(TaskGroup& group, std::function<void()> task); ///< submits a task to the group
+    void wait(TaskGroup& group); ///< executes tasks until all tasks of the group are finished, rethrows the first exception of a task
+
+protected:
+
+    struct Task {
+        std::function<void()> f;
+        TaskGroup* group;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    int index() const; ///< queue index of the calling thread (0 for threads not owned by the pool)
+    bool pop(int i, Task& task); ///< takes a task from queue i, or steals one from another queue
+    void execute(Task& task); ///< runs the task and notifies its group
+    void work(int i); ///< worker thread main loop
+
+    std::vector<std::unique_ptr<Queue>> queues; ///< queues[0] is used by external threads, queues[i] by worker i
+    std::vector<std::thread> workers;
+    std::atomic<int> queued; ///< number of queued tasks
+    std::atomic<bool> done;
+    std::mutex sleepMutex;
+    std::condition_variable sleep; ///< idle workers wait here
+
+    static thread_local const ThreadPool* owner; ///< pool owning the calling thread
+    static thread_local int ownerIndex; ///< queue index of the calling thread within its owner
+
+};
+
+} // namespace CPlantBox
+
+#endif
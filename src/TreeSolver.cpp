@@ -0,0 +1,166 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "TreeSolver.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace CPlantBox {
+
+/**
+ * Builds the elimination order of the graph given by @param segments (breadth first from the roots, reversed)
+ *
+ * @param segments  segments (parent node, child node)
+ * @param N         number of nodes
+ * @return          false, if the graph is not a forest (a node with two parents, or a cycle), the solver is then empty
+ */
+bool TreeSolver::analyze(const std::vector<Vector2i>& segments, int N)
+{
+    segs.clear();
+    order.clear();
+    parent = std::vector<int>(N, -1);
+    parentSeg = std::vector<int>(N, -1);
+    std::vector<int> nc(N+1, 0); // number of children, then offsets (CSR)
+    for (int s = 0; s<segments.size(); s++) {
+        int p = segments[s].x;
+        int c = segments[s].y;
+        if ((p<0) || (p>=N) || (c<0) || (c>=N) || (p==c) || (parent[c]>=0)) {
+            parent.clear();
+            parentSeg.clear();
+            return false;
+        }
+        parent[c] = p;
+        parentSeg[c] = s;
+        nc[p+1]++;
+    }
+    for (int i = 0; i<N; i++) {
+        nc[i+1] += nc[i];
+    }
+    std::vector<int> children(segments.size());
+    std::vector<int> next(nc.begin(), nc.end()-1);
+    for (int c = 0; c<N; c++) {
+        if (parent[c]>=0) {
+            children[next[parent[c]]++] = c;
+        }
+    }
+    order.reserve(N);
+    for (int i = 0; i<N; i++) { // roots first
+        if (parent[i]<0) {
+            order.push_back(i);
+        }
+    }
+    for (size_t k = 0; k<order.size(); k++) { // breadth first
+        int i = order[k];
+        for (int j = nc[i]; j<nc[i+1]; j++) {
+            order.push_back(children[j]);
+        }
+    }
+    if (order.size()!=N) { // cycle
+        order.clear();
+        parent.clear();
+        parentSeg.clear();
+        return false;
+    }
+    std::reverse(order.begin(), order.end()); // children before parents
+    segs = segments;
+    return true;
+}
+
+/**
+ * @return true, if the elimination order was built for the graph given by @param segments and @param N nodes
+ */
+bool TreeSolver::isAnalyzed(const std::vector<Vector2i>& segments, int N) const
+{
+    if ((N!=parent.size()) || (segments.size()!=segs.size())) {
+        return false;
+    }
+    for (size_t s = 0; s<segs.size(); s++) {
+        if ((segs[s].x!=segments[s].x) || (segs[s].y!=segments[s].y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Numerical factorization, eliminates the nodes from the tips to the roots
+ *
+ * @param diag      diagonal entry per node
+ * @param lower     per segment, the entry in the row of the parent node (column of the child node)
+ * @param upper     per segment, the entry in the row of the child node (column of the parent node)
+ */
+void TreeSolver::factorize(std::vector<double> diag, const std::vector<double>& lower, const std::vector<double>& upper)
+{
+    int N = parent.size();
+    if ((diag.size()!=N) || (lower.size()!=segs.size()) || (upper.size()!=segs.size())) {
+        throw std::invalid_argument("TreeSolver::factorize: sizes do not match the analyzed graph");
+    }
+    d = std::move(diag);
+    m = std::vector<double>(N, 0.);
+    u = std::vector<double>(N, 0.);
+    for (int c : order) {
+        if (d[c]==0.) {
+            throw std::runtime_error("TreeSolver::factorize: zero pivot at node " + std::to_string(c));
+        }
+        int s = parentSeg[c];
+        if (s>=0) {
+            u[c] = upper[s];
+            m[c] = lower[s]/d[c];
+            d[parent[c]] -= m[c]*u[c];
+        }
+    }
+}
+
+/**
+ * Solves the factorized system in place for @param nrhs right hand sides
+ *
+ * @param b         right hand sides (N x nrhs, row major), overwritten by the solutions
+ * @param nrhs      number of right hand sides
+ */
+void TreeSolver::solve(double* b, int nrhs) const
+{
+    for (int c : order) { // forward elimination, tips to roots
+        int p = parent[c];
+        if (p>=0) {
+            const double mc = m[c];
+            const double* bc = b + (size_t)c*nrhs;
+            double* bp = b + (size_t)p*nrhs;
+            for (int r = 0; r<nrhs; r++) {
+                bp[r] -= mc*bc[r];
+            }
+        }
+    }
+    for (auto it = order.rbegin(); it!=order.rend(); ++it) { // back substitution, roots to tips
+        int c = *it;
+        int p = parent[c];
+        const double id = 1./d[c];
+        double* bc = b + (size_t)c*nrhs;
+        if (p>=0) {
+            const double uc = u[c];
+            const double* bp = b + (size_t)p*nrhs;
+            for (int r = 0; r<nrhs; r++) {
+                bc[r] = (bc[r] - uc*bp[r])*id;
+            }
+        } else {
+            for (int r = 0; r<nrhs; r++) {
+                bc[r] *= id;
+            }
+        }
+    }
+}
+
+/**
+ * Solves the factorized system for a single right hand side @param b
+ *
+ * @return the solution
+ */
+std::vector<double> TreeSolver::solve(std::vector<double> b) const
+{
+    if (b.size()!=parent.size()) {
+        throw std::invalid_argument("TreeSolver::solve: size of the right hand side does not match the analyzed graph");
+    }
+    solve(b.data(), 1);
+    return b;
+}
+
+} // namespace CPlantBox
@@ -0,0 +1,50 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef TREESOLVER_H_
+#define TREESOLVER_H_
+
+#include "mymath.h"
+
+#include <vector>
+
+namespace CPlantBox {
+
+/**
+ * TreeSolver
+ *
+ * Direct solver for linear systems, whose graph is a tree (or a forest), e.g. the xylem system of XylemFlux.
+ * Each segment (x, y) couples the parent node x and the child node y, every node has at most one parent segment.
+ *
+ * The nodes are eliminated from the tips to the roots of the trees (no fill in), factorization and solve are O(N).
+ * The right hand sides of a solve are stored node by node (N x nrhs, row major), the inner loops run over the
+ * right hand sides, and are vectorized by the compiler.
+ */
+class TreeSolver
+{
+public:
+
+    TreeSolver() { }
+
+    bool analyze(const std::vector<Vector2i>& segments, int N); ///< elimination order for the graph, false if it is not a forest
+    bool isAnalyzed(const std::vector<Vector2i>& segments, int N) const; ///< true, if the elimination order was built for these segments
+    int getNumberOfNodes() const { return parent.size(); } ///< number of nodes of the analyzed graph
+
+    void factorize(std::vector<double> diag, const std::vector<double>& lower, const std::vector<double>& upper); ///< numerical factorization
+    void solve(double* b, int nrhs = 1) const; ///< solves in place, b has N x nrhs entries (row major)
+    std::vector<double> solve(std::vector<double> b) const; ///< solves for a single right hand side
+
+protected:
+
+    std::vector<Vector2i> segs; ///< segments the elimination order was built for
+    std::vector<int> order; ///< nodes in elimination order (children before their parents)
+    std::vector<int> parent; ///< parent node per node (-1 for roots)
+    std::vector<int> parentSeg; ///< index of the parent segment per node (-1 for roots)
+
+    std::vector<double> d; ///< diagonal after elimination
+    std::vector<double> m; ///< elimination multiplier per node (lower / d)
+    std::vector<double> u; ///< coupling of the node to its parent (upper)
+
+};
+
+} // namespace CPlantBox
+
+#endif
@@ -21,29 +21,38 @@ XylemFlux::XylemFlux(std::shared_ptr<CPlantBox::MappedSegments> rs): rs(rs){}
  * @param cells 			sx per cell (true), or segments (false)
  * @param soil_k [day-1]    optionally, soil conductivities can be prescribed per segment,
  *                          conductivity at the root surface will be limited by the value, i.e. kr = min(kr_root, k_soil)
-* @param withEigen			use Eigen solve (true), ot not (false = default). == True when called by @see Photosynthesis::linearSystemSolve
+* @param withEigen			fill tripletList and b for an Eigen matrix (true) instead of aI, aJ and aV (false = default)
  */
 void XylemFlux::linearSystem(double simTime, const std::vector<double>& sx, bool cells, const std::vector<double> soil_k, bool withEigen)
 {
     int Ns = rs->segments.size(); // number of segments
+    int N = rs->nodes.size(); // number of nodes
+    bool newPattern = (aI.size()!=4*Ns) || (aJ.size()!=4*Ns) || (aB.size()!=N) || withEigen; // otherwise, aI and aJ are compared while they are assembled
     aI.resize(4*Ns);
     aJ.resize(4*Ns);
     aV.resize(4*Ns);
-    int N = rs->nodes.size(); // number of nodes
     aB.resize(N);
     std::fill(aB.begin(), aB.end(), 0.);
     std::fill(aV.begin(), aV.end(), 0.);
-    std::fill(aI.begin(), aI.end(), 0);
-    std::fill(aJ.begin(), aJ.end(), 0);
+    if (withEigen) {
+        std::fill(aI.begin(), aI.end(), 0);
+        std::fill(aJ.begin(), aJ.end(), 0);
+    }
+    auto setIJ = [&](size_t k, int i, int j) {
+        newPattern = newPattern || (aI[k]!=i) || (aJ[k]!=j);
+        aI[k] = i;
+        aJ[k] = j;
+    };
     size_t k=0;
-    size_t numleaf = 0;
+    std::vector<double> segKr, segKx;
+    conductivities(simTime, segKr, segKx);
 	
 	typedef Eigen::Triplet<double> Tri;
 	tripletList.clear();
-	tripletList.reserve(Ns*4);
-	b = Eigen::VectorXd(N);
-	Eigen::SparseMatrix<double> mat(N,N);
-	mat.reserve(Eigen::VectorXi::Constant(N,2));
+	if (withEigen) {
+		tripletList.reserve(Ns*4);
+		b = Eigen::VectorXd(N);
+	}
 	
     for (int si = 0; si<Ns; si++) {
 
@@ -53,7 +62,7 @@ void XylemFlux::linearSystem(double simTime, const std::vector<double>& sx, bool
         double psi_s;
         int organType = rs->organTypes[si];
         if (cells) { // soil matric potential given per cell
-            int cellIndex = rs->seg2cell[si];
+            int cellIndex = rs->getCellIndex(si);
             if (cellIndex>=0) {
 				if(organType == Organism::ot_leaf){
 					std::cout<<"XylemFlux::linearSystem: Leaf segment n#"<<si<<" below ground. OrganType: ";
@@ -76,18 +85,8 @@ void XylemFlux::linearSystem(double simTime, const std::vector<double>& sx, bool
             psi_s = sx.at(si); // j-1 = segIdx = s.y-1
         }
         double a = rs->radii[si]; // si is correct, with ordered and unordered segmetns
-        double age = simTime - rs->nodeCTs[j];
-        int subType = rs->subTypes[si];
-        double kx = 0.;
-        double  kr = 0.;
-
-        try {
-            kx = kx_f(si, age, subType, organType);
-            kr = kr_f(si, age, subType, organType, numleaf);
-        } catch(...) {
-            std::cout << "\n XylemFlux::linearSystem: conductivities failed" << std::flush;
-            std::cout  << "\n organ type "<<organType<< " subtype " << subType <<std::flush;
-        }
+        double kx = segKx[si];
+        double  kr = segKr[si];
         if (soil_k.size()>0) {
             kr = std::min(kr, soil_k[si]);
         }
@@ -106,7 +105,6 @@ void XylemFlux::linearSystem(double simTime, const std::vector<double>& sx, bool
 			// "*2" => C3 plant has stomatas on both sides.
 			//later make it as option to have C4, i.e., stomatas on one side
 			perimeter = rs->leafBladeSurface[si] / l *2;
-            numleaf +=1;
         }else{perimeter = 2 * M_PI * a;}
         double vz = v.z / l; // normed direction
 
@@ -132,13 +130,13 @@ void XylemFlux::linearSystem(double simTime, const std::vector<double>& sx, bool
 			b(i) = aB[i];
 			tripletList.push_back(Tri(i,i,cii));
 		}else{
-			aI[k] = i; aJ[k]= i; aV[k] = cii;
+			setIJ(k, i, i); aV[k] = cii;
 		}
         k += 1;
 		
 		if(withEigen){ tripletList.push_back(Tri(i,j,cij));
 		}else{		
-			aI[k] = i; aJ[k] = j;  aV[k] = cij;
+			setIJ(k, i, j); aV[k] = cij;
 		}
         k += 1;
 
@@ -150,16 +148,19 @@ void XylemFlux::linearSystem(double simTime, const std::vector<double>& sx, bool
 			b(i) = aB[i];
 			tripletList.push_back(Tri(i,i,cii));
 		}else{
-			aI[k] = i; aJ[k]= i; aV[k] = cii;
+			setIJ(k, i, i); aV[k] = cii;
 		}
         k += 1;
 		
 		if(withEigen){ tripletList.push_back(Tri(i,j,cij));
 		}else{
-			aI[k] = i; aJ[k] = j;  aV[k] = cij;
+			setIJ(k, i, j); aV[k] = cij;
 		}
         k += 1;
     }
+    if (newPattern) {
+        topology++;
+    }
 }
 
 
@@ -198,7 +199,8 @@ std::vector<double> XylemFlux::segFluxes(double simTime, const std::vector<doubl
     bool approx, bool cells, const std::vector<double> soil_k)
 {
     std::vector<double> fluxes = std::vector<double>(rs->segments.size());
-    size_t numleaf = 0;
+    std::vector<double> segKr, segKx;
+    conductivities(simTime, segKr, segKx);
     for (int si = 0; si<rs->segments.size(); si++) {
 
         int i = rs->segments[si].x;
@@ -207,7 +209,7 @@ std::vector<double> XylemFlux::segFluxes(double simTime, const std::vector<doubl
 
         double psi_s;
         if (cells) { // soil matric potential given per cell
-            int cellIndex = rs->seg2cell[si];
+            int cellIndex = rs->getCellIndex(si);
             if (cellIndex>=0) {
 				if(organType ==Organism::ot_leaf){ //add a runtime error?
 					std::cout<<"XylemFlux::linearSystem: Leaf segment n#"<<si<<" below ground. OrganType: ";
@@ -232,18 +234,10 @@ std::vector<double> XylemFlux::segFluxes(double simTime, const std::vector<doubl
 
 
         double a = rs->radii[si]; // si is correct, with ordered and unordered segments
-        double age = simTime - rs->nodeCTs[j];
         int subType = rs->subTypes[si];
 
-        double kx = 0.;
-        double kr = 0.;
-        try {
-            kx = kx_f(si, age, subType, organType);
-            kr = kr_f(si, age, subType, organType, numleaf);
-        } catch(...) {
-            std::cout << "\n XylemFlux::segFluxes: conductivities failed" << std::flush;
-            std::cout  << "\n organ type "<<organType<< " subtype " << subType <<std::flush;
-        }
+        double kx = segKx[si];
+        double kr = segKr[si];
         if (soil_k.size()>0) {
             kr = std::min(kr, soil_k[si]);
         }
@@ -262,7 +256,6 @@ std::vector<double> XylemFlux::segFluxes(double simTime, const std::vector<doubl
 			// "*2" => C3 plant has stomatas on both sides.
 			//later make it as option to have C4, i.e., stomatas on one side
 			perimeter = rs->leafBladeSurface[si] / l *2;
-            numleaf +=1;
         }else{perimeter = 2 * M_PI * a;} //cylinder shape
 
         if (perimeter * kr>1.e-16) { // only relevant for exact solution
@@ -300,14 +293,12 @@ std::map<int,double> XylemFlux::sumSegFluxes(const std::vector<double>& segFluxe
     for (int si = 0; si<rs->segments.size(); si++) {
         int j = rs->segments[si].y;
         int segIdx = j-1;
-        if (rs->seg2cell.count(segIdx)>0) {
-            int cellIdx = rs->seg2cell[segIdx];
-            if (cellIdx>=0) {
-                if (fluxes.count(cellIdx)==0) {
-                    fluxes[cellIdx] = segFluxes[segIdx];
-                } else {
-                    fluxes[cellIdx] = fluxes[cellIdx] + segFluxes[segIdx]; // sum up fluxes per cell
-                }
+        int cellIdx = rs->getCellIndex(segIdx);
+        if (cellIdx>=0) {
+            if (fluxes.count(cellIdx)==0) {
+                fluxes[cellIdx] = segFluxes[segIdx];
+            } else {
+                fluxes[cellIdx] = fluxes[cellIdx] + segFluxes[segIdx]; // sum up fluxes per cell
             }
         }
     }
@@ -319,17 +310,26 @@ std::map<int,double> XylemFlux::sumSegFluxes(const std::vector<double>& segFluxe
  *
  * @param soilFluxes 	cell fluxes per global index [cm3/day]
  * @param type 			split flux proportional to 0: segment volume, 1: segment surface, 2: segment length
- * @return fluxes for each segment [cm3/day]
+ * @return fluxes for each segment [cm3/day], segments that are not mapped get 0
+ * @throws std::out_of_range if a segment is mapped to cell -1 (not within the soil domain)
  */
 std::vector<double> XylemFlux::splitSoilFluxes(const std::vector<double>& soilFluxes, int type) const
 {
     auto lengths =  this->rs->segLength();
     std::vector<double> fluxes = std::vector<double>(rs->segments.size());
     std::fill(fluxes.begin(), fluxes.end(), 0.);
-    auto map = rs->cell2seg;
-    for(auto iter = map.begin(); iter != map.end(); ++iter) {
-        int cellId =  iter->first;
-        auto segs = map.at(cellId);
+    for (int si = 0; si<rs->seg2cell.size(); si++) {
+        if (rs->seg2cell[si]==-1) {
+            throw std::out_of_range("XylemFlux::splitSoilFluxes: segment "+std::to_string(si)+" is not within the soil domain (cell index -1)");
+        }
+    }
+    const auto& offsets = rs->getCell2SegOffsets();
+    const auto& indices = rs->getCell2SegIndices();
+    for (int cellId = 0; cellId<int(offsets.size())-1; cellId++) {
+        if (offsets[cellId+1]==offsets[cellId]) {
+            continue;
+        }
+        auto segs = std::vector<int>(indices.begin()+offsets[cellId], indices.begin()+offsets[cellId+1]);
         double v = 0.;  // calculate sum over cell
         for (int i : segs) {
             if (type==0) { // volume
@@ -355,6 +355,352 @@ std::vector<double> XylemFlux::splitSoilFluxes(const std::vector<double>& soilFl
     return fluxes;
 }
 
+/**
+ * Solves the flux equations with a Neumann boundary condition (see xylem_flux.py, XylemFluxPython.solve_neumann)
+ *
+ * @param simTime [day]     needed for age dependent conductivities (age = sim_time - segment creation time)
+ * @param value [cm3 day-1] flux per node in neumann_ind (transpiration is negative); a single value is split equally
+ * @param sx [cm]           soil matric potentials given per segment or per soil cell
+ * @param cells             indicates if the matric potentials are given per cell (True) or by segments (False)
+ * @param soil_k [day-1]    optionally, soil conductivities can be prescribed per segment,
+ *                          conductivity at the root surface will be limited by the value, i.e. kr = min(kr_root, k_soil)
+ * @return [cm] root xylem pressure per node
+ */
+std::vector<double> XylemFlux::solveNeumann(double simTime, std::vector<double> value, const std::vector<double>& sx, bool cells,
+    const std::vector<double> soil_k)
+{
+    if ((value.size()==1) && (neumann_ind.size()>1)) {
+        value = std::vector<double>(neumann_ind.size(), value[0]/neumann_ind.size());
+    }
+    linearSystem(simTime, sx, cells, soil_k);
+    return solveLinearSystem(neumann_ind, value, false);
+}
+
+/**
+ * Solves the flux equations with a Dirichlet boundary condition (see xylem_flux.py, XylemFluxPython.solve_dirichlet)
+ *
+ * @param simTime [day]     needed for age dependent conductivities (age = sim_time - segment creation time)
+ * @param value [cm]        pressure head per node in dirichlet_ind; a single value is used for all nodes
+ * @param sx [cm]           soil matric potentials given per segment or per soil cell
+ * @param cells             indicates if the matric potentials are given per cell (True) or by segments (False)
+ * @param soil_k [day-1]    optionally, soil conductivities can be prescribed per segment,
+ *                          conductivity at the root surface will be limited by the value, i.e. kr = min(kr_root, k_soil)
+ * @return [cm] root xylem pressure per node
+ */
+std::vector<double> XylemFlux::solveDirichlet(double simTime, std::vector<double> value, const std::vector<double>& sx, bool cells,
+    const std::vector<double> soil_k)
+{
+    if ((value.size()==1) && (dirichlet_ind.size()>1)) {
+        value = std::vector<double>(dirichlet_ind.size(), value[0]);
+    }
+    linearSystem(simTime, sx, cells, soil_k);
+    return solveLinearSystem(dirichlet_ind, value, true);
+}
+
+/**
+ * Solves the flux equations using Neumann and switching to Dirichlet in case the wilting point is reached in root collar
+ * (see xylem_flux.py, XylemFluxPython.solve). The Dirichlet boundary condition is applied at node 0.
+ *
+ * @param simTime [day]     needed for age dependent conductivities (age = sim_time - segment creation time)
+ * @param trans [cm3 day-1] transpiration rate per node in neumann_ind (negative); a single value is split equally
+ * @param sx [cm]           soil matric potential around root collar, if it is below the wilting point,
+ *                          dirichlet boundary conditions are assumed. Set sx = 0 to disable this behaviour.
+ * @param sxx [cm]          soil matric potentials given per segment or per soil cell
+ * @param cells             indicates if the matric potentials are given per cell (True) or by segments (False)
+ * @param wiltingPoint [cm] the plant wilting point
+ * @param soil_k [day-1]    optionally, soil conductivities can be prescribed per segment,
+ *                          conductivity at the root surface will be limited by the value, i.e. kr = min(kr_root, k_soil)
+ * @return [cm] root xylem pressure per node
+ */
+std::vector<double> XylemFlux::solve(double simTime, std::vector<double> trans, double sx, const std::vector<double>& sxx, bool cells,
+    double wiltingPoint, const std::vector<double> soil_k)
+{
+    double eps = 1;
+    std::vector<double> x;
+    if (sx >= wiltingPoint - eps) {
+        x = solveNeumann(simTime, trans, sxx, cells, soil_k); // try neumann, if below wilting point, switch to Dirichlet
+        last = "neumann";
+        if (x.at(0) <= wiltingPoint) {
+            x = solveLinearSystem({ 0 }, { wiltingPoint }, true); // system is already assembled
+            last = "dirichlet";
+        }
+    } else {
+        std::cout << "XylemFlux::solve: used Dirichlet because collar cell soil matric potential is below wilting point " << sx << "\n";
+        x = solveDirichlet(simTime, { wiltingPoint }, sxx, cells, soil_k);
+        last = "dirichlet";
+    }
+    return x;
+}
+
+/**
+ * Solves the linear system assembled by XylemFlux::linearSystem (aI, aJ, aV, aB) with boundary conditions.
+ *
+ * If the segments form a tree (or a forest), the system is solved by TreeSolver in O(N).
+ * Otherwise, a sparse LU factorization is used: the sparsity pattern and its symbolic factorization are kept until the segments change,
+ * the numerical factorization is kept until the matrix values (i.e. conductivities, ages, or boundary condition type) change.
+ * Nodes that are not part of any segment get the value 0.
+ *
+ * @param ind           node indices of the boundary condition
+ * @param value         fluxes [cm3 day-1] (Neumann), or pressure heads [cm] (Dirichlet) per node index
+ * @param dirichlet     Dirichlet (true), or Neumann (false) boundary condition
+ * @return [cm] root xylem pressure per node
+ */
+std::vector<double> XylemFlux::solveLinearSystem(const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet)
+{
+    std::vector<double> x = aB;
+    solveAssembled(ind, value, dirichlet, x.data(), 1);
+    return x;
+}
+
+/**
+ * Solves the flux equations for several soil states with a Neumann boundary condition, the conductivities are evaluated,
+ * and the system is factorized once for all soil states (once per soil conductivity, if they are given per soil state).
+ *
+ * @param simTime [day]     needed for age dependent conductivities (age = sim_time - segment creation time)
+ * @param value [cm3 day-1] tranpirational flux per node in neumann_ind (negative); a single value is split equally
+ * @param sxx [cm]          soil matric potentials per soil state, given per segment or per soil cell
+ * @param cells             indicates if the matric potentials are given per cell (True) or by segments (False)
+ * @param soil_k [day-1]    optionally, soil conductivities per segment, for all soil states (one vector), or per soil state
+ * @return [cm] root xylem pressure per node, for each soil state
+ */
+std::vector<std::vector<double>> XylemFlux::solveNeumannBatch(double simTime, std::vector<double> value,
+    const std::vector<std::vector<double>>& sxx, bool cells, const std::vector<std::vector<double>>& soil_k)
+{
+    if ((value.size()==1) && (neumann_ind.size()>1)) {
+        value = std::vector<double>(neumann_ind.size(), value[0]/neumann_ind.size());
+    }
+    return solveBatch(simTime, sxx, cells, soil_k, neumann_ind, value, false);
+}
+
+/**
+ * Solves the flux equations for several soil states with a Dirichlet boundary condition (see XylemFlux::solveNeumannBatch)
+ *
+ * @param simTime [day]     needed for age dependent conductivities (age = sim_time - segment creation time)
+ * @param value [cm]        pressure head per node in dirichlet_ind; a single value is used for all nodes
+ * @param sxx [cm]          soil matric potentials per soil state, given per segment or per soil cell
+ * @param cells             indicates if the matric potentials are given per cell (True) or by segments (False)
+ * @param soil_k [day-1]    optionally, soil conductivities per segment, for all soil states (one vector), or per soil state
+ * @return [cm] root xylem pressure per node, for each soil state
+ */
+std::vector<std::vector<double>> XylemFlux::solveDirichletBatch(double simTime, std::vector<double> value,
+    const std::vector<std::vector<double>>& sxx, bool cells, const std::vector<std::vector<double>>& soil_k)
+{
+    if ((value.size()==1) && (dirichlet_ind.size()>1)) {
+        value = std::vector<double>(dirichlet_ind.size(), value[0]);
+    }
+    return solveBatch(simTime, sxx, cells, soil_k, dirichlet_ind, value, true);
+}
+
+/**
+ * Assembles the system without soil matric potentials, adds the soil matric potentials of each soil state to its right hand side,
+ * and solves for all right hand sides at once (consecutive soil states with equal soil conductivities share the factorization)
+ */
+std::vector<std::vector<double>> XylemFlux::solveBatch(double simTime, const std::vector<std::vector<double>>& sxx, bool cells,
+    const std::vector<std::vector<double>>& soil_k, const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet)
+{
+    int n = sxx.size();
+    if ((soil_k.size()>1) && (soil_k.size()!=n)) {
+        throw std::invalid_argument("XylemFlux::solveBatch: soil conductivities must be given for all, or for each soil state");
+    }
+    int Ns = rs->segments.size();
+    std::vector<int> sxIndex(Ns); // index into the soil matric potentials per segment, -1 if it is not given by them (e.g. psi_air)
+    for (int si = 0; si<Ns; si++) {
+        if (cells) {
+            sxIndex[si] = rs->getCellIndex(si);
+        } else {
+            sxIndex[si] = si;
+        }
+    }
+    std::vector<double> noSoil = cells ? std::vector<double>(1, 0.) : std::vector<double>(Ns, 0.);
+    std::vector<std::vector<double>> x(n);
+    int r0 = 0;
+    while (r0<n) {
+        int r1 = n; // soil states [r0, r1) share the soil conductivities
+        std::vector<double> k;
+        if (soil_k.size()==1) {
+            k = soil_k[0];
+        } else if (soil_k.size()>1) {
+            k = soil_k[r0];
+            r1 = r0+1;
+            while ((r1<n) && (soil_k[r1]==k)) {
+                r1++;
+            }
+        }
+        linearSystem(simTime, noSoil, cells, k);
+        int N = aB.size();
+        int nrhs = r1-r0;
+        std::vector<double> b(N*nrhs); // N x nrhs, row major
+        for (int i = 0; i<N; i++) {
+            std::fill(b.begin() + i*nrhs, b.begin() + (i+1)*nrhs, aB[i]);
+        }
+        for (int si = 0; si<Ns; si++) {
+            double c = aV[4*si] + aV[4*si+1]; // cii + cij, see linearSystem
+            if ((c==0.) || (sxIndex[si]<0)) {
+                continue;
+            }
+            double* bi = b.data() + rs->segments[si].x*nrhs;
+            double* bj = b.data() + rs->segments[si].y*nrhs;
+            for (int r = 0; r<nrhs; r++) {
+                const auto& sx = sxx[r0+r];
+                double psi_s = ((cells) && (sx.size()==1)) ? sx[0] : sx.at(sxIndex[si]);
+                bi[r] += c*psi_s;
+                bj[r] += c*psi_s;
+            }
+        }
+        solveAssembled(ind, value, dirichlet, b.data(), nrhs);
+        for (int r = 0; r<nrhs; r++) {
+            x[r0+r].resize(N);
+            for (int i = 0; i<N; i++) {
+                x[r0+r][i] = b[i*nrhs+r];
+            }
+        }
+        r0 = r1;
+    }
+    return x;
+}
+
+/**
+ * Solves the linear system assembled by XylemFlux::linearSystem (aI, aJ, aV) with boundary conditions in place,
+ * for @param nrhs right hand sides given in @param b (N x nrhs, row major), see XylemFlux::solveLinearSystem
+ */
+void XylemFlux::solveAssembled(const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet, double* b, int nrhs)
+{
+    if (ind.size()!=value.size()) {
+        throw std::invalid_argument("XylemFlux::solveLinearSystem: number of node indices and boundary values must be equal");
+    }
+    int N = aB.size();
+    std::vector<bool> isDirichlet(N, false);
+    if (dirichlet) {
+        for (int i : ind) {
+            isDirichlet.at(i) = true;
+        }
+    }
+    int Ns = rs->segments.size();
+    if (treeTopology!=topology) { // the segments changed (@see topology)
+        isTree = treeSolver.analyze(rs->segments, N);
+        treeTopology = topology;
+    }
+    if (useTreeSolver && (aV.size()==4*Ns) && isTree) { // tree, see linearSystem for the triplet order
+        std::vector<double> diag(N, 0.), lower(Ns, 0.), upper(Ns, 0.);
+        std::vector<bool> hasSegment(N, false);
+        for (int si = 0; si<Ns; si++) {
+            int i = rs->segments[si].x;
+            int j = rs->segments[si].y;
+            hasSegment[i] = true;
+            hasSegment[j] = true;
+            if (!isDirichlet[i]) {
+                diag[i] += aV[4*si];
+                lower[si] = aV[4*si+1];
+            }
+            if (!isDirichlet[j]) {
+                diag[j] += aV[4*si+2];
+                upper[si] = aV[4*si+3];
+            }
+        }
+        for (int i = 0; i<N; i++) {
+            if (!hasSegment[i] || isDirichlet[i]) {
+                diag[i] = 1.;
+            }
+        }
+        applyBoundaryConditions(ind, value, dirichlet, hasSegment, isDirichlet, b, nrhs);
+        treeSolver.factorize(diag, lower, upper);
+        treeSolver.solve(b, nrhs);
+        return;
+    }
+    if ((sparseSolver.A.rows()!=N) || (sparseSolver.topology!=topology)) {
+        analyzePattern(N);
+    }
+    double* values = sparseSolver.A.valuePtr();
+    std::fill(values, values + sparseSolver.A.nonZeros(), 0.);
+    for (size_t k = 0; k<aV.size(); k++) {
+        if (!isDirichlet[aI[k]]) {
+            values[sparseSolver.aPos[k]] += aV[k];
+        }
+    }
+    for (int i = 0; i<N; i++) {
+        if (!sparseSolver.hasEntries[i] || isDirichlet[i]) {
+            values[sparseSolver.diagPos[i]] = 1.;
+        }
+    }
+    applyBoundaryConditions(ind, value, dirichlet, sparseSolver.hasEntries, isDirichlet, b, nrhs);
+    if ((sparseSolver.factorizedValues.size()!=sparseSolver.A.nonZeros()) || !std::equal(sparseSolver.factorizedValues.begin(), sparseSolver.factorizedValues.end(), values)) {
+        sparseSolver.lu.factorize(sparseSolver.A);
+        if (sparseSolver.lu.info()!=Eigen::Success) {
+            sparseSolver.factorizedValues.clear();
+            throw std::runtime_error("XylemFlux::solveLinearSystem: factorization failed: " + sparseSolver.lu.lastErrorMessage());
+        }
+        sparseSolver.factorizedValues.assign(values, values + sparseSolver.A.nonZeros());
+    }
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrix;
+    Eigen::Map<RowMatrix> rhs(b, N, nrhs);
+    Eigen::MatrixXd x = sparseSolver.lu.solve(Eigen::MatrixXd(rhs)); // SparseLU needs column major right hand sides
+    rhs = x;
+}
+
+/**
+ * Sets the right hand sides @param b (N x nrhs, row major) of nodes without equations, or with a Dirichlet boundary condition,
+ * and adds the Neumann fluxes
+ */
+void XylemFlux::applyBoundaryConditions(const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet,
+    const std::vector<bool>& hasEntries, const std::vector<bool>& isDirichlet, double* b, int nrhs) const
+{
+    int N = isDirichlet.size();
+    for (int i = 0; i<N; i++) {
+        if (!hasEntries[i] || isDirichlet[i]) {
+            std::fill(b + i*nrhs, b + (i+1)*nrhs, 0.);
+        }
+    }
+    for (size_t c = 0; c<ind.size(); c++) {
+        double* bi = b + ind[c]*nrhs;
+        for (int r = 0; r<nrhs; r++) {
+            if (dirichlet) {
+                bi[r] = value[c];
+            } else {
+                bi[r] += value[c];
+            }
+        }
+    }
+}
+
+/**
+ * Builds the sparsity pattern of the system matrix from the triplet indices aI, aJ (including all diagonal entries),
+ * and computes its symbolic factorization
+ *
+ * @param N         number of nodes
+ */
+void XylemFlux::analyzePattern(int N)
+{
+    std::vector<Eigen::Triplet<double>> pattern;
+    pattern.reserve(aI.size() + N);
+    sparseSolver.hasEntries = std::vector<bool>(N, false);
+    for (size_t k = 0; k<aI.size(); k++) {
+        pattern.push_back(Eigen::Triplet<double>(aI[k], aJ[k], 1.));
+        sparseSolver.hasEntries.at(aI[k]) = true;
+    }
+    for (int i = 0; i<N; i++) {
+        pattern.push_back(Eigen::Triplet<double>(i, i, 1.));
+    }
+    sparseSolver.A = Eigen::SparseMatrix<double>(N, N);
+    sparseSolver.A.setFromTriplets(pattern.begin(), pattern.end());
+    sparseSolver.A.makeCompressed();
+    auto pos = [&](int i, int j) { // position of entry (i,j), row indices are sorted within each column
+        const int* first = sparseSolver.A.innerIndexPtr() + sparseSolver.A.outerIndexPtr()[j];
+        const int* last = sparseSolver.A.innerIndexPtr() + sparseSolver.A.outerIndexPtr()[j+1];
+        return int(std::lower_bound(first, last, i) - sparseSolver.A.innerIndexPtr());
+    };
+    sparseSolver.aPos.resize(aI.size());
+    for (size_t k = 0; k<aI.size(); k++) {
+        sparseSolver.aPos[k] = pos(aI[k], aJ[k]);
+    }
+    sparseSolver.diagPos.resize(N);
+    for (int i = 0; i<N; i++) {
+        sparseSolver.diagPos[i] = pos(i, i);
+    }
+    sparseSolver.lu.analyzePattern(sparseSolver.A);
+    sparseSolver.topology = topology;
+    sparseSolver.factorizedValues.clear();
+}
+
 /**
  *  Sets the radial conductivity in [1 day-1]
  * TODO: make deprecated: in the examples, replace setKr[Kr] by setKr[[Kr]]
@@ -366,15 +712,19 @@ void XylemFlux::setKr(std::vector<double> values, std::vector<double> age) {
     if (age.size()==0) {
         if (values.size()==1) {
             kr_f = std::bind(&XylemFlux::kr_const, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+            krc.type = Conductivity::constant;
             std::cout << "Kr is constant " << values[0] << " 1 day-1 \n";
         } else {
             kr_f  = std::bind(&XylemFlux::kr_perType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+            krc.type = Conductivity::perType;
             std::cout << "Kr is constant per type, type 0 = " << values[0] << " 1 day-1 \n";
         }
     } else {
         kr_f  = std::bind(&XylemFlux::kr_table, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+        krc.type = Conductivity::table;
         std::cout << "Kr is age dependent\n";
     }
+    compileConductivities();
 }
 
 /**
@@ -392,14 +742,17 @@ void XylemFlux::setKr(std::vector<std::vector<double>> values, std::vector<std::
         if (values.size()==1) {
             if (values[0].size()==1) {
                 kr_f = std::bind(&XylemFlux::kr_const, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+                krc.type = Conductivity::constant;
                 std::cout << "Kr is constant " << values[0][0] << " 1 day-1 \n";
             } else {
                 kr_f  = std::bind(&XylemFlux::kr_perType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+                krc.type = Conductivity::perType;
                 std::cout << "Kr is constant per subtype, subtype 0 = " << values[0][0] << " 1 day-1 \n";
             }
         } else {
             if (values[0].size()==1) {
                 kr_f = std::bind(&XylemFlux::kr_perOrgType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+                krc.type = Conductivity::perOrgType;
                 std::cout << "Kr is constant per organ type, organ type 2 (root) = " << values[0][0] << " 1 day-1 \n";
             } else {
 				if(kr_length_ > 0.){
@@ -407,16 +760,20 @@ void XylemFlux::setKr(std::vector<std::vector<double>> values, std::vector<std::
 					rs->kr_length = kr_length_; //in MappedPlant. define distance to root tipe where kr > 0 as cannot compute distance from age in case of carbon-limited growth
 					rs->calcExchangeZoneCoefs();	//computes coefficient used by XylemFlux::kr_RootExchangeZonePerType
 					kr_f  = std::bind(&XylemFlux::kr_RootExchangeZonePerType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+					krc.type = Conductivity::rootExchangeZonePerType;
 				}else{
 					kr_f  = std::bind(&XylemFlux::kr_perType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+					krc.type = Conductivity::perType;
 				}
                 std::cout << "Kr is constant per subtype of organ type, for root, subtype 0 = " << values[0][0] << " 1 day-1 \n";
             }
         }
     } else {
         kr_f  = std::bind(&XylemFlux::kr_table, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+        krc.type = Conductivity::table;
         std::cout << "Kr is equal for all organs and age dependent\n";
     }
+    compileConductivities();
 }
 
 /**
@@ -430,15 +787,19 @@ void XylemFlux::setKx(std::vector<double> values, std::vector<double> age) {
     if (age.size()==0) {
         if (values.size()==1) {
             kx_f = std::bind(&XylemFlux::kx_const, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+            kxc.type = Conductivity::constant;
             std::cout << "Kx is constant " << values[0] << " cm3 day-1 \n";
         } else {
             kx_f  = std::bind(&XylemFlux::kx_perType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+            kxc.type = Conductivity::perType;
             std::cout << "Kx is constant per subtype, subtype 0 = " << values[0] << " cm3 day-1 \n";
         }
     } else {
         kx_f  = std::bind(&XylemFlux::kx_table, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+        kxc.type = Conductivity::table;
         std::cout << "Kx is age dependent\n";
     }
+    compileConductivities();
 }
 
 //either age or type/subtype dependent
@@ -449,24 +810,30 @@ void XylemFlux::setKx(std::vector<std::vector<double>> values, std::vector<std::
         if (values.size()==1) {
             if (values[0].size()==1) {
                 kx_f = std::bind(&XylemFlux::kx_const, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+                kxc.type = Conductivity::constant;
                 std::cout << "Kx is constant " << values[0][0] << " cm3 day-1 \n";
             } else {
                 kx_f  = std::bind(&XylemFlux::kx_perType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+                kxc.type = Conductivity::perType;
                 std::cout << "Kx is constant per subtype, subtype 0 = " << values[0][0] << " cm3 day-1 \n";
             }
         } else {
             if (values[0].size()==1) {
                 kx_f = std::bind(&XylemFlux::kx_perOrgType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+                kxc.type = Conductivity::perOrgType;
                 std::cout << "Kx is constant per organ type, organ type 2 (root) = " << values[0][0] << " cm3 day-1 \n";
             } else {
                 kx_f  = std::bind(&XylemFlux::kx_perType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+                kxc.type = Conductivity::perType;
                 std::cout << "Kx is constant per subtype of organ type, for root, subtype 0 = " << values[0][0] << " cm3 day-1 \n";
             }
         }
     } else {
         kx_f  = std::bind(&XylemFlux::kx_table, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+        kxc.type = Conductivity::table;
         std::cout << "Kx is equal for all organs and age dependent\n";
     }
+    compileConductivities();
 }
 
 /**
@@ -481,7 +848,9 @@ void XylemFlux::setKrTables(std::vector<std::vector<double>> values, std::vector
     krs= { values };
     krs_t = { age };
     kr_f = std::bind(&XylemFlux::kr_tablePerType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+    krc.type = Conductivity::tablePerType;
     std::cout << "Kr is age dependent per root type\n";
+    compileConductivities();
 }
 
 /**
@@ -496,7 +865,9 @@ void XylemFlux::setKxTables(std::vector<std::vector<double>> values, std::vector
     kxs = {values};
     kxs_t = {age};
     kx_f = std::bind(&XylemFlux::kx_tablePerType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+    kxc.type = Conductivity::tablePerType;
     std::cout << "Kx is age dependent per root type\n";
+    compileConductivities();
 }
 
 /**
@@ -510,12 +881,15 @@ void XylemFlux::setKrTables(std::vector<std::vector<std::vector<double>>> values
     krs_t = age;
     if (age[0].size()==1) {
         kr_f = std::bind(&XylemFlux::kr_tablePerOrgType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+        krc.type = Conductivity::tablePerOrgType;
         std::cout << "Kr is age dependent per organ type\n";
     }
     else{
         kr_f = std::bind(&XylemFlux::kr_tablePerType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+        krc.type = Conductivity::tablePerType;
         std::cout << "Kr is age dependent per organ type and sub type\n";
     }
+    compileConductivities();
 }
 
 /**
@@ -529,12 +903,15 @@ void XylemFlux::setKxTables(std::vector<std::vector<std::vector<double>>> values
     kxs_t = age;
     if (age[0].size()==1) {
         kx_f = std::bind(&XylemFlux::kx_tablePerOrgType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+        kxc.type = Conductivity::tablePerOrgType;
         std::cout << "Kx is age dependent per organ type\n";
     }
     else {
         kx_f = std::bind(&XylemFlux::kx_tablePerType, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+        kxc.type = Conductivity::tablePerType;
         std::cout << "Kx is age dependent per organ type and sub type\n";
     }
+    compileConductivities();
 }
 
 /**
@@ -546,7 +923,9 @@ void XylemFlux::setKrValues(std::vector<double> values) {
     kr_t.clear();
     kr.push_back(values);
     kr_f = std::bind(&XylemFlux::kr_valuePerSegment, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+    krc.type = Conductivity::valuePerSegment;
     std::cout << "Kr is given per segment\n";
+    compileConductivities();
 }
 
 /**
@@ -558,7 +937,174 @@ void XylemFlux::setKxValues(std::vector<double> values) {
     kx_t.clear();
     kx.push_back(values);
     kx_f = std::bind(&XylemFlux::kx_valuePerSegment, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+    kxc.type = Conductivity::valuePerSegment;
     std::cout << "Kx is given per segment\n";
+    compileConductivities();
+}
+
+/**
+ * Compiles the tables of the conductivities set by setKr, setKx, setKrTables, setKxTables (called by the setters)
+ */
+void XylemFlux::compileConductivities()
+{
+    compileConductivity(krc, kr, kr_t, krs, krs_t);
+    compileConductivity(kxc, kx, kx_t, kxs, kxs_t);
+}
+
+/**
+ * Compiles the conductivity c of type c.type from values and ages (kr, kr_t), or from the tables (krs, krs_t).
+ * Entries that are missing, or have inconsistent sizes, stay empty (these segments are evaluated by the callback).
+ */
+void XylemFlux::compileConductivity(Conductivity& c, const std::vector<std::vector<double>>& values, const std::vector<std::vector<double>>& age,
+    const std::vector<std::vector<std::vector<double>>>& tables, const std::vector<std::vector<std::vector<double>>>& tablesAge)
+{
+    c.tables.clear();
+    if ((c.type==Conductivity::callback) || (c.type==Conductivity::valuePerSegment)) {
+        return;
+    }
+    bool fromTables = (c.type==Conductivity::tablePerOrgType) || (c.type==Conductivity::tablePerType);
+    c.byOrgType = (c.type!=Conductivity::constant) && (c.type!=Conductivity::table);
+    c.bySubType = (c.type==Conductivity::perType) || (c.type==Conductivity::tablePerType) || (c.type==Conductivity::rootExchangeZonePerType);
+    size_t rows = fromTables ? tables.size() : values.size();
+    if (!c.byOrgType) {
+        rows = std::min(rows, size_t(1));
+    }
+    c.tables.resize(rows);
+    for (size_t i = 0; i<rows; i++) {
+        size_t cols = fromTables ? tables[i].size() : values[i].size();
+        if ((!c.bySubType) || (c.type==Conductivity::table)) {
+            cols = std::min(cols, size_t(1));
+        }
+        c.tables[i].resize(cols);
+        for (size_t j = 0; j<cols; j++) {
+            if (fromTables) {
+                if ((i<tablesAge.size()) && (j<tablesAge[i].size())) {
+                    c.tables[i][j].set(tablesAge[i][j], tables[i][j]);
+                }
+            } else if (c.type==Conductivity::table) {
+                if (i<age.size()) {
+                    c.tables[i][j].set(age[i], values[i]);
+                }
+            } else {
+                c.tables[i][j].set(std::vector<double>(), { values[i][j] });
+            }
+        }
+    }
+}
+
+/**
+ * Sets the table, y must have the size of x, or a single value if x is empty (a constant).
+ * Otherwise the table stays empty.
+ */
+void XylemFlux::AgeTable::set(const std::vector<double>& x_, const std::vector<double>& y_)
+{
+    x.clear();
+    y.clear();
+    start.clear();
+    scale = 0.;
+    if ((x_.size()!=y_.size()) && !(x_.empty() && (y_.size()==1))) {
+        return;
+    }
+    x = x_;
+    y = y_;
+    if ((x.size()>1) && (x.back()>x[0])) {
+        int n = 4*x.size(); // grid cells
+        scale = n/(x.back() - x[0]);
+        start.resize(n);
+        for (int k = 0; k<n; k++) {
+            int i = std::lower_bound(x.begin(), x.end(), x[0] + k/scale) - x.begin();
+            start[k] = std::max(std::min(i, int(x.size()) - 1), 1);
+        }
+    }
+}
+
+/**
+ * Table for a segment of organ type and sub type, nullptr if there is no (valid) table
+ */
+const XylemFlux::AgeTable* XylemFlux::Conductivity::find(int organType, int subType) const
+{
+    int i = byOrgType ? organType - 2 : 0;
+    int j = bySubType ? subType : 0;
+    if ((i>=0) && (i<int(tables.size())) && (j>=0) && (j<int(tables[i].size())) && !tables[i][j].y.empty()) {
+        return &tables[i][j];
+    }
+    return nullptr;
+}
+
+/**
+ * Radial and axial conductivities of all segments, same as kr_f and kx_f, but evaluated with the tables
+ * compiled by the setters (@see compileConductivities). Segments that are not covered by the tables
+ * (and all segments, if kr_f or kx_f were set otherwise) are evaluated by the callbacks.
+ *
+ * @param simTime [day]     current simulation time, to calculate the ages (age = sim_time - segment creation time)
+ * @param segKr [1 day-1]   radial conductivity per segment, including the stomatal conductance of leaf segments (@see k_stomatas)
+ * @param segKx [cm3 day-1] axial conductivity per segment
+ */
+void XylemFlux::conductivities(double simTime, std::vector<double>& segKr, std::vector<double>& segKx)
+{
+    int Ns = rs->segments.size();
+    segKr.resize(Ns);
+    segKx.resize(Ns);
+    size_t numleaf = 0;
+    int lastOrganType = -1, lastSubType = -1;
+    const AgeTable* tx = nullptr;
+    const AgeTable* tr = nullptr;
+    for (int si = 0; si<Ns; si++) {
+        int organType = rs->organTypes[si];
+        int subType = rs->subTypes[si];
+        if ((organType!=lastOrganType) || (subType!=lastSubType)) { // the segments of an organ are mostly consecutive
+            tx = kxc.find(organType, subType);
+            tr = krc.find(organType, subType);
+            lastOrganType = organType;
+            lastSubType = subType;
+        }
+        double age = simTime - rs->nodeCTs[rs->segments[si].y];
+        bool valid = true;
+        double kx_ = 0., kr_ = 0.;
+        if (kxc.type==Conductivity::valuePerSegment) {
+            valid = (kx.size()>0) && (si<int(kx[0].size()));
+            kx_ = valid ? kx[0][si] : 0.;
+        } else {
+            valid = (tx!=nullptr);
+            kx_ = valid ? (*tx)(age) : 0.;
+        }
+        if (krc.type==Conductivity::valuePerSegment) {
+            valid = valid && (kr.size()>0) && (si<int(kr[0].size()));
+            kr_ = valid ? kr[0][si] : 0.;
+        } else {
+            valid = valid && (tr!=nullptr);
+            kr_ = valid ? (*tr)(age) : 0.;
+        }
+        if ((organType == Organism::ot_leaf) && (k_stomatas.size() > 0)) {
+            valid = valid && (numleaf<k_stomatas.size());
+            if (valid) {
+                if (k_stomatas[numleaf] > 0) {
+                    kr_ = 1/(1/kr_ + 1/k_stomatas[numleaf]);
+                } else {
+                    kr_ = 0.;
+                }
+            }
+        } else if ((krc.type==Conductivity::rootExchangeZonePerType) && (organType == Organism::ot_root)) {
+            valid = valid && (si<int(rs->exchangeZoneCoefs.size()));
+            kr_ = valid ? rs->exchangeZoneCoefs[si] * kr_ : 0.;
+        }
+        if (!valid) {
+            kx_ = 0.;
+            kr_ = 0.;
+            try {
+                kx_ = kx_f(si, age, subType, organType);
+                kr_ = kr_f(si, age, subType, organType, numleaf);
+            } catch(...) {
+                std::cout << "\n XylemFlux::conductivities: conductivities failed" << std::flush;
+                std::cout  << "\n organ type "<<organType<< " subtype " << subType <<std::flush;
+            }
+        }
+        segKx[si] = kx_;
+        segKr[si] = kr_;
+        if (organType == Organism::ot_leaf) {
+            numleaf += 1;
+        }
+    }
 }
 
 /**
@@ -612,7 +1158,7 @@ std::vector<double> XylemFlux::getKx(double simtime) {
 std::vector<double> XylemFlux::getHs(const std::vector<double>& sx) {
     std::vector<double> hs = std::vector<double>(rs->segments.size());
     for (int si = 0; si<rs->segments.size(); si++) {
-        int cellIndex = rs->seg2cell[si];
+        int cellIndex = rs->getCellIndex(si);
         if (cellIndex>=0) {
             if(sx.size()>1) {
                 hs[si] = sx.at(cellIndex);
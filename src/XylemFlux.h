@@ -3,6 +3,7 @@
 #define XYLEM_FLUX_H_
 
 #include "MappedOrganism.h"
+#include "TreeSolver.h"
 #include <external/Eigen/Dense>
 #include <external/Eigen/Sparse> 
 
@@ -35,8 +36,26 @@ public:
 
     std::vector<double> splitSoilFluxes(const std::vector<double>& soilFluxes, int type = 0) const; ///< splits soil fluxes (per cell) into segment fluxes
 
+    std::vector<double> solveNeumann(double simTime, std::vector<double> value, const std::vector<double>& sx, bool cells,
+        const std::vector<double> soil_k = std::vector<double>()); ///< assembles and solves with flux boundary conditions at the nodes neumann_ind, [cm]
+    std::vector<double> solveDirichlet(double simTime, std::vector<double> value, const std::vector<double>& sx, bool cells,
+        const std::vector<double> soil_k = std::vector<double>()); ///< assembles and solves with pressure boundary conditions at the nodes dirichlet_ind, [cm]
+    std::vector<double> solveLinearSystem(const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet); ///< solves the assembled system (aI, aJ, aV, aB) with boundary conditions
+    std::vector<std::vector<double>> solveNeumannBatch(double simTime, std::vector<double> value, const std::vector<std::vector<double>>& sxx, bool cells,
+        const std::vector<std::vector<double>>& soil_k = std::vector<std::vector<double>>()); ///< solveNeumann for several soil states with one factorization, [cm]
+    std::vector<std::vector<double>> solveDirichletBatch(double simTime, std::vector<double> value, const std::vector<std::vector<double>>& sxx, bool cells,
+        const std::vector<std::vector<double>>& soil_k = std::vector<std::vector<double>>()); ///< solveDirichlet for several soil states with one factorization, [cm]
+    std::vector<double> solve(double simTime, std::vector<double> trans, double sx, const std::vector<double>& sxx, bool cells, double wiltingPoint,
+        const std::vector<double> soil_k = std::vector<double>()); ///< Neumann boundary condition, switches to Dirichlet at the wilting point, [cm]
+    std::string last = "none"; ///< boundary condition used by the last call of XylemFlux::solve ("neumann" or "dirichlet")
+
+    std::vector<int> neumann_ind = { 0 }; ///< node indices for Neumann flux (@see solveNeumann)
+    std::vector<int> dirichlet_ind = { 0 }; ///< node indices for Dirichlet flux (@see solveDirichlet)
+
     std::vector<int> aI; // to assemble the sparse matrix on the Python side
     std::vector<int> aJ;
+    int topology = 0; ///< incremented if the triplet indices aI, aJ change (e.g. new segments), the solvers are analyzed again
+    bool useTreeSolver = true; ///< solve with the TreeSolver if the segments form a tree, with SparseLU otherwise
     std::vector<double> aV;
     std::vector<double> aB;
 
@@ -52,10 +71,13 @@ public:
     void setKxValues(std::vector<double> values); ///< one value per segment
 
 
+   // conductivities per segment, set by setKr, setKx, ... (linearSystem and segFluxes use their compiled tables, @see conductivities)
    std::function<double(int, double, int, int, int)> kr_f = [](int si, double age, int type, int orgtype, int numleaf){
 		throw std::runtime_error("kr_f not implemented"); return 0.; };
     std::function<double(int, double,int,int)> kx_f = [](int si, double age, int type, int orgtype) {
 		throw std::runtime_error("kx_f not implemented"); return 1.; };
+    void conductivities(double simTime, std::vector<double>& segKr, std::vector<double>& segKx); ///< kr [1 day-1] and kx [cm3 day-1] of all segments (without soil_k)
+    void compileConductivities(); ///< compiles the tables of the setters, call after changing kr, kx, krs, kxs (or the ages) directly
 
     std::vector<double> getEffKr(double simtime);
     std::vector<double> getKx(double simtime);
@@ -153,9 +175,82 @@ protected:
     double kx_tablePerType(int si,double age, int type, int organType) { return Function::interp1(age, kxs_t.at(organType-2).at(type), kxs.at(organType-2).at(type)); } //subtype, type and age dependant
     double kx_valuePerSegment(int si, double age, int type, int organType) { return kx.at(0).at(si); };
 	
-	//for Photosynthesis::linearSystemSolve
+    /**
+     * Piecewise linear function of age, linearly interpolated between the values y at the ages x, and constant outside
+     * (same as Function::interp1), or a constant if x is empty. A uniform grid over [x.front(), x.back()] stores the
+     * table interval of each grid cell, so that a lookup does not search the table.
+     */
+    struct AgeTable {
+        std::vector<double> x, y; ///< ages [day], values
+        std::vector<int> start; ///< per grid cell, index of the first age >= the lower end of the cell
+        double scale = 0.; ///< grid cells per day
+        void set(const std::vector<double>& x_, const std::vector<double>& y_);
+        double operator()(double age) const {
+            if (x.empty()) {
+                return y[0];
+            }
+            if (age > x.back()) {
+                return y.back();
+            }
+            if (!(age > x[0])) {
+                return y[0];
+            }
+            int i = start[std::min(int((age - x[0])*scale), int(start.size()) - 1)];
+            while (x[i] < age) { // first age >= age (i.e. std::lower_bound)
+                i++;
+            }
+            while (x[i - 1] >= age) {
+                i--;
+            }
+            double ipLinear = (age - x[i - 1])/(x[i] - x[i - 1]);
+            return (1. - ipLinear)*y[i - 1] + ipLinear*y[i];
+        }
+    };
+    /**
+     * Conductivity (kr or kx) as chosen by the setters, i.e. the member function kr_f (kx_f) is bound to,
+     * compiled into one AgeTable per organ type and sub type by XylemFlux::compileConductivities
+     */
+    struct Conductivity {
+        enum Type { callback, constant, perOrgType, perType, table, tablePerOrgType, tablePerType, valuePerSegment, rootExchangeZonePerType };
+        Type type = callback; ///< callback: use kr_f (kx_f)
+        std::vector<std::vector<AgeTable>> tables; ///< [organType - 2][subType], a single row (column) if not per organ type (sub type)
+        bool byOrgType = false, bySubType = false; ///< tables per organ type (rows), per sub type (columns)
+        const AgeTable* find(int organType, int subType) const; ///< nullptr if there is no (valid) table
+    };
+    void compileConductivity(Conductivity& c, const std::vector<std::vector<double>>& values, const std::vector<std::vector<double>>& age,
+        const std::vector<std::vector<std::vector<double>>>& tables, const std::vector<std::vector<std::vector<double>>>& tablesAge);
+    Conductivity krc, kxc; ///< compiled kr and kx, @see conductivities
+
+	//filled by XylemFlux::linearSystem if withEigen = true, instead of aI, aJ and aV (solveLinearSystem and Photosynthesis use the latter)
 	std::vector<Eigen::Triplet<double>> tripletList; 
 	Eigen::VectorXd b;
+
+    /**
+     * Sparsity pattern and factorization used by XylemFlux::solveLinearSystem, the symbolic factorization is
+     * kept as long as the sparsity pattern is unchanged. Copies are empty (SparseLU is not copyable).
+     */
+    struct LinearSolver {
+        LinearSolver() { }
+        LinearSolver(const LinearSolver&) { }
+        LinearSolver& operator=(const LinearSolver&) { A.resize(0, 0); factorizedValues.clear(); return *this; }
+        Eigen::SparseMatrix<double> A; ///< system matrix including boundary conditions
+        Eigen::SparseLU<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>> lu; ///< factorization of A
+        int topology = -1; ///< XylemFlux::topology the pattern was built for
+        std::vector<int> aPos; ///< position of the k-th triplet in A.valuePtr()
+        std::vector<int> diagPos; ///< position of the diagonal entries in A.valuePtr()
+        std::vector<bool> hasEntries; ///< false for nodes that are not part of any segment
+        std::vector<double> factorizedValues; ///< values of A of the current numerical factorization
+    };
+    void analyzePattern(int N); ///< builds the sparsity pattern of the assembled system, and its symbolic factorization
+    std::vector<std::vector<double>> solveBatch(double simTime, const std::vector<std::vector<double>>& sxx, bool cells,
+        const std::vector<std::vector<double>>& soil_k, const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet);
+    void solveAssembled(const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet, double* b, int nrhs); ///< solves in place for nrhs right hand sides (N x nrhs, row major)
+    void applyBoundaryConditions(const std::vector<int>& ind, const std::vector<double>& value, bool dirichlet,
+        const std::vector<bool>& hasEntries, const std::vector<bool>& isDirichlet, double* b, int nrhs) const;
+    LinearSolver sparseSolver; ///< for general segment graphs
+    TreeSolver treeSolver; ///< O(N) elimination, if the segments form a tree (default)
+    int treeTopology = -1; ///< XylemFlux::topology the tree solver was analyzed for
+    bool isTree = false; ///< true, if the segments form a tree (@see TreeSolver::analyze)
 };
 
 } // namespace
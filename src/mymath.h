@@ -12,6 +12,7 @@
 #include <assert.h>
 #include <vector>
 #include <functional>
+#include <cstdint>
 
 
 namespace CPlantBox {
@@ -308,6 +309,41 @@ public:
 
 
 
+/**
+ * Counter based random number stream (SplitMix64 mixing of a key and a counter).
+ *
+ * The n-th number of a stream only depends on its key and n, streams with different keys are independent.
+ * Organs own a stream each (@see Organism::setThreads), so that random numbers do not depend on the order
+ * in which the organs are simulated.
+ */
+class RandomStream
+{
+public:
+
+	RandomStream(): key(0), counter(0) { } ///< Default constructor
+	RandomStream(uint64_t seed, uint64_t id): key(mix(mix(seed) ^ id)), counter(0) { } ///< stream number @param id of the seed @param seed
+
+	uint64_t next() { counter++; return mix(key + counter*0x9E3779B97F4A7C15ULL); } ///< next 64 bit random number
+	double rand() { return (next() >> 11) * (1./9007199254740992.); } ///< uniformly distributed random number [0, 1[
+	double randn() {
+		double u1 = 1. - rand(); // ]0, 1]
+		double u2 = rand();
+		return std::sqrt(-2.*std::log(u1))*std::cos(2.*M_PI*u2);
+	} ///< normally distributed random number (Box-Muller)
+	RandomStream split() { return RandomStream(key, next()); } ///< an independent stream derived from this one
+
+	static uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	} ///< SplitMix64 finalizer
+
+	uint64_t key; ///< identifies the stream
+	uint64_t counter; ///< number of drawn 64 bit numbers
+
+};
+
+
 
 } // end namespace CPlantBox
 
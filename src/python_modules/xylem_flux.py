@@ -31,6 +31,10 @@ class XylemFluxPython(XylemFlux):
         The root surface flux is calculated exactly as in Meunier et al.        
     """
 
+    _Q = None  # linear system of the last solve, built on first access (see Q, b)
+    _b = None
+    _bc = None  # boundary condition of the last solve (function, node indices, values)
+
     def __init__(self, rs):
         """ @param rs is either a pb.MappedRootSystem, pb.MappedSegments, or a string containing a rsml filename"""
         if isinstance(rs, str):
@@ -42,9 +46,40 @@ class XylemFluxPython(XylemFlux):
         self.neumann_ind = [0]  # node indices for Neumann flux
         self.dirichlet_ind = [0]  # node indices for Dirichlet flux
 
-        self.last = "none"
-        self.Q = None  # store linear system
-        self.b = None
+    @property
+    def Q(self):
+        """ system matrix of the last solve_neumann, solve_dirichlet, or solve call, including the boundary conditions,
+            built from the assembled system (aI, aJ, aV, aB) on first access """
+        if self._Q is None and self._bc is not None:
+            self._build_linear_system()
+        return self._Q
+
+    @Q.setter
+    def Q(self, Q):
+        self._Q = Q
+
+    @property
+    def b(self):
+        """ right hand side of the last solve_neumann, solve_dirichlet, or solve call, see Q """
+        if self._b is None and self._bc is not None:
+            self._build_linear_system()
+        return self._b
+
+    @b.setter
+    def b(self, b):
+        self._b = b
+
+    def _set_bc(self, bc, ind, value):
+        """ remembers the boundary condition of a solve, Q and b are built when they are used """
+        self._bc = (bc, list(ind), list(value))
+        self._Q, self._b = None, None
+
+    def _build_linear_system(self):
+        """ Q and b from the assembled system and the last boundary condition (like the Python solver did before) """
+        Q = sparse.coo_matrix((np.array(self.aV), (np.array(self.aI), np.array(self.aJ))))
+        Q = sparse.csc_matrix(Q)
+        bc, ind, value = self._bc
+        self._Q, self._b = bc(Q, self.aB, ind, value)
 
     def get_incidence_matrix(self):
         """ retruns the incidence matrix (number of segments, number of nodes) of the root system in self.rs 
@@ -99,17 +134,9 @@ class XylemFluxPython(XylemFlux):
             n = len(self.neumann_ind)
             value = [value / n] * n
 
-        if len(soil_k) > 0:
-            self.linearSystem(sim_time, sxx, cells, soil_k)  # C++ (see XylemFlux.cpp)
-        else:
-            self.linearSystem(sim_time, sxx, cells)  # C++ (see XylemFlux.cpp)
-
-        self.Q = sparse.coo_matrix((np.array(self.aV), (np.array(self.aI), np.array(self.aJ))))
-        self.Q = sparse.csc_matrix(self.Q)
-        self.Q, self.b = self.bc_neumann(self.Q, self.aB, self.neumann_ind, value)  # cm3 day-1
-
-        x = LA.spsolve(self.Q, self.b, use_umfpack = True)  # direct
-        return x
+        x = self.solveNeumann(sim_time, value, sxx, cells, soil_k)  # C++ (see XylemFlux.cpp), reuses the factorization
+        self._set_bc(self.bc_neumann, self.neumann_ind, value)
+        return np.array(x)
 
     def solve_dirichlet(self, sim_time:float, value:list, sxc:float, sxx, cells:bool, soil_k = []):
         """ solves the flux equations, with a dirichlet boundary condtion, see solve()
@@ -126,17 +153,45 @@ class XylemFluxPython(XylemFlux):
             n = len(self.dirichlet_ind)
             value = [value] * n
 
-        if len(soil_k) > 0:
-            self.linearSystem(sim_time, sxx, cells, soil_k)  # C++ (see XylemFlux.cpp)
-        else:
-            self.linearSystem(sim_time, sxx, cells)
+        x = self.solveDirichlet(sim_time, value, sxx, cells, soil_k)  # C++ (see XylemFlux.cpp), reuses the factorization
+        self._set_bc(self.bc_dirichlet, self.dirichlet_ind, value)
+        return np.array(x)
 
-        self.Q = sparse.coo_matrix((np.array(self.aV), (np.array(self.aI), np.array(self.aJ))))
-        self.Q = sparse.csc_matrix(self.Q)
-        self.Q, self.b = self.bc_dirichlet(self.Q, self.aB, self.dirichlet_ind, value)
+    def solve_neumann_batch(self, sim_time:float, value, sxx, cells:bool, soil_k = []):
+        """ solves the flux equations with a neumann boundary condtion for several soil states at once, see solve_neumann()
+            the conductivities are evaluated, and the system is factorized only once
+            @param sim_time [day]       needed for age dependent conductivities (age = sim_time - segment creation time)
+            @param value [cm3 day-1]    tranpirational flux is negative
+            @param sxx [cm]             soil matric potentials, one column per soil state (per segment or per soil cell)
+            @param cells                indicates if the matric potentials are given per cell (True) or by segments (False)
+            @param soil_k [day-1]       optionally, soil conductivities per segment, one vector for all soil states, 
+                                        or one column per soil state
+            @return [cm] root xylem pressure, one column per soil state
+         """
+        if isinstance(value, (float, int)):
+            value = [float(value)]  # split equally over neumann_ind
+        x = self.solveNeumannBatch(sim_time, value, self._columns(sxx), cells, self._columns(soil_k))  # C++ (see XylemFlux.cpp)
+        return np.array(x).transpose()
+
+    def solve_dirichlet_batch(self, sim_time:float, value, sxx, cells:bool, soil_k = []):
+        """ solves the flux equations with a dirichlet boundary condtion for several soil states at once, see solve_neumann_batch()
+            @param value [cm]           root collar pressure head 
+            @return [cm] root xylem pressure, one column per soil state
+         """
+        if isinstance(value, (float, int)):
+            value = [float(value)]
+        x = self.solveDirichletBatch(sim_time, value, self._columns(sxx), cells, self._columns(soil_k))  # C++ (see XylemFlux.cpp)
+        return np.array(x).transpose()
 
-        x = LA.spsolve(self.Q, self.b, use_umfpack = True)
-        return x
+    @staticmethod
+    def _columns(a):
+        """ list of the columns of a matrix, a vector is a single column """
+        a = np.asarray(a, dtype = np.float64)
+        if a.size == 0:
+            return []
+        if a.ndim == 1:
+            return [a]
+        return list(a.transpose())
 
     def solve(self, sim_time:float, trans:list, sx:float, sxx, cells:bool, wilting_point:float, soil_k = []):
         """ solves the flux equations using Neumann and switching to dirichlet in case wilting point is reached in root collar 
@@ -151,26 +206,15 @@ class XylemFluxPython(XylemFlux):
                                         conductivity at the root surface will be limited by the value, i.e. kr = min(kr_root, k_soil)  
             @return [cm] root xylem pressure per root system node
         """
-        eps = 1
-
-        if sx >= wilting_point - eps:
-
-            x = self.solve_neumann(sim_time, trans, sxx, cells, soil_k)  # try neumann, if below wilting point, switch to Dirichlet
-            self.last = "neumann"
-
-            if x[0] <= wilting_point:
-
-                Q = sparse.coo_matrix((np.array(self.aV), (np.array(self.aI), np.array(self.aJ))))
-                Q = sparse.csc_matrix(Q)
-                Q, b = self.bc_dirichlet(Q, self.aB, [0], [float(wilting_point)])
-                x = LA.spsolve(Q, b, use_umfpack = True)
-                self.last = "dirichlet"
-
+        if isinstance(trans, (float, int)):
+            trans = [float(trans)]  # split equally over neumann_ind
+        x = super().solve(sim_time, trans, float(sx), sxx, cells, float(wilting_point), soil_k)  # C++ (see XylemFlux.cpp)
+        if sx >= wilting_point - 1:  # Q and b keep the Neumann system, as solve_neumann
+            n = len(self.neumann_ind)
+            self._set_bc(self.bc_neumann, self.neumann_ind, [trans[0] / n] * n if (len(trans) == 1 and n > 1) else trans)
         else:
-            print("XylemFluxPython.solve: used Dirichlet because collar cell soil matric potential is below wilting point", sx)
-            x = self.solve_dirichlet(sim_time, wilting_point, sx, sxx, cells, soil_k)
-
-        return x
+            self._set_bc(self.bc_dirichlet, self.dirichlet_ind, [float(wilting_point)] * len(self.dirichlet_ind))
+        return np.array(x)
 
     def axial_flux(self, seg_ind, sim_time, rx, sxx, k_soil = [], cells = True, ij = True):
         """ returns the exact axial flux of segment ij of xylem model solution @param rx
@@ -203,7 +247,7 @@ class XylemFluxPython(XylemFlux):
         l = v.length()  # length of segment
         v.normalize()  # normalized v.z is needed for qz
         if cells:
-            cell_ind = self.rs.seg2cell[seg_ind]
+            cell_ind = self.rs.getCellIndex(seg_ind)
             if cell_ind >= 0:  # y node belowground
                 if len(sxx) > 1:
                     p_s = sxx[cell_ind]  # soil pressure at collar segment
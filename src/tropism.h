@@ -79,8 +79,16 @@ protected:
 	double sigma; ///< Standard deviation
 
 	std::weak_ptr<SignedDistanceFunction> geometry; ///< confining geometry todo
-	double randn(int nNode) {if((nNode > 0)&&(plant.lock()->getStochastic())){ return ND(gen);}else{return plant.lock()->randn();}; } ///< normally distributed random number (0,1)
-    double rand(int nNode) {if((nNode > 0)&&(plant.lock()->getStochastic())){ return UD(gen);}else{return plant.lock()->randn();}; } ///< uniformly distributed random number (0,1)
+	double randn(int nNode) {
+		auto p = plant.lock();
+		if (p->getThreads()>0) { return p->randn(); } // the organ's stream (shared generator is not thread safe)
+		if((nNode > 0)&&(p->getStochastic())){ return ND(gen);}else{return p->randn();};
+	} ///< normally distributed random number (0,1)
+    double rand(int nNode) {
+		auto p = plant.lock();
+		if (p->getThreads()>0) { return p->rand(); } // the organ's stream (shared generator is not thread safe)
+		if((nNode > 0)&&(p->getStochastic())){ return UD(gen);}else{return p->randn();};
+	} ///< uniformly distributed random number (0,1)
 	std::normal_distribution<double> ND;
     std::uniform_real_distribution<double> UD;
 	std::mt19937 gen; ///<random number generator
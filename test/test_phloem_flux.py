@@ -0,0 +1,242 @@
+import unittest
+import sys; sys.path.append(".."); sys.path.append("../src/python_modules")
+import plantbox as pb
+import numpy as np
+import threading
+
+path = "../modelparameter/plant/"
+
+
+def create_phloem_flux(seed = 2, sim_time = 7., leaf_dx = None):
+    """ a small wheat plant with photosynthesis and phloem parameters, returns PhloemFlux and soil matric potentials per cell """
+    pl = pb.MappedPlant(seed)
+    pl.readParameters(path + "Triticum_aestivum_adapted_2021.xml")
+    if leaf_dx:  # finer leaf segments
+        for p in pl.getOrganRandomParameter(pb.OrganTypes.leaf):
+            p.dx = leaf_dx
+    pl.setGeometry(pb.SDF_PlantBox(1.e100, 1.e100, 60))
+    pl.initialize(False)
+    pl.simulate(sim_time, False)
+    pl.setRectangularGrid(pb.Vector3d(-50., -50., -60.), pb.Vector3d(50., 50., 0.), pb.Vector3d(1, 1, 60), False)
+    sx = list(np.linspace(-217., -157., 60))
+    r = pb.PhloemFlux(pl, psiXylInit = sx[0], ciInit = 850e-6 * 0.5)
+    VL, VS, VR = 32, 52, 1
+    numL, numS, numr0, numr1 = 18, 21, 33, 25
+    beta = 0.9
+    kzl = VL * numL * 0.00025 ** 4 * np.pi / 8 * beta
+    kzs = VS * numS * 0.00019 ** 4 * np.pi / 8 * beta
+    kzr0 = VR * numr0 * 0.00039 ** 4 * np.pi / 8 * beta
+    kzr12 = VR * numr1 * 0.00035 ** 4 * np.pi / 8 * beta
+    r.setKr_st([[5e-2, 5e-2, 5e-2, 5e-2], [0., 0.], [0.]], kr_length_ = 0.8)
+    r.setKx_st([[kzr0, kzr12, kzr12, kzr0], [kzs, kzs], [kzl]])
+    Al = numL * VL * 0.00025 ** 2 * np.pi
+    As = numS * VS * 0.00019 ** 2 * np.pi
+    Ar0 = numr0 * VR * 0.00039 ** 2 * np.pi
+    Ar12 = numr1 * VR * 0.00035 ** 2 * np.pi
+    r.setAcross_st([[Ar0, Ar12, Ar12, Ar0], [As, As], [Al]])
+    r.g0 = 8e-3
+    r.VcmaxrefChl1 = 1.28
+    r.VcmaxrefChl2 = 8.33
+    r.a1 = 0.5
+    r.a3 = 1.5
+    r.alpha = 0.4
+    r.theta = 0.6
+    r.setKrm2([[2e-5]])
+    r.setKrm1([[10e-2]])
+    r.setRhoSucrose([[0.51], [0.65], [0.56]])
+    r.setRmax_st([[14.4, 9.0, 6.0, 14.4], [5., 5.], [15.]])
+    r.KMfu = 0.1
+    return r, sx
+
+
+def set_xylem(r, TairC, RH):
+    """ xylem conductivities and air water potential for air temperature TairC [C] and relative humidity RH [-] """
+    hPa2cm = 1.0197
+    siPhi = (30 - TairC) / (91 + TairC)
+    mu = 10 ** (-0.114 + siPhi * 1.1) / (24 * 60 * 60) / 100 / 1000 * hPa2cm
+    kzl = 32 * (0.0015 ** 4 * 2 + 0.0005 ** 4 * 2) * np.pi / (mu * 8)
+    kzs = 52 * (0.0017 ** 4 * 3 + 0.0008 ** 4) * np.pi / (mu * 8)
+    kzr0 = 0.0015 ** 4 * 4 * np.pi / (mu * 8)
+    kzr1 = (0.00041 ** 4 * 4 + 0.00087 ** 4) * np.pi / (mu * 8)
+    r.setKr([[6.37e-5 * hPa2cm, 7.9e-5 * hPa2cm, 7.9e-5 * hPa2cm, 6.37e-5 * hPa2cm], [0., 0.], [3.83e-4 * hPa2cm]], kr_length_ = 0.8)
+    r.setKx([[kzr0, kzr1, kzr1, kzr0], [kzs, kzs], [kzl]])
+    r.psi_air = np.log(RH) * 8.314 * 998.2 / 1000 * (TairC + 273.15) / 18.05 * 10000 / 0.9806806
+
+
+def photosynthesis_step(r, sx, t):
+    """ xylem and photosynthesis at time t [day], returns the air temperature [C] """
+    coef = (np.sin(np.pi * t * 2) + 1) / 2
+    TairC = 15.8 + (22 - 15.8) * coef
+    RH = 0.6
+    r.Qlight = 960e-6 * coef
+    set_xylem(r, TairC, RH)
+    r.solve_photosynthesis(sim_time_ = t, sxx_ = sx, cells_ = True, RH_ = RH, verbose_ = False, doLog_ = False, TairC_ = TairC)
+    return TairC
+
+
+def phloem_step(r, sx, t, dt = 1. / 24., filename = "test_phloem_flux.txt"):
+    """ photosynthesis, then phloem flow from t to t+dt [day] """
+    TairC = photosynthesis_step(r, sx, t)
+    r.startPM(t, t + dt, 1, TairC + 273.15, False, filename)
+    return np.array(r.Q_out)
+
+
+class TestPhloemFlux(unittest.TestCase):
+
+    def test_threads(self):
+        """ two PhloemFlux objects solved at the same time in Python threads give the serial results """
+        ref = []
+        for seed in [2, 3]:
+            r, sx = create_phloem_flux(seed)
+            ref.append(phloem_step(r, sx, 7.))
+        results = [None, None]
+
+        def run(i, seed):
+            r, sx = create_phloem_flux(seed)
+            results[i] = phloem_step(r, sx, 7., filename = "test_phloem_flux" + str(i) + ".txt")
+
+        threads = [threading.Thread(target = run, args = (i, seed)) for i, seed in enumerate([2, 3])]
+        for th in threads:
+            th.start()
+        for th in threads:
+            th.join()
+        for i in range(0, 2):
+            self.assertGreater(len(ref[i]), 0, "threads: no phloem results")
+            self.assertTrue(np.array_equal(ref[i], results[i]), "threads: results of object " + str(i) + " differ from the serial run")
+
+    def test_jacobian(self):
+        """ the analytical jacobian of the phloem system (solver 32) agrees with finite differences """
+        r, sx = create_phloem_flux(2, 5.)
+        r.solver = 32
+        q = phloem_step(r, sx, 5.)
+        self.assertEqual(r.solverStats.get("flag", 0), 0, "jacobian: solver 32 failed")
+        err = r.jacobianError(5. + 1. / 24.)
+        self.assertLess(err, 1.e-6, "jacobian: analytical and finite difference jacobian differ")
+        q_ = phloem_step(create_phloem_flux(2, 5.)[0], sx, 5.)  # default solver, finite difference jacobian in the Krylov solver
+        self.assertLess(np.max(np.abs(q - q_)), 1.e-3 * np.max(np.abs(q_)), "jacobian: solver 32 and solver 1 differ")
+
+    def test_preconditioner(self):
+        """ the Krylov solvers give the same results with the tree preconditioner, the band preconditioner (used if the connections are no tree), and without """
+        q = {}
+        for solver, tree in [(1, True), (17, True), (17, False), (10, True)]:
+            r, sx = create_phloem_flux(2, 5.)
+            r.solver = solver
+            r.treePreconditioner = tree
+            q[(solver, tree)] = phloem_step(r, sx, 5.)
+            self.assertEqual(r.solverStats.get("flag", 0), 0, "preconditioner: solver " + str(solver) + " failed")
+            if solver != 1:
+                self.assertGreater(r.solverStats["npe"], 0, "preconditioner: no preconditioner setup")
+        ref = q[(1, True)]
+        for k, q_ in q.items():
+            self.assertLess(np.max(np.abs(q_ - ref)), 1.e-3 * np.max(np.abs(ref)), "preconditioner: solver " + str(k) + " differs from solver 1")
+
+    def test_warm_restart(self):
+        """ keeping the CVODE integrator over consecutive time steps (warm restart) gives the results of a new integrator for each step """
+        q = {}
+        for warm in [False, True]:
+            r, sx = create_phloem_flux(2, 5.)
+            r.warmRestart = warm
+            r.useCWGr = False  # no growth between the steps, the integrator is kept for the same plant
+            dt = 1. / 24.
+            for i in range(0, 2):
+                q[(warm, i)] = phloem_step(r, sx, 5. + i * dt, dt)
+                self.assertEqual(r.solverStats.get("flag", 0), 0, "warm restart: solver failed, warmRestart = " + str(warm))
+        for i in range(0, 2):
+            ref = q[(False, i)]
+            self.assertLess(np.max(np.abs(q[(True, i)] - ref)), 1.e-3 * np.max(np.abs(ref)), "warm restart: step " + str(i) + " differs from the cold start")
+
+    def test_incremental_parameters(self):
+        """ after the plant grew, updating the parameters of the new segments only gives the results of a full rebuild """
+        q = []
+        for rebuild in [False, True]:
+            r, sx = create_phloem_flux(2, 5.)
+            phloem_step(r, sx, 5., 0.25)  # enough sucrose for growth to add segments
+            n = len(r.plant.segments)
+            r.plant.simulate(0.25, False)
+            self.assertGreater(len(r.plant.segments), n, "incremental parameters: the plant did not grow")
+            if rebuild:  # a set... function recomputes the parameters of all segments
+                r.setKr_st([[5e-2, 5e-2, 5e-2, 5e-2], [0., 0.], [0.]], kr_length_ = 0.8)
+            q.append(phloem_step(r, sx, 5.25))
+        self.assertTrue(np.array_equal(q[0], q[1]), "incremental parameters: results differ from the full rebuild")
+
+    def test_growth_threads(self):
+        """ the growth of the organs computed on several threads is the serial result """
+        res = []
+        for threads in [0, 3]:
+            r, sx = create_phloem_flux(2, 5.)
+            r.growthThreads = threads
+            q = phloem_step(r, sx, 5., 0.25)
+            res.append((q, np.array(r.Q_Grmax), np.array(r.delta_ls_org_i), np.array(r.delta_ls_org_imax)))
+        self.assertGreater(np.sum(res[0][2]), 0., "growth threads: no growth")
+        for a, b in zip(res[0], res[1]):
+            self.assertTrue(np.array_equal(a, b), "growth threads: results differ from the serial run")
+
+    def test_anderson(self):
+        """ the Anderson accelerated fixed point iteration converges to the Picard solution, in wet and in dry soil """
+        for sx in [list(np.linspace(-217., -157., 60)), list(np.linspace(-15000., -10000., 60))]:
+            res = []
+            for depth in [0, 3]:
+                r, _ = create_phloem_flux(2, 5.)
+                r.andersonDepth = depth
+                photosynthesis_step(r, sx, 5.25)
+                self.assertLess(r.loop, r.maxLoop, "anderson: no convergence, andersonDepth = " + str(depth))
+                res.append((np.array(r.An), np.array(r.psiXyl)))
+            for name, a, b in zip(["An", "psiXyl"], res[0], res[1]):
+                self.assertLess(np.max(np.abs(a - b)), r.limMaxErr * np.max(np.abs(a)), "anderson: " + name + " differs from the Picard iteration")
+
+    def test_loop_threads(self):
+        """ the leaf gas exchange computed on several threads is the serial result """
+        res = []
+        for threads in [0, 4]:
+            r, sx = create_phloem_flux(2, 7., leaf_dx = 0.02)  # > 1000 leaf segments, i.e. several chunks
+            r.loopThreads = threads
+            photosynthesis_step(r, sx, 7.25)
+            res.append((np.array(r.An), np.array(r.gco2), np.array(r.ci), np.array(r.Ev), np.array(r.psiXyl), r.loop))
+        self.assertGreater(len(res[0][0]), 1000, "loop threads: too few leaf segments")
+        for a, b in zip(res[0], res[1]):
+            self.assertTrue(np.array_equal(a, b), "loop threads: results differ from the serial run")
+
+    def test_log(self):
+        """ the trace (doLog) does not change the results, also when the iteration stops at maxLoop """
+        import os, tempfile
+        for maxLoop in [1000, 2]:
+            res = []
+            for doLog in [False, True]:
+                r, sx = create_phloem_flux(2, 5.)
+                r.maxLoop = maxLoop
+                cwd = os.getcwd()
+                with tempfile.TemporaryDirectory() as d:
+                    os.chdir(d)
+                    try:
+                        r.Qlight = 500.e-6
+                        set_xylem(r, 20., 0.6)
+                        r.solve_photosynthesis(sim_time_ = 5., sxx_ = sx, cells_ = True, RH_ = 0.6, verbose_ = False, doLog_ = doLog, TairC_ = 20.)
+                        files = sorted(os.listdir(d))
+                    finally:
+                        os.chdir(cwd)
+                res.append((np.array(r.An), np.array(r.psiXyl), r.loop, r.maxMaxErr))
+                if doLog:
+                    for name in ["errphoto_", "loopphoto_"]:
+                        self.assertEqual(len([f for f in files if f.startswith(name)]), r.loop - 1, "log: one " + name + " file per loop")  # loop is incremented once more at the end
+                else:
+                    self.assertEqual(len(files), 0, "log: files written without doLog")
+            self.assertTrue(np.array_equal(res[0][0], res[1][0]), "log: An differs, maxLoop = " + str(maxLoop))
+            self.assertTrue(np.array_equal(res[0][1], res[1][1]), "log: psiXyl differs, maxLoop = " + str(maxLoop))
+            self.assertEqual(res[0][2], res[1][2], "log: number of loops differs, maxLoop = " + str(maxLoop))
+            self.assertEqual(res[0][3], res[1][3], "log: maxMaxErr differs, maxLoop = " + str(maxLoop))
+
+    def test_xylem_factorization(self):
+        """ psiXyl of the photosynthesis loop (reusing the factorization) solves the xylem system of the last stomatal conductances """
+        from scipy import sparse
+        import scipy.sparse.linalg as LA
+        r, sx = create_phloem_flux(2, 5.)
+        for t in [5., 5.25]:  # the second call reuses the analysis of the first one
+            photosynthesis_step(r, sx, t)
+            r.linearSystem(t, sx, True)
+            A = sparse.coo_matrix((np.array(r.aV), (np.array(r.aI), np.array(r.aJ))))
+            psi = LA.spsolve(A.tocsc(), np.array(r.aB))
+            self.assertLess(np.max(np.abs(psi - np.array(r.psiXyl))), 1.e-8 * np.max(np.abs(psi)), "xylem factorization: psiXyl differs from a new solve at t = " + str(t))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -84,6 +84,53 @@ class TestPlant(unittest.TestCase):
                 dl = r.getParent().getOrganRandomParameter().ldelay #only works because deviation == 0
                 et = r.getParent().getNodeCT(r.parentNI) + dl
             self.assertAlmostEqual(r.getAge(), (time -et), 10, "numeric and analytic age of root n#" + str(i + 1) +" do not agree")
+    def test_segment_order(self):
+        """ checks the segment getters (served from the segment store) against the organ tree, per organ type and after each time step """
+        p = pb.Plant(2)
+        p.readParameters(path + "Triticum_aestivum_adapted_2021.xml")
+        p.initialize(False)
+        for t in range(0, 3):
+            p.simulate(7, False)
+            cts = p.getNodeCTs()
+            for ot in [-1, pb.root, pb.stem, pb.leaf]:
+                organs = p.getOrgans(ot)
+                segs = [[s.x, s.y] for o in organs for s in o.getSegments()]
+                self.assertEqual([[s.x, s.y] for s in p.getSegments(ot)], segs, "segment order: segments of organ type " + str(ot) + " differ")
+                self.assertEqual([o.getId() for o in p.getSegmentOrigins(ot)], [o.getId() for o in organs for s in o.getSegments()],
+                                 "segment order: origins of organ type " + str(ot) + " differ")
+                self.assertEqual(p.getSegmentCTs(ot), [cts[s[1]] for s in segs], "segment order: creation times of organ type " + str(ot) + " differ")
+                self.assertEqual(p.getNumberOfSegments(ot), len(segs), "segment order: number of segments of organ type " + str(ot) + " differs")
+
+    def test_incremental_mapping(self):
+        """ checks the MappedPlant after incremental time steps against the organ tree, and the moved nodes against the actual moves """
+        p = pb.MappedPlant(2)
+        p.readParameters(path + "Triticum_aestivum_adapted_2021.xml")
+        p.setGeometry(pb.SDF_PlantBox(1.e100, 1.e100, 60))
+        p.initialize(False)
+        p.setRectangularGrid(pb.Vector3d(-10., -10., -40.), pb.Vector3d(10., 10., 20.), pb.Vector3d(10, 10, 30), False)
+        for t in range(0, 12):
+            old_nodes, old_cts = [[n.x, n.y, n.z] for n in p.nodes], list(p.nodeCTs)
+            p.simulate(1, False)
+            nodes, cts, segs = [[n.x, n.y, n.z] for n in p.nodes], list(p.nodeCTs), [[s.x, s.y] for s in p.segments]
+            moved = [i for i in range(0, len(old_nodes)) if (nodes[i] != old_nodes[i]) or (cts[i] != old_cts[i])]
+            self.assertEqual(sorted(set(p.getUpdatedNodeIndices())), moved, "incremental mapping: reported moves differ from the actual moves at t = " + str(t))
+            ref_nodes, ref_cts, ref_segs = {}, {}, {}  # from the organ tree
+            for o in p.getOrgans():
+                for i in range(1, o.getNumberOfNodes()):  # the first node belongs to the parent
+                    n = o.getNode(i)
+                    ref_nodes[o.getNodeId(i)] = [n.x, n.y, n.z]
+                    ref_cts[o.getNodeId(i)] = o.getNodeCT(i)
+                for s in o.getSegments():
+                    ref_segs[s.y - 1] = [s.x, s.y]
+            self.assertEqual(len(ref_segs), len(segs), "incremental mapping: wrong number of segments at t = " + str(t))
+            self.assertEqual([ref_segs[si] for si in range(0, len(segs))], segs, "incremental mapping: segments differ at t = " + str(t))
+            self.assertEqual(len(ref_nodes), len(segs), "incremental mapping: wrong number of nodes at t = " + str(t))
+            for i in ref_nodes:
+                self.assertEqual(nodes[i], ref_nodes[i], "incremental mapping: node " + str(i) + " differs at t = " + str(t))
+                self.assertEqual(cts[i], ref_cts[i], "incremental mapping: creation time of node " + str(i) + " differs at t = " + str(t))
+            mids = [pb.Vector3d([(nodes[s[0]][k] + nodes[s[1]][k]) / 2 for k in range(0, 3)]) for s in segs]
+            self.assertEqual(list(p.getSeg2CellArray()), [p.soil_index(m.x, m.y, m.z) for m in mids], "incremental mapping: seg2cell differs at t = " + str(t))
+
 
 if __name__ == '__main__':
     # MANY tests missing !!!
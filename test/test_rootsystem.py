@@ -149,6 +149,261 @@ class TestRootSystem(unittest.TestCase):
         rs3.simulate(10)
         self.assertEqual(rs3.rand(), n2, "copy: simulation is not deterministic")
 
+    def test_parallel(self):
+        """ checks if parallel simulation is independent of the number of threads """
+        name = "Zea_mays_1_Leitner_2010"
+        nodes, segs = [], []
+        for threads in [1, 3]:
+            rs = pb.RootSystem()
+            rs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+            rs.setSeed(42)
+            rs.setThreads(threads)
+            rs.initialize(False)
+            for i in range(0, 10):
+                rs.simulate(1)
+            nodes.append([[n.x, n.y, n.z] for n in rs.getNodes()])
+            segs.append([[s.x, s.y] for s in rs.getSegments()])
+            self.assertEqual(len(rs.getNodes()), rs.getNumberOfNodes(), "parallel: node indices are not contiguous")
+            self.assertEqual(max([s.y for s in rs.getSegments()]), rs.getNumberOfNodes() - 1, "parallel: node indices are not contiguous")
+        self.assertEqual(nodes[0], nodes[1], "parallel: nodes depend on the number of threads")
+        self.assertEqual(segs[0], segs[1], "parallel: segments depend on the number of threads")
+
+    def test_parallel_serial(self):
+        """ checks parallel against serial simulation, without stochasticity both must give the same geometry """
+        nodes, segs = [], []
+        for threads in [0, 3]:
+            rs = pb.MappedPlant()
+            rs.readParameters("../modelparameter/plant/Heliantus_Pagès_2013.xml")
+            rs.setSeed(42)
+            rs.setThreads(threads)
+            rs.initialize(False, False)
+            for i in range(0, 10):
+                rs.simulate(1)
+            nodes.append(sorted([(n.x, n.y, n.z) for n in rs.getNodes()]))
+            segs.append(len(rs.getSegments()))
+        self.assertEqual(segs[0], segs[1], "parallel: number of segments differs from serial simulation")
+        self.assertEqual(nodes[0], nodes[1], "parallel: nodes differ from serial simulation")
+
+    def test_parallel_organisms(self):
+        """ checks that two root systems simulated at the same time do not interfere """
+        import threading
+        name = "Zea_mays_1_Leitner_2010"
+
+        def create():
+            rs = pb.RootSystem()
+            rs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+            rs.setSeed(42)
+            rs.setThreads(3)
+            rs.initialize(False)
+            return rs
+
+        def run(rs):
+            for i in range(0, 10):
+                rs.simulate(1)
+
+        ref = create()
+        run(ref)
+        rs = [create(), create()]
+        t = [threading.Thread(target = run, args = (r,)) for r in rs]
+        for t_ in t:
+            t_.start()
+        for t_ in t:
+            t_.join()
+        ref_nodes = [[n.x, n.y, n.z] for n in ref.getNodes()]
+        ref_segs = [[s.x, s.y] for s in ref.getSegments()]
+        for r in rs:
+            self.assertEqual([[n.x, n.y, n.z] for n in r.getNodes()], ref_nodes, "parallel: concurrent simulations interfere (nodes)")
+            self.assertEqual([[s.x, s.y] for s in r.getSegments()], ref_segs, "parallel: concurrent simulations interfere (segments)")
+
+    def test_segment_store(self):
+        """ checks the NumPy arrays of the segment store against the node and segment lists """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = pb.RootSystem()
+        rs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+        rs.initialize(False)
+        rs.simulate(20)
+        store = rs.getSegmentStore()
+        nodes = np.array((list(map(np.array, rs.getNodes()))))
+        segs = np.array((list(map(np.array, rs.getSegments()))), dtype = np.int64)
+        self.assertEqual(store.nodes.shape, nodes.shape, "segment store: wrong node array shape")
+        self.assertEqual(np.sum(store.nodes[1:] != nodes[1:]), 0, "segment store: nodes are not equal")
+        self.assertEqual(np.sum(store.nodeCTs != np.array(rs.getNodeCTs())), 0, "segment store: node creation times are not equal")
+        valid = store.organIds >= 0
+        self.assertEqual(np.sum(valid), segs.shape[0], "segment store: wrong number of segments")
+        segIds = segs[:, 1] - 1  # segment indices
+        self.assertEqual(np.sum(store.segments[segIds] != segs), 0, "segment store: segments are not equal")
+        self.assertEqual(np.sum(store.segments[valid, 1] - 1 != np.nonzero(valid)[0]), 0, "segment store: wrong segment indices")
+        organSegs = [[s.x, s.y] for o in rs.getOrgans() for s in o.getSegments()]  # organ traversal order
+        self.assertEqual(segs.tolist(), organSegs, "segment store: segments are not in organ order")
+        organIds = [o.getId() for o in rs.getSegmentOrigins()]
+        self.assertEqual(organIds, [o.getId() for o in rs.getOrgans() for s in o.getSegments()], "segment store: origins are not in organ order")
+        self.assertEqual(rs.getSegmentCTs(), [rs.getNodeCTs()[s[1]] for s in organSegs], "segment store: wrong segment creation times")
+        self.assertFalse(store.nodes.flags.writeable, "segment store: arrays must be read only")
+        old_nodes = store.nodes
+        rs.simulate(1)
+        self.assertEqual(np.sum(old_nodes[1:] != nodes[1:]), 0, "segment store: arrays must stay valid after simulate")
+        self.assertEqual(store.nodes.shape[0], rs.getNumberOfNodes(), "segment store: wrong node array shape")
+        mrs = pb.MappedRootSystem()
+        mrs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+        mrs.initialize(False)
+        mrs.simulate(10)
+        for a in [mrs.getNodesArray(), mrs.getSegmentsArray(), mrs.getRadiiArray(), mrs.getSeg2CellArray()]:
+            self.assertFalse(a.flags.writeable, "mapped segments: arrays must be read only")
+
+    def test_conductivities(self):
+        """ checks the compiled conductivity tables of XylemFlux against the callbacks kr_f and kx_f """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = pb.MappedRootSystem()
+        rs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+        rs.initialize(False)
+        rs.simulate(20)
+        r = pb.XylemFlux(rs)
+        ages = [[0., 2.5, 7., 12., 20.] for st in range(0, 5)]
+        values = [[1.e-4 * (st + 1), 8.e-5, 5.e-5 * (st + 1), 2.e-5, 1.e-5] for st in range(0, 5)]
+        r.setKrTables(values, ages)
+        r.setKx([0.1, 0.05, 0.01], [0., 10., 30.])
+        kr, kx = r.conductivities(25.)
+        segs, cts, subTypes = rs.segments, rs.nodeCTs, rs.subTypes
+        self.assertEqual(len(kr), len(segs), "conductivities: wrong number of segments")
+        for si, s in enumerate(segs):
+            age = 25. - cts[s.y]
+            self.assertEqual(kr[si], r.kr_f_cpp(si, age, subTypes[si], 2, 0), "conductivities: kr differs from kr_f")
+            self.assertEqual(kx[si], r.kx_f_cpp(si, age, subTypes[si], 2), "conductivities: kx differs from kx_f")
+        r.setKx([0.1])
+        r.kx = [[0.2]]  # recompiles the tables
+        kr, kx = r.conductivities(25.)
+        self.assertEqual(kx[0], 0.2, "conductivities: kx was not recompiled")
+
+    def test_xylem_linear_system(self):
+        """ checks the lazily built linear system Q, b of XylemFluxPython, and the solver after the segments changed """
+        from xylem_flux import XylemFluxPython
+        from scipy import sparse
+        import scipy.sparse.linalg as LA
+        name = "Anagallis_femina_Leitner_2010"
+        rs = pb.MappedRootSystem()
+        rs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+        rs.initialize(False)
+        rs.simulate(10)
+        r = XylemFluxPython(rs)
+        r.setKr([1.e-4])
+        r.setKx([1.e-2])
+        for t in [10., 15.]:
+            sxx = [-300.] * len(rs.segments)
+            x = r.solve_neumann(t, -0.1, sxx, False)
+            self.assertEqual(r.Q.shape[0], len(x), "linear system: wrong size of Q")
+            x_ = LA.spsolve(r.Q, np.array(r.b))
+            self.assertLess(np.max(np.abs(x - x_)), 1.e-8 * np.max(np.abs(x)), "linear system: Q, b do not match the solution")
+            r.aI = list(r.aI)  # changes the topology, the solver analyzes the pattern again
+            x_ = r.solveLinearSystem([0], [-0.1], False)
+            self.assertLess(np.max(np.abs(x - np.array(x_))), 1.e-8 * np.max(np.abs(x)), "linear system: solution changed after setting aI")
+            rs.simulate(5)  # new segments
+
+    def test_soil_mappers(self):
+        """ checks the read only views seg2cell and cell2seg against the mapper arrays """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = pb.MappedRootSystem()
+        rs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+        rs.setRectangularGrid(pb.Vector3d(-4., -4., -15.), pb.Vector3d(4., 4., 0.), pb.Vector3d(4, 4, 5), False)
+        rs.initialize(False)
+        rs.simulate(10)
+        s2c = rs.getSeg2CellArray()
+        seg2cell = rs.seg2cell
+        self.assertEqual(len(seg2cell), len(rs.segments), "seg2cell: all segments should be mapped")
+        self.assertEqual(dict(seg2cell), rs.getSeg2CellMap(), "seg2cell: view and map differ")
+        self.assertTrue(np.all(np.array([seg2cell[i] for i in range(0, len(s2c))]) == s2c), "seg2cell: view and array differ")
+        self.assertTrue(-1 in rs.cell2seg, "cell2seg: expected segments outside the soil domain")
+        self.assertEqual(dict(rs.cell2seg), rs.getCell2SegMap(), "cell2seg: view and map differ")
+        with self.assertRaises(TypeError):
+            rs.seg2cell[0] = 1  # read only
+        with self.assertRaises(KeyError):
+            rs.seg2cell[len(s2c)]
+        rs.simulate(5)
+        self.assertEqual(len(seg2cell), len(rs.segments), "seg2cell: the view should follow simulate")
+        map = rs.getSeg2CellMap()
+        del map[1]
+        rs.seg2cell = map  # segment 1 is not mapped
+        self.assertFalse(1 in rs.seg2cell, "seg2cell: segment 1 should not be mapped")
+        self.assertEqual(rs.getSeg2CellArray()[1], -2, "seg2cell: segment 1 should not be mapped")
+        self.assertEqual(rs.getCellIndex(1), -1, "getCellIndex: segment 1 should not be mapped")
+
+    def test_soil_indices(self):
+        """ checks the batch soil indices against the per point soil_index, for the default mapper and Python callbacks """
+        rs = pb.MappedRootSystem()
+        rs.setRectangularGrid(pb.Vector3d(-4., -4., -15.), pb.Vector3d(4., 4., 0.), pb.Vector3d(4, 4, 5), False)
+        np.random.seed(1)
+        xyz = np.random.uniform([-5., -5., -16.], [5., 5., 1.], (500, 3))
+        xyz[:10] = [[-4., -4., -15.], [4., 4., 0.], [0., 0., -3.], [-2., 2., -6.], [3.99, -4., -14.99], [-4., 0., -15.1],
+                    [2., 2., 0.], [-4.01, 0., -1.], [0., 0., 0.], [1., -1., -9.]]  # faces and corners of the domain
+        points = [pb.Vector3d(*p) for p in xyz]
+        ref = [rs.soil_index(p.x, p.y, p.z) for p in points]
+        self.assertTrue(-1 in ref, "soil indices: expected points outside the soil domain")
+        self.assertEqual(rs.soilIndices(points), ref, "soil indices: default batch mapper differs from soil_index")
+        rs.soil_index = lambda x, y, z: int(x > 0) + 2 * int(y > 0) if z > -10. else -1
+        ref = [rs.soil_index(p.x, p.y, p.z) for p in points]
+        self.assertEqual(rs.soilIndices(points), ref, "soil indices: per point Python callback differs from soil_index")
+        rs.soil_indices = lambda x, y, z: [rs.soil_index(x_, y_, z_) for x_, y_, z_ in zip(x, y, z)]
+        self.assertEqual(rs.soilIndices(points), ref, "soil indices: batch Python callback differs from soil_index")
+        rs.soil_indices = lambda x, y, z: [0]
+        with self.assertRaises(RuntimeError):
+            rs.soilIndices(points)  # wrong number of cell indices
+
+    def test_cut_segments(self):
+        """ checks the segments cut at the grid faces: length, cells of the pieces, creation times, and the number of threads """
+        name = "Anagallis_femina_Leitner_2010"
+        min_, max_, res = pb.Vector3d(-4., -4., -15.), pb.Vector3d(4., 4., 0.), pb.Vector3d(4, 4, 5)
+
+        def cut_system(threads, soil_index = None):
+            rs = pb.MappedRootSystem()
+            rs.readParameters("../modelparameter/rootsystem/" + name + ".xml")
+            rs.setSeed(1)
+            rs.initialize(False)
+            rs.simulate(10, False)
+            nodes, cts = [pb.Vector3d(n) for n in rs.nodes], list(rs.nodeCTs)
+            length = np.sum(rs.segLength())
+            rs.cutThreads = threads
+            if soil_index:
+                rs.setSoilGrid(soil_index, min_, max_, res, True)
+            else:
+                rs.setRectangularGrid(min_, max_, res, True)
+            return rs, nodes, cts, length
+
+        def soil_index(x, y, z):  # coarser than the grid, cells are halves of the domain
+            return int(x > 0.) if (abs(x) < 4.) and (abs(y) < 4.) and (z > -15.) and (z < 0.) else -1
+
+        for mapper in [None, soil_index]:
+            rs, nodes, cts, length = cut_system(0, mapper)
+            n0 = len(nodes)
+            self.assertGreater(len(rs.nodes), n0, "cut segments: no segment was cut")
+            self.assertAlmostEqual(np.sum(rs.segLength()), length, 10, "cut segments: total length changed")
+            cut_nodes, cut_cts, seg2cell = rs.nodes, rs.nodeCTs, rs.getSeg2CellArray()
+            parent = {s.y: s.x for s in rs.segments}
+            child = {s.x: si for si, s in enumerate(rs.segments) if s.x >= n0}  # a new node has a single child piece
+            for i in range(n0, len(cut_nodes)):
+                self.assertNotEqual(seg2cell[i - 1], seg2cell[child[i]], "cut segments: cut within a cell at node " + str(i))
+            for si, s in enumerate(rs.segments):
+                n1, n2 = cut_nodes[s.x], cut_nodes[s.y]
+                v = n2.minus(n1)
+                for t in [0.05, 0.5, 0.95]:
+                    if t * v.length() > 2.e-5 and (1 - t) * v.length() > 2.e-5:  # pieces shorter than eps = 1.e-5 are not cut
+                        p = n1.plus(v.times(t))
+                        self.assertEqual(rs.soil_index(p.x, p.y, p.z), seg2cell[si], "cut segments: segment " + str(si) + " is in more than one cell")
+                if s.y < n0:  # last piece of an original segment, the other pieces end in new nodes
+                    x = s.x
+                    while x >= n0:
+                        x = parent[x]
+                    l = nodes[s.y].minus(nodes[x]).length()
+                    i = s.x
+                    while i >= n0:
+                        t = cut_nodes[i].minus(nodes[x]).length() / l
+                        self.assertAlmostEqual(cut_cts[i], cts[x] + t * (cts[s.y] - cts[x]), 10, "cut segments: creation time is not interpolated")
+                        i = parent[i]
+            rs4, _, _, _ = cut_system(4, mapper)
+            self.assertEqual([[n.x, n.y, n.z] for n in rs4.nodes], [[n.x, n.y, n.z] for n in rs.nodes], "cut segments: nodes depend on cutThreads")
+            self.assertEqual([[s.x, s.y] for s in rs4.segments], [[s.x, s.y] for s in rs.segments], "cut segments: segments depend on cutThreads")
+            self.assertEqual(list(rs4.nodeCTs), list(rs.nodeCTs), "cut segments: creation times depend on cutThreads")
+            self.assertEqual(list(rs4.getSeg2CellArray()), list(rs.getSeg2CellArray()), "cut segments: seg2cell depends on cutThreads")
+        self.assertEqual(set(seg2cell), {-1, 0, 1}, "cut segments: expected the cells of the custom mapper")
+
     def test_polylines(self):
         """checks if the polylines have the right tips and bases """
         name = "Brassica_napus_a_Leitner_2010"
@@ -0,0 +1,83 @@
+import unittest
+import sys; sys.path.append(".."); sys.path.append("../src/python_modules")
+import plantbox as pb
+from xylem_flux import XylemFluxPython
+import numpy as np
+
+
+def create_xylem_flux(sim_time = 10.):
+    """ a small root system on a rectangular soil grid, with age dependent conductivities, returns XylemFluxPython """
+    rs = pb.MappedRootSystem()
+    rs.readParameters("../modelparameter/rootsystem/Anagallis_femina_Leitner_2010.xml")
+    rs.setRectangularGrid(pb.Vector3d(-20., -20., -40.), pb.Vector3d(20., 20., 0.), pb.Vector3d(4, 4, 5), False)
+    rs.initialize(False)
+    rs.simulate(sim_time)
+    r = XylemFluxPython(rs)
+    r.setKr([1.e-4, 5.e-5, 1.e-5], [0., 5., 10.])
+    r.setKx([1.e-2, 5.e-2, 1.e-1], [0., 5., 10.])
+    return r
+
+
+class TestXylemFlux(unittest.TestCase):
+
+    def test_batch(self):
+        """ checks the batch solves against column by column solveNeumann and solveDirichlet, per segment and per cell """
+        r = create_xylem_flux()
+        t, ns, nc = 12., len(r.rs.segments), 4 * 4 * 5
+        np.random.seed(1)
+        sxx = np.random.uniform(-500., -100., (ns, 4))  # one column per soil state
+        sxc = np.random.uniform(-500., -100., (nc, 4))
+        soil_k = np.random.uniform(1.e-3, 1.e-1, (ns, 4))
+        for sx, cells in [(sxx, False), (sxc, True)]:
+            x = r.solve_neumann_batch(t, -0.1, sx, cells)
+            self.assertEqual(x.shape, (len(r.rs.nodes), sx.shape[1]), "batch: wrong number of nodes or soil states")
+            for i in range(0, sx.shape[1]):
+                x_ = np.array(r.solveNeumann(t, [-0.1], sx[:, i], cells))
+                self.assertLess(np.max(np.abs(x[:, i] - x_)), 1.e-10 * np.max(np.abs(x_)), "batch: Neumann solve differs for soil state " + str(i))
+            x = r.solve_dirichlet_batch(t, -800., sx, cells)
+            for i in range(0, sx.shape[1]):
+                x_ = np.array(r.solveDirichlet(t, [-800.], sx[:, i], cells))
+                self.assertLess(np.max(np.abs(x[:, i] - x_)), 1.e-10 * np.max(np.abs(x_)), "batch: Dirichlet solve differs for soil state " + str(i))
+        soil_k[:, 1] = soil_k[:, 0]  # soil states 0 and 1 share the factorization
+        x = r.solve_neumann_batch(t, -0.1, sxx, False, soil_k)
+        for i in range(0, sxx.shape[1]):
+            x_ = np.array(r.solveNeumann(t, [-0.1], sxx[:, i], False, soil_k[:, i]))
+            self.assertLess(np.max(np.abs(x[:, i] - x_)), 1.e-10 * np.max(np.abs(x_)), "batch: Neumann solve with soil conductivities differs for soil state " + str(i))
+        x = r.solve_neumann_batch(t, -0.1, sxx[:, 2], False)  # a single soil state
+        x_ = np.array(r.solveNeumann(t, [-0.1], sxx[:, 2], False))
+        self.assertLess(np.max(np.abs(x[:, 0] - x_)), 1.e-10 * np.max(np.abs(x_)), "batch: single soil state differs")
+        with self.assertRaises(ValueError):
+            r.solve_neumann_batch(t, -0.1, sxx, False, soil_k[:, :2])  # soil conductivities for two of four soil states
+
+    def test_tree_solver(self):
+        """ checks the tree solver against SparseLU on a branched plant (roots, stems and leaves) """
+        pl = pb.MappedPlant(2)
+        pl.readParameters("../modelparameter/plant/Triticum_aestivum_adapted_2021.xml")
+        pl.setGeometry(pb.SDF_PlantBox(1.e100, 1.e100, 60))
+        pl.initialize(False)
+        pl.simulate(10., False)
+        r = XylemFluxPython(pl)
+        r.setKr([1.e-4, 5.e-5, 1.e-5], [0., 5., 10.])
+        r.setKx([1.e-2, 5.e-2, 1.e-1], [0., 5., 10.])
+        parents = [s.x for s in pl.segments]
+        self.assertGreater(len(parents) - len(set(parents)), 0, "tree solver: the plant is not branched")
+        self.assertEqual(set(pl.organTypes), {2, 3, 4}, "tree solver: expected roots, stems and leaves")
+        np.random.seed(1)
+        sx = np.random.uniform(-500., -100., len(pl.segments))
+        r.linearSystem(10., sx, False)
+        for ind, value, dirichlet in [([0], [-0.1], False), ([0], [-800.], True), ([0, 5], [-0.05, -0.05], False)]:
+            r.useTreeSolver = True
+            x = np.array(r.solveLinearSystem(ind, value, dirichlet))
+            r.useTreeSolver = False
+            x_ = np.array(r.solveLinearSystem(ind, value, dirichlet))  # SparseLU
+            self.assertLess(np.max(np.abs(x - x_)), 1.e-10 * np.max(np.abs(x_)), "tree solver: solution differs from SparseLU for " + str((ind, dirichlet)))
+        sxx = np.random.uniform(-500., -100., (len(pl.segments), 3))
+        r.useTreeSolver = True
+        x = r.solve_neumann_batch(10., -0.1, sxx, False)  # several right hand sides
+        r.useTreeSolver = False
+        x_ = r.solve_neumann_batch(10., -0.1, sxx, False)
+        self.assertLess(np.max(np.abs(x - x_)), 1.e-10 * np.max(np.abs(x_)), "tree solver: batch solution differs from SparseLU")
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -19,13 +19,8 @@ res_ = np.array([3, 1, 5])
 rs.setRectangularGrid(pb.Vector3d(min_), pb.Vector3d(max_), pb.Vector3d(res_), True)  # cut and map segments
 
 """ add segment indices """
-segs = rs.segments
-x = np.zeros(len(segs))
-for i, s in enumerate(segs):
-    try:
-        x[i] = rs.seg2cell[i]
-    except:  # in case the segment is not within the domain
-        x[i] = -1
+x = np.array(rs.getSeg2CellArray(), dtype = float)
+x[x < 0] = -1  # in case the segment is not within the domain
 
 """ infos on a specific cell"""
 ci = rs.soil_index(0, 0, -7)
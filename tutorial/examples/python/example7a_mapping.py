@@ -42,13 +42,8 @@ for i in range(0, N):
     rs.simulate(dt, False)
 
     """ add segment indices """
-    segs = rs.segments
-    x = np.zeros(len(segs))
-    for i, s in enumerate(segs):
-        try:
-            x[i] = rs.seg2cell[i]
-        except:  # in case the segment is not within the domain
-            x[i] = -10
+    x = np.array(rs.getSeg2CellArray(), dtype = float)
+    x[x < -1] = -10  # in case the segment is not mapped
 
     ana = pb.SegmentAnalyser(rs.mappedSegments())
     ana.addData("linear_index", x)